@@ -0,0 +1,155 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <new>
+#include <stdlib.h>
+
+// counts heap allocations per thread, so the main loop can see exactly what
+// it allocated in a frame while worker threads do as they please
+// covers operator new (plain and over-aligned) and everything SDL (and the SDL_image/ttf/mixer libs
+// built on it) allocates through SDL_malloc
+// the operator new replacements have to be defined exactly once, so one
+// source file does
+//   #define LALLOC_COUNTER_IMPLEMENTATION
+// before including this
+inline thread_local Uint64 threadAllocations = 0;
+inline thread_local Uint64 threadAllocatedBytes = 0;
+
+inline Uint64 GetThreadAllocations() { return threadAllocations; }
+
+inline Uint64 GetThreadAllocatedBytes() { return threadAllocatedBytes; }
+
+inline void CountAllocation(size_t size) {
+  threadAllocations++;
+  threadAllocatedBytes += size;
+}
+
+// SDL keeps its previous functions around; we only count and forward
+inline SDL_malloc_func sdlMalloc = NULL;
+inline SDL_calloc_func sdlCalloc = NULL;
+inline SDL_realloc_func sdlRealloc = NULL;
+inline SDL_free_func sdlFree = NULL;
+
+inline void *CountingMalloc(size_t size) {
+  CountAllocation(size);
+  return sdlMalloc(size);
+}
+
+inline void *CountingCalloc(size_t n, size_t size) {
+  CountAllocation(n * size);
+  return sdlCalloc(n, size);
+}
+
+inline void *CountingRealloc(void *p, size_t size) {
+  CountAllocation(size);
+  return sdlRealloc(p, size);
+}
+
+inline void CountingFree(void *p) { sdlFree(p); }
+
+// call before SDL_Init, so every SDL allocation goes through the counter
+inline void InstallAllocCounter() {
+  if (sdlMalloc != NULL) {
+    return;
+  }
+
+  SDL_GetMemoryFunctions(&sdlMalloc, &sdlCalloc, &sdlRealloc, &sdlFree);
+  SDL_SetMemoryFunctions(CountingMalloc, CountingCalloc, CountingRealloc,
+                         CountingFree);
+}
+
+#if defined(LALLOC_COUNTER_IMPLEMENTATION)
+
+#if defined(_WIN32)
+#include <malloc.h>
+#endif
+
+// over-aligned types (alignas > max_align_t) come through these; aligned
+// blocks need their own free on windows
+inline void *AlignedAlloc(size_t size, size_t align) {
+#if defined(_WIN32)
+  return _aligned_malloc(size > 0 ? size : 1, align);
+#else
+  // aligned_alloc wants the size to be a multiple of the alignment
+  size = (size + align - 1) / align * align;
+  return aligned_alloc(align, size > 0 ? size : align);
+#endif
+}
+
+inline void AlignedFree(void *p) {
+#if defined(_WIN32)
+  _aligned_free(p);
+#else
+  free(p);
+#endif
+}
+
+void *operator new(size_t size) {
+  CountAllocation(size);
+
+  void *p = malloc(size > 0 ? size : 1);
+  if (p == NULL) {
+    throw std::bad_alloc();
+  }
+
+  return p;
+}
+
+void *operator new[](size_t size) { return operator new(size); }
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept {
+  CountAllocation(size);
+  return malloc(size > 0 ? size : 1);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept {
+  return operator new(size, std::nothrow);
+}
+
+void operator delete(void *p) noexcept { free(p); }
+
+void operator delete[](void *p) noexcept { free(p); }
+
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+void operator delete[](void *p, size_t) noexcept { free(p); }
+
+void *operator new(size_t size, std::align_val_t align) {
+  CountAllocation(size);
+
+  void *p = AlignedAlloc(size, (size_t)align);
+  if (p == NULL) {
+    throw std::bad_alloc();
+  }
+
+  return p;
+}
+
+void *operator new[](size_t size, std::align_val_t align) {
+  return operator new(size, align);
+}
+
+void *operator new(size_t size, std::align_val_t align,
+                   const std::nothrow_t &) noexcept {
+  CountAllocation(size);
+  return AlignedAlloc(size, (size_t)align);
+}
+
+void *operator new[](size_t size, std::align_val_t align,
+                     const std::nothrow_t &) noexcept {
+  return operator new(size, align, std::nothrow);
+}
+
+void operator delete(void *p, std::align_val_t) noexcept { AlignedFree(p); }
+
+void operator delete[](void *p, std::align_val_t) noexcept { AlignedFree(p); }
+
+void operator delete(void *p, size_t, std::align_val_t) noexcept {
+  AlignedFree(p);
+}
+
+void operator delete[](void *p, size_t, std::align_val_t) noexcept {
+  AlignedFree(p);
+}
+
+#endif
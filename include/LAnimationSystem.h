@@ -0,0 +1,226 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <vector>
+
+// frame animation state for every sprite, stored as parallel arrays so one
+// tick is a single branch-free pass the compiler can vectorize
+// clips (frame rect tables like charSpriteClips) are registered once and
+// shared; an instance only stores which clip it plays
+// time is kept as a fractional frame phase: leftover time after a step
+// carries into the next one instead of being dropped, and a long tick can
+// advance several frames at once
+// instances are addressed by stable handles; the arrays stay dense (destroy
+// swaps the last instance into the hole)
+class LAnimationSystem {
+public:
+  LAnimationSystem() {}
+
+  // the table isn't copied; it must outlive the system
+  // adding the same table again returns the existing clip
+  int AddClip(SDL_Rect *frames, int nFrames) {
+    for (int i = 0; i < (int)clips.size(); ++i) {
+      if (clips[i].frames == frames && clips[i].nFrames == nFrames) {
+        return i;
+      }
+    }
+
+    Clip c;
+    c.frames = frames;
+    c.nFrames = nFrames;
+    clips.push_back(c);
+
+    return (int)clips.size() - 1;
+  }
+
+  SDL_Rect *GetClipFrames(int clip) { return clips[clip].frames; }
+
+  int Create(int clipIndex, float fps) {
+    int handle;
+    if (!freeHandles.empty()) {
+      handle = freeHandles.back();
+      freeHandles.pop_back();
+    }
+
+    else {
+      handle = (int)slotOf.size();
+      slotOf.push_back(-1);
+    }
+
+    int slot = (int)frame.size();
+    slotOf[handle] = slot;
+    handleOf.push_back(handle);
+
+    clip.push_back(clipIndex);
+    frame.push_back(0);
+    nFrames.push_back(clips[clipIndex].nFrames);
+    invFrames.push_back(1.0f / clips[clipIndex].nFrames);
+    phase.push_back(0);
+    rate.push_back(fps > 0 ? fps : 0);
+    stepped.push_back(0);
+
+    return handle;
+  }
+
+  void Destroy(int handle) {
+    int slot = slotOf[handle];
+    int last = (int)frame.size() - 1;
+
+    // move the last instance into the hole
+    if (slot != last) {
+      clip[slot] = clip[last];
+      frame[slot] = frame[last];
+      nFrames[slot] = nFrames[last];
+      invFrames[slot] = invFrames[last];
+      phase[slot] = phase[last];
+      rate[slot] = rate[last];
+      stepped[slot] = stepped[last];
+
+      handleOf[slot] = handleOf[last];
+      slotOf[handleOf[slot]] = slot;
+    }
+
+    clip.pop_back();
+    frame.pop_back();
+    nFrames.pop_back();
+    invFrames.pop_back();
+    phase.pop_back();
+    rate.pop_back();
+    stepped.pop_back();
+    handleOf.pop_back();
+
+    slotOf[handle] = -1;
+    freeHandles.push_back(handle);
+  }
+
+  void Reserve(int n) {
+    clip.reserve(n);
+    frame.reserve(n);
+    nFrames.reserve(n);
+    invFrames.reserve(n);
+    phase.reserve(n);
+    rate.reserve(n);
+    stepped.reserve(n);
+    handleOf.reserve(n);
+    slotOf.reserve(n);
+  }
+
+  // advance everything by dt seconds
+  void Update(float dt) {
+    int n = (int)frame.size();
+
+    Sint32 *__restrict fr = frame.data();
+    const Sint32 *__restrict nf = nFrames.data();
+    const float *__restrict inv = invFrames.data();
+    float *__restrict ph = phase.data();
+    const float *__restrict rt = rate.data();
+    Sint32 *__restrict st = stepped.data();
+
+    for (int i = 0; i < n; ++i) {
+      float p = ph[i] + dt * rt[i];
+      Sint32 steps = (Sint32)p;
+      ph[i] = p - (float)steps;
+
+      // wrap; inv can round low, so fix up the last frame with a select
+      Sint32 f = fr[i] + steps;
+      f -= (Sint32)((float)f * inv[i]) * nf[i];
+      fr[i] = f >= nf[i] ? f - nf[i] : f;
+
+      st[i] = steps > 0;
+    }
+  }
+
+  int GetCount() { return (int)frame.size(); }
+
+  // capacity of the per-instance arrays, in bytes; clip frame tables
+  // belong to whoever registered them
+  size_t GetMemoryUsage() {
+    size_t bytes = clips.capacity() * sizeof(Clip);
+
+    bytes += (clip.capacity() + frame.capacity() + nFrames.capacity() +
+              stepped.capacity()) *
+             sizeof(Sint32);
+    bytes += (invFrames.capacity() + phase.capacity() + rate.capacity()) *
+             sizeof(float);
+    bytes += (handleOf.capacity() + slotOf.capacity() +
+              freeHandles.capacity()) *
+             sizeof(int);
+
+    return bytes;
+  }
+
+  int GetFrame(int handle) { return frame[slotOf[handle]]; }
+
+  SDL_Rect *GetFrameRect(int handle) {
+    int s = slotOf[handle];
+    return &clips[clip[s]].frames[frame[s]];
+  }
+
+  // whether the last Update() moved it to a new frame
+  bool GetStepped(int handle) { return stepped[slotOf[handle]] != 0; }
+
+  // fraction of the current frame already elapsed
+  float GetPhase(int handle) { return phase[slotOf[handle]]; }
+
+  float GetFPS(int handle) { return rate[slotOf[handle]]; }
+
+  // 0 holds the current frame; phase is kept, so it resumes where it paused
+  void SetFPS(int handle, float fps) {
+    if (fps < 0) {
+      printf("Could not set FPS! Out of bounds.\n");
+      return;
+    }
+
+    rate[slotOf[handle]] = fps;
+  }
+
+  void SetFrame(int handle, int f) {
+    int s = slotOf[handle];
+    if (f < 0 || f >= nFrames[s]) {
+      printf("Could not set frame! Out of bounds.\n");
+      return;
+    }
+
+    frame[s] = f;
+  }
+
+  // restore needs to put back exactly what Update() reads and writes
+  void GetState(int handle, Sint32 *f, float *p, float *r, Sint32 *s) {
+    int slot = slotOf[handle];
+    *f = frame[slot];
+    *p = phase[slot];
+    *r = rate[slot];
+    *s = stepped[slot];
+  }
+
+  void SetState(int handle, Sint32 f, float p, float r, Sint32 s) {
+    int slot = slotOf[handle];
+    frame[slot] = f;
+    phase[slot] = p;
+    rate[slot] = r;
+    stepped[slot] = s;
+  }
+
+private:
+  struct Clip {
+    SDL_Rect *frames;
+    int nFrames;
+  };
+
+  std::vector<Clip> clips;
+
+  // per instance, indexed by slot
+  std::vector<Sint32> clip;
+  std::vector<Sint32> frame;
+  std::vector<Sint32> nFrames;
+  std::vector<float> invFrames;
+  std::vector<float> phase;
+  std::vector<float> rate;
+  std::vector<Sint32> stepped;
+
+  // handle <-> slot
+  std::vector<int> handleOf;
+  std::vector<int> slotOf;
+  std::vector<int> freeHandles;
+};
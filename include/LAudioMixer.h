@@ -0,0 +1,289 @@
+#pragma once
+
+#include "LSpscQueue.h"
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_mixer.h>
+#include <atomic>
+#include <stdio.h>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// sfx mixer that runs inside SDL's audio callback (as SDL_mixer's post-mix
+// hook, so music still goes through SDL_mixer)
+// the game thread never touches voice state; it pushes play commands through
+// a lock-free queue and the callback applies them at the start of each
+// buffer, then mixes pre-decoded pcm (the Mix_Chunk buffers, already in the
+// device format) with saturating simd adds
+// meant for small device buffers (256 frames ~ 6ms at 44.1kHz)
+class LAudioMixer {
+public:
+  LAudioMixer() {
+    started = false;
+
+    mixNanosTotal = 0;
+    mixNanosMax = 0;
+    mixCalls = 0;
+    droppedCommands = 0;
+  }
+
+  // nVoices should match the voice manager's budget; voices are addressed by
+  // the same channel index
+  bool Init(int nVoices) {
+    int freq, channels;
+    Uint16 format;
+
+    if (Mix_QuerySpec(&freq, &format, &channels) == 0) {
+      printf("Could not query mixer: %s\n", Mix_GetError());
+      return false;
+    }
+
+    // kernels only handle native 16 bit samples
+    if (format != AUDIO_S16SYS) {
+      printf("Low latency mixer needs 16 bit audio, got format %x\n", format);
+      return false;
+    }
+
+    voices.assign(nVoices, Voice());
+
+    return true;
+  }
+
+  // sounds must be registered before Start(); the callback reads the table
+  // without locking
+  void AddSound(Mix_Chunk *chunk) {
+    if (started || chunk == NULL) {
+      return;
+    }
+
+    Sound s;
+    s.chunk = chunk;
+    s.samples = (Sint16 *)chunk->abuf;
+    s.nSamples = chunk->alen / sizeof(Sint16);
+    sounds.push_back(s);
+  }
+
+  void Start() {
+    if (started) {
+      return;
+    }
+
+    started = true;
+
+    // installs under the audio lock, so the sound table is visible to the
+    // callback from here on
+    Mix_SetPostMix(Callback, this);
+  }
+
+  void Stop() {
+    if (!started) {
+      return;
+    }
+
+    Mix_SetPostMix(NULL, NULL);
+    started = false;
+  }
+
+  bool IsStarted() { return started; }
+
+  // game thread; restarts the voice with this sound (which is also how a
+  // voice gets stolen)
+  bool Play(int voice, Mix_Chunk *chunk, int volume) {
+    int sound = FindSound(chunk);
+    if (sound < 0 || voice < 0 || voice >= (int)voices.size()) {
+      return false;
+    }
+
+    MixCommand c;
+    c.voice = voice;
+    c.sound = sound;
+    c.volume = volume;
+
+    if (!commands.Push(c)) {
+      droppedCommands++;
+      return false;
+    }
+
+    return true;
+  }
+
+  // average and worst time spent mixing one device buffer
+  void PrintStats() {
+    Uint64 calls = mixCalls.load();
+    printf("mixer: %llu buffers, mean %.4f ms, max %.4f ms, %d dropped "
+           "commands\n",
+           (unsigned long long)calls,
+           calls > 0 ? mixNanosTotal.load() / 1e6 / calls : 0.0,
+           mixNanosMax.load() / 1e6, droppedCommands);
+  }
+
+private:
+  static const int MAX_COMMANDS = 256;
+
+  struct Sound {
+    Mix_Chunk *chunk;
+    Sint16 *samples;
+    int nSamples;
+  };
+
+  struct Voice {
+    Voice() {
+      sound = -1;
+      pos = 0;
+      volume = 0;
+    }
+
+    int sound;
+    int pos; // in samples, not frames
+    int volume;
+  };
+
+  struct MixCommand {
+    int voice;
+    int sound;
+    int volume;
+  };
+
+  int FindSound(Mix_Chunk *chunk) {
+    for (int i = 0; i < (int)sounds.size(); ++i) {
+      if (sounds[i].chunk == chunk) {
+        return i;
+      }
+    }
+
+    return -1;
+  }
+
+  static void Callback(void *udata, Uint8 *stream, int len) {
+    ((LAudioMixer *)udata)->Mix((Sint16 *)stream, len / sizeof(Sint16));
+  }
+
+  // audio thread
+  void Mix(Sint16 *out, int n) {
+    Uint64 start = SDL_GetPerformanceCounter();
+
+    MixCommand c;
+    while (commands.Pop(c)) {
+      Voice &v = voices[c.voice];
+      v.sound = c.sound;
+      v.pos = 0;
+      v.volume = c.volume;
+    }
+
+    for (int i = 0; i < (int)voices.size(); ++i) {
+      Voice &v = voices[i];
+      if (v.sound < 0) {
+        continue;
+      }
+
+      Sound &s = sounds[v.sound];
+
+      int count = s.nSamples - v.pos;
+      if (count > n) {
+        count = n;
+      }
+
+      MixVoice(out, s.samples + v.pos, count, v.volume);
+
+      v.pos += count;
+      if (v.pos >= s.nSamples) {
+        v.sound = -1;
+      }
+    }
+
+    Uint64 nanos = (SDL_GetPerformanceCounter() - start) * 1000000000ull /
+                   SDL_GetPerformanceFrequency();
+
+    mixNanosTotal += nanos;
+    mixCalls++;
+    if (nanos > mixNanosMax.load(std::memory_order_relaxed)) {
+      mixNanosMax = nanos;
+    }
+  }
+
+  // out[i] = saturate(out[i] + src[i] * volume / 128)
+  // scaling is (src * (volume << 8)) >> 15, done as a high multiply (>> 16)
+  // then a shift, so full volume skips it entirely
+  static void MixVoice(Sint16 *out, const Sint16 *src, int n, int volume) {
+    int i = 0;
+
+    if (volume >= MIX_MAX_VOLUME) {
+#if defined(__AVX2__)
+      for (; i + 16 <= n; i += 16) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(out + i));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(src + i));
+        _mm256_storeu_si256((__m256i *)(out + i), _mm256_adds_epi16(a, b));
+      }
+#endif
+#if defined(__SSE2__)
+      for (; i + 8 <= n; i += 8) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(out + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(src + i));
+        _mm_storeu_si128((__m128i *)(out + i), _mm_adds_epi16(a, b));
+      }
+#endif
+      for (; i < n; ++i) {
+        out[i] = Saturate(out[i] + src[i]);
+      }
+
+      return;
+    }
+
+    Sint16 gain = (Sint16)(volume << 8);
+
+#if defined(__AVX2__)
+    __m256i gain16 = _mm256_set1_epi16(gain);
+    for (; i + 16 <= n; i += 16) {
+      __m256i a = _mm256_loadu_si256((const __m256i *)(out + i));
+      __m256i b = _mm256_loadu_si256((const __m256i *)(src + i));
+      b = _mm256_slli_epi16(_mm256_mulhi_epi16(b, gain16), 1);
+      _mm256_storeu_si256((__m256i *)(out + i), _mm256_adds_epi16(a, b));
+    }
+#endif
+#if defined(__SSE2__)
+    __m128i gain8 = _mm_set1_epi16(gain);
+    for (; i + 8 <= n; i += 8) {
+      __m128i a = _mm_loadu_si128((const __m128i *)(out + i));
+      __m128i b = _mm_loadu_si128((const __m128i *)(src + i));
+      b = _mm_slli_epi16(_mm_mulhi_epi16(b, gain8), 1);
+      _mm_storeu_si128((__m128i *)(out + i), _mm_adds_epi16(a, b));
+    }
+#endif
+    for (; i < n; ++i) {
+      int scaled = ((src[i] * gain) >> 16) * 2;
+      out[i] = Saturate(out[i] + scaled);
+    }
+  }
+
+  static Sint16 Saturate(int x) {
+    if (x > 32767) {
+      return 32767;
+    }
+
+    if (x < -32768) {
+      return -32768;
+    }
+
+    return (Sint16)x;
+  }
+
+  // only touched by the audio thread once started
+  std::vector<Voice> voices;
+  std::vector<Sound> sounds;
+
+  LSpscQueue<MixCommand, MAX_COMMANDS> commands;
+
+  bool started;
+
+  std::atomic<Uint64> mixNanosTotal;
+  std::atomic<Uint64> mixNanosMax;
+  std::atomic<Uint64> mixCalls;
+  int droppedCommands;
+};
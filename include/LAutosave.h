@@ -0,0 +1,165 @@
+#pragma once
+
+#include "LJournaledSave.h"
+
+#include <SDL2/SDL.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <stdio.h>
+#include <thread>
+#include <vector>
+
+// periodic autosave off the main thread
+// the main loop copies the save state into a snapshot buffer at the frame
+// boundary (just a memcpy into memory we already own), then a worker thread
+// diffs it into the save journal (or compacts); the frame never waits on the
+// disk
+//
+// usage, once per frame:
+//   Uint8 *snap = autosave.BeginSnapshot(size, SDL_GetTicks());
+//   if (snap != NULL) { copy state into snap; autosave.EndSnapshot(); }
+class LAutosave {
+public:
+  LAutosave() {
+    save = NULL;
+    intervalMs = 0;
+    lastSnapshot = 0;
+
+    hasPending = false;
+    running = false;
+    inSnapshot = false;
+
+    savesWritten = 0;
+    snapshotsSkipped = 0;
+  }
+
+  ~LAutosave() { Stop(); }
+
+  // save is only touched by the worker until Stop() returns
+  void Start(LJournaledSave *save, Uint32 intervalMs) {
+    if (running) {
+      return;
+    }
+
+    this->save = save;
+    this->intervalMs = intervalMs;
+    lastSnapshot = SDL_GetTicks();
+
+    running = true;
+    worker = std::thread(&LAutosave::Work, this);
+  }
+
+  // sizes both buffers up front so not even the first snapshots allocate;
+  // call before Start()
+  void Reserve(size_t size) {
+    pending.reserve(size);
+    writing.reserve(size);
+  }
+
+  // writes whatever snapshot is still pending, then joins the worker
+  void Stop() {
+    if (!running) {
+      return;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(mtx);
+      running = false;
+    }
+
+    cv.notify_one();
+    worker.join();
+  }
+
+  // returns a buffer of the given size to copy state into, or NULL if no
+  // snapshot is due (interval not elapsed, or the worker is mid-swap)
+  // buffer memory is reused between snapshots, so once it has grown to the
+  // save size this doesn't allocate
+  Uint8 *BeginSnapshot(size_t size, Uint32 now) {
+    if (!running || now - lastSnapshot < intervalMs) {
+      return NULL;
+    }
+
+    // never block the frame on the worker; just try again next frame
+    if (!mtx.try_lock()) {
+      snapshotsSkipped++;
+      return NULL;
+    }
+
+    inSnapshot = true;
+    lastSnapshot = now;
+
+    pending.resize(size);
+    return pending.data();
+  }
+
+  void EndSnapshot() {
+    if (!inSnapshot) {
+      return;
+    }
+
+    inSnapshot = false;
+    hasPending = true;
+
+    mtx.unlock();
+    cv.notify_one();
+  }
+
+  int GetSavesWritten() { return savesWritten; }
+
+  int GetSnapshotsSkipped() { return snapshotsSkipped; }
+
+  // both snapshot buffers; the worker swaps them, so under the lock
+  size_t GetMemoryUsage() {
+    std::lock_guard<std::mutex> lock(mtx);
+    return pending.capacity() + writing.capacity();
+  }
+
+private:
+  void Work() {
+    std::unique_lock<std::mutex> lock(mtx);
+
+    while (true) {
+      cv.wait(lock, [this] { return hasPending || !running; });
+
+      if (!hasPending) {
+        // stopped with nothing left to write
+        break;
+      }
+
+      // take the snapshot; main thread can fill pending again while we write
+      writing.swap(pending);
+      hasPending = false;
+
+      lock.unlock();
+
+      if (save->Save(writing.data(), writing.size())) {
+        savesWritten++;
+      }
+
+      lock.lock();
+    }
+  }
+
+  LJournaledSave *save;
+  Uint32 intervalMs;
+  Uint32 lastSnapshot;
+
+  std::thread worker;
+  std::mutex mtx;
+  std::condition_variable cv;
+
+  // pending is filled by the main thread under mtx, writing is only touched
+  // by the worker
+  std::vector<Uint8> pending;
+  std::vector<Uint8> writing;
+
+  bool hasPending;
+  bool running;
+  bool inSnapshot;
+
+  // written by the worker, read by the main thread
+  std::atomic<int> savesWritten;
+  int snapshotsSkipped;
+};
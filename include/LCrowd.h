@@ -0,0 +1,98 @@
+#pragma once
+
+#include "LFlowField.h"
+#include "LStateArena.h"
+
+#include <SDL2/SDL.h>
+#include <vector>
+
+// agents that follow a flow field, stored as parallel arrays
+// positions are world pixels; the field's cells are cellSize pixels square
+// each tick an agent reads its cell's direction and moves along it, one axis
+// at a time so it slides along walls instead of sticking to them
+class LCrowd {
+public:
+  LCrowd() {}
+
+  void Reserve(int n) {
+    posX.reserve(n);
+    posY.reserve(n);
+    speed.reserve(n);
+  }
+
+  void Add(float x, float y, float pixelsPerSecond) {
+    posX.push_back(x);
+    posY.push_back(y);
+    speed.push_back(pixelsPerSecond);
+  }
+
+  void Clear() {
+    posX.clear();
+    posY.clear();
+    speed.clear();
+  }
+
+  int GetCount() { return (int)posX.size(); }
+
+  size_t GetMemoryUsage() {
+    return (posX.capacity() + posY.capacity() + speed.capacity()) *
+           sizeof(float);
+  }
+
+  float GetX(int i) { return posX[i]; }
+
+  float GetY(int i) { return posY[i]; }
+
+  void Update(LFlowField &field, float cellSize, float dt) {
+    float inv = 1.0f / cellSize;
+    int n = (int)posX.size();
+
+    for (int i = 0; i < n; ++i) {
+      int cx = (int)(posX[i] * inv);
+      int cy = (int)(posY[i] * inv);
+
+      Uint8 d = field.GetDirection(cx, cy);
+      if (d == LFlowField::DIR_NONE) {
+        continue;
+      }
+
+      float step = speed[i] * dt;
+      float nx = posX[i] + LFlowField::DirX(d) * step;
+      float ny = posY[i] + LFlowField::DirY(d) * step;
+
+      if (!field.IsBlocked((int)(nx * inv), cy)) {
+        posX[i] = nx;
+        cx = (int)(nx * inv);
+      }
+
+      if (!field.IsBlocked(cx, (int)(ny * inv))) {
+        posY[i] = ny;
+      }
+    }
+  }
+
+  void Snapshot(LStateArena &a) {
+    int n = (int)posX.size();
+    a.Write(n);
+    a.WriteBytes(posX.data(), n * sizeof(float));
+    a.WriteBytes(posY.data(), n * sizeof(float));
+    a.WriteBytes(speed.data(), n * sizeof(float));
+  }
+
+  void Restore(LStateArena &a) {
+    int n = 0;
+    a.Read(n);
+
+    posX.resize(n);
+    posY.resize(n);
+    speed.resize(n);
+    a.ReadBytes(posX.data(), n * sizeof(float));
+    a.ReadBytes(posY.data(), n * sizeof(float));
+    a.ReadBytes(speed.data(), n * sizeof(float));
+  }
+
+private:
+  std::vector<float> posX;
+  std::vector<float> posY;
+  std::vector<float> speed;
+};
@@ -0,0 +1,113 @@
+#pragma once
+
+#include "LAnimationSystem.h"
+#include "LFrameArena.h"
+#include "LMemoryStats.h"
+#include "LRenderRecording.h"
+#include "LSoftBlitter.h"
+#include "LVoiceManager.h"
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_mixer.h>
+#include <SDL2/SDL_ttf.h>
+
+// state the engine pieces (LTexture, LSprite, Tile, Player) share, for the
+// game and game_bench alike
+// these are inline so every program gets exactly one of each, and so they're
+// constructed before any global declared after this include (sprites made at
+// startup need animations to exist already)
+
+const int SCREEN_WIDTH = 900;
+const int SCREEN_HEIGHT = 900;
+
+const int GLOB_SCALE = 8;
+const int GLOB_FONTSIZE = 32;
+
+const int KEY_COUNT = 4;
+
+inline SDL_Window *window = NULL;
+inline SDL_Renderer *renderer = NULL;
+
+inline TTF_Font *gFont = NULL;
+
+typedef enum Inputs {
+  UP,
+  DOWN,
+  LEFT,
+  RIGHT,
+  PAUSE,
+  EXIT,
+  REWIND,
+  TOTAL_INPUTS
+} Inputs;
+inline bool KEYS[TOTAL_INPUTS];
+
+// per-frame temporaries; reset at the top of every frame
+// the base size covers text and draw lists; the game adds one pointer per
+// tile it can ever have resident when the level loads (see Player::Move)
+inline const size_t FRAME_ARENA_BASE = 64 * 1024;
+inline LFrameArena frameArena(FRAME_ARENA_BASE);
+
+// estimated bytes held per texture, sound and subsystem; F2 prints it, and
+// it's printed on exit
+inline LMemoryStats memoryStats;
+
+// --record-render: every LTexture draw, clear and present goes to a file that
+// render_replay plays back against any renderer
+inline LRenderRecorder renderRecorder;
+
+// --soft-blit: world sprites are drawn on the cpu into one streaming texture
+// instead of one SDL_RenderCopy each; LTexture uses it while it's drawing
+inline LSoftBlitter softBlitter;
+
+// every sprite's animation lives in one system and advances in a single
+// animations.Update() per tick; a sprite is a handle into it plus the sheet
+// it draws from
+inline LAnimationSystem animations;
+
+// all sfx go through here instead of straight to Mix_PlayChannel
+inline LVoiceManager voices;
+inline Mix_Chunk *step = NULL;
+
+// whole level in pixels, from the level file
+inline SDL_Rect levelBounds = {0, 0, 0, 0};
+
+inline bool CheckCollision(SDL_Rect a, SDL_Rect b) {
+  // sides of both rects
+  int leftA, leftB;
+  int rightA, rightB;
+  int topA, topB;
+  int bottomA, bottomB;
+
+  // calculate sides of a
+  leftA = a.x;
+  rightA = a.x + a.w;
+  topA = a.y;
+  bottomA = a.y + a.h;
+
+  // calculate sides of b
+  leftB = b.x;
+  rightB = b.x + b.w;
+  topB = b.y;
+  bottomB = b.y + b.h;
+
+  // if any sides from a are outside b
+  if (bottomA <= topB) {
+    return false;
+  }
+
+  if (topA >= bottomB) {
+    return false;
+  }
+
+  if (rightA <= leftB) {
+    return false;
+  }
+
+  if (leftA >= rightB) {
+    return false;
+  }
+
+  // if no sides of a are outside b
+  return true;
+}
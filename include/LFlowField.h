@@ -0,0 +1,318 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <string.h>
+#include <vector>
+
+// distance field over a walkability grid, flowing towards one goal cell
+// built with a breadth-first search out from the goal; every cell it reaches
+// records the direction back to the cell it was reached from, so an agent
+// anywhere on the map just reads its cell's direction (no per-agent search)
+// 8-connected, but diagonals can't cut a blocked corner
+// the grid has a blocked border cell all round, so neighbours are fixed
+// index offsets with no bounds checks
+// rebuilds are time-sliced: SetGoal() starts one in a back buffer, Step()
+// expands a fixed number of cells per frame, and agents keep reading the
+// last finished field until the new one swaps in; a goal change during a
+// rebuild waits for it to finish rather than restarting it, so a goal that
+// moves every frame still converges
+// walls can change after Init (SetBlocked + Invalidate); the old field stays
+// in use until the rebuild that sees them finishes
+class LFlowField {
+public:
+  static constexpr Uint16 UNREACHABLE = 0xFFFF;
+
+  // direction indices; DIR_NONE at the goal and unreached cells
+  static constexpr Uint8 DIR_NONE = 8;
+
+  LFlowField() {
+    width = 0;
+    height = 0;
+    stride = 0;
+    originX = 0;
+    originY = 0;
+
+    goal = -1;
+    pendingGoal = -1;
+    buildGoal = -1;
+    queueHead = 0;
+    rebuilds = 0;
+    stale = false;
+  }
+
+  // everything walkable, no field yet
+  // cell coordinates everywhere else are offset by the origin, so a grid
+  // can cover just part of a bigger world
+  void Init(int width, int height, int originX = 0, int originY = 0) {
+    this->width = width;
+    this->height = height;
+    this->originX = originX;
+    this->originY = originY;
+    stride = width + 2;
+
+    int n = stride * (height + 2);
+    blocked.assign(n, 1);
+
+    for (int y = 0; y < height; ++y) {
+      memset(&blocked[Cell(originX, originY + y)], 0, width);
+    }
+
+    dist.assign(n, UNREACHABLE);
+    dir.assign(n, DIR_NONE);
+    buildDist.assign(n, UNREACHABLE);
+    buildDir.assign(n, DIR_NONE);
+
+    queue.clear();
+    queue.reserve(n);
+    queueHead = 0;
+
+    goal = -1;
+    pendingGoal = -1;
+    buildGoal = -1;
+    stale = false;
+  }
+
+  int GetWidth() { return width; }
+
+  int GetHeight() { return height; }
+
+  int GetOriginX() { return originX; }
+
+  int GetOriginY() { return originY; }
+
+  bool InBounds(int x, int y) {
+    x -= originX;
+    y -= originY;
+    return x >= 0 && y >= 0 && x < width && y < height;
+  }
+
+  // takes effect on the next rebuild
+  void SetBlocked(int x, int y, bool b) {
+    if (InBounds(x, y)) {
+      blocked[Cell(x, y)] = b;
+    }
+  }
+
+  // out of bounds counts as blocked
+  bool IsBlocked(int x, int y) {
+    return !InBounds(x, y) || blocked[Cell(x, y)] != 0;
+  }
+
+  // queues a rebuild towards this cell unless it's already the target
+  void SetGoal(int x, int y) {
+    if (!InBounds(x, y)) {
+      return;
+    }
+
+    int cell = Cell(x, y);
+
+    if (buildGoal >= 0) {
+      if (cell != buildGoal) {
+        pendingGoal = cell;
+      }
+
+      else {
+        pendingGoal = -1;
+      }
+
+      return;
+    }
+
+    if (cell != goal) {
+      StartBuild(cell);
+    }
+  }
+
+  // walls changed; rebuilds towards the current goal, after the rebuild in
+  // progress if there is one (it may have read the old walls)
+  void Invalidate() {
+    if (buildGoal >= 0) {
+      stale = true;
+    }
+
+    else if (goal >= 0) {
+      StartBuild(goal);
+    }
+  }
+
+  // expands up to budget cells of the rebuild in progress; true once the
+  // field matches the latest goal
+  bool Step(int budget) {
+    while (buildGoal >= 0 && budget > 0) {
+      int expanded = Expand(budget);
+      budget -= expanded;
+
+      if (queueHead == (int)queue.size()) {
+        FinishBuild();
+      }
+
+      else {
+        break;
+      }
+    }
+
+    return buildGoal < 0;
+  }
+
+  // runs the rebuild in progress to the end
+  void Finish() {
+    while (!Step(width * height)) {
+    }
+  }
+
+  bool IsBuilding() { return buildGoal >= 0; }
+
+  // finished rebuilds so far
+  int GetRebuilds() { return rebuilds; }
+
+  // both fields plus the build queue, in bytes
+  size_t GetMemoryUsage() {
+    return blocked.capacity() + dir.capacity() + buildDir.capacity() +
+           (dist.capacity() + buildDist.capacity()) * sizeof(Uint16) +
+           queue.capacity() * sizeof(int);
+  }
+
+  Uint8 GetDirection(int x, int y) {
+    if (!InBounds(x, y)) {
+      return DIR_NONE;
+    }
+
+    return dir[Cell(x, y)];
+  }
+
+  Uint16 GetDistance(int x, int y) {
+    if (!InBounds(x, y)) {
+      return UNREACHABLE;
+    }
+
+    return dist[Cell(x, y)];
+  }
+
+  // unit vector for a direction index
+  static float DirX(Uint8 d) {
+    static const float xs[9] = {1, 1, 0, -1, -1, -1, 0, 1, 0};
+    return xs[d] * (d % 2 == 1 ? DIAGONAL : 1.0f);
+  }
+
+  static float DirY(Uint8 d) {
+    static const float ys[9] = {0, 1, 1, 1, 0, -1, -1, -1, 0};
+    return ys[d] * (d % 2 == 1 ? DIAGONAL : 1.0f);
+  }
+
+private:
+  // 1 / sqrt(2)
+  static constexpr float DIAGONAL = 0.70710678f;
+
+  int Cell(int x, int y) {
+    return (y - originY + 1) * stride + x - originX + 1;
+  }
+
+  void StartBuild(int cell) {
+    buildGoal = cell;
+    stale = false;
+
+    memset(buildDist.data(), 0xFF, buildDist.size() * sizeof(Uint16));
+    memset(buildDir.data(), DIR_NONE, buildDir.size());
+
+    queue.clear();
+    queueHead = 0;
+
+    // a goal inside a wall leaves everything unreachable
+    if (!blocked[cell]) {
+      buildDist[cell] = 0;
+      queue.push_back(cell);
+    }
+  }
+
+  void FinishBuild() {
+    dist.swap(buildDist);
+    dir.swap(buildDir);
+    goal = buildGoal;
+    buildGoal = -1;
+    rebuilds++;
+
+    int next = pendingGoal;
+    pendingGoal = -1;
+
+    if (next >= 0 && next != goal) {
+      StartBuild(next);
+    }
+
+    else if (stale) {
+      StartBuild(goal);
+    }
+  }
+
+  // pops up to budget cells off the bfs queue; returns how many
+  int Expand(int budget) {
+    static const int dxs[8] = {1, 1, 0, -1, -1, -1, 0, 1};
+    static const int dys[8] = {0, 1, 1, 1, 0, -1, -1, -1};
+
+    int offsets[8];
+    for (int k = 0; k < 8; ++k) {
+      offsets[k] = dys[k] * stride + dxs[k];
+    }
+
+    const Uint8 *walls = blocked.data();
+    Uint16 *bd = buildDist.data();
+    Uint8 *bdir = buildDir.data();
+
+    int done = 0;
+
+    while (queueHead < (int)queue.size() && done < budget) {
+      int c = queue[queueHead++];
+      Uint16 next = bd[c] + 1;
+      done++;
+
+      // distance would wrap into UNREACHABLE; only a pathological maze gets
+      // here, and those cells just don't flow
+      if (next == UNREACHABLE) {
+        continue;
+      }
+
+      for (int k = 0; k < 8; ++k) {
+        int n = c + offsets[k];
+
+        if (walls[n] || bd[n] != UNREACHABLE) {
+          continue;
+        }
+
+        // diagonal steps need both sides open
+        if (k % 2 == 1 && (walls[c + dxs[k]] || walls[c + dys[k] * stride])) {
+          continue;
+        }
+
+        bd[n] = next;
+
+        // from n, step back the way we came
+        bdir[n] = (Uint8)((k + 4) % 8);
+        queue.push_back(n);
+      }
+    }
+
+    return done;
+  }
+
+  int width, height;
+  int originX, originY;
+  int stride;
+  std::vector<Uint8> blocked;
+
+  // field agents read
+  std::vector<Uint16> dist;
+  std::vector<Uint8> dir;
+  int goal;
+
+  // rebuild in progress
+  std::vector<Uint16> buildDist;
+  std::vector<Uint8> buildDir;
+  std::vector<int> queue;
+  int queueHead;
+  int buildGoal;
+  int pendingGoal;
+
+  // walls changed during the rebuild in progress
+  bool stale;
+
+  int rebuilds;
+};
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <vector>
+
+// linear allocator for things that only live until the end of the frame
+// (formatted text, draw lists, collision candidates...)
+// Reset() at the start of every frame gives all of it back at once; the
+// buffer is sized at startup (Reserve before the first frame, since growing
+// moves it) and never grows after, so a frame that asks for too much gets
+// NULL and the overflow is counted rather than hitting the heap
+class LFrameArena {
+public:
+  LFrameArena(size_t capacity = 0) {
+    used = 0;
+    peak = 0;
+    overflows = 0;
+
+    Reserve(capacity);
+  }
+
+  void Reserve(size_t capacity) {
+    if (capacity > data.size()) {
+      data.resize(capacity);
+    }
+  }
+
+  void Reset() {
+    used = 0;
+  }
+
+  // NULL if it doesn't fit
+  void *Alloc(size_t size, size_t align = alignof(max_align_t)) {
+    size_t start = (used + align - 1) & ~(align - 1);
+
+    if (start + size > data.size()) {
+      overflows++;
+      return NULL;
+    }
+
+    used = start + size;
+    if (used > peak) {
+      peak = used;
+    }
+
+    return &data[start];
+  }
+
+  template <typename T> T *AllocArray(size_t n) {
+    return (T *)Alloc(n * sizeof(T), alignof(T));
+  }
+
+  // formatted string in the arena; NULL if it doesn't fit
+  char *Printf(const char *fmt, ...) {
+    size_t room = data.size() - used;
+
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf((char *)data.data() + used, room, fmt, args);
+    va_end(args);
+
+    if (n < 0 || (size_t)n >= room) {
+      overflows++;
+      return NULL;
+    }
+
+    return (char *)Alloc(n + 1, 1);
+  }
+
+  size_t GetUsed() { return used; }
+
+  // most used in any frame since startup
+  size_t GetPeak() { return peak; }
+
+  size_t GetCapacity() { return data.size(); }
+
+  int GetOverflows() { return overflows; }
+
+private:
+  std::vector<Uint8> data;
+  size_t used;
+  size_t peak;
+  int overflows;
+};
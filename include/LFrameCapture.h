@@ -0,0 +1,426 @@
+#pragma once
+
+#include "LHistogram.h"
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <stdio.h>
+#include <thread>
+#include <vector>
+
+// screenshots and frame recording without encoding on the main thread
+// the main thread reads the back buffer into one of a few preallocated
+// buffers and queues it; a worker encodes it (png) or converts and appends
+// it to a y4m file, then hands the buffer back
+// if every buffer is still queued the frame is dropped and counted, the
+// loop never waits on the worker
+//
+// usage, after drawing and before SDL_RenderPresent:
+//   capture.Screenshot(renderer, "shot.png");
+//   if (capture.IsRecording()) capture.CaptureFrame(renderer);
+class LFrameCapture {
+public:
+  LFrameCapture() : readbackTimes(0.05f), encodeTimes(0.5f) {
+    width = 0;
+    height = 0;
+    running = false;
+    recording = false;
+    recordFps = 0;
+
+    queueHead = 0;
+    queueCount = 0;
+
+    recordFile = NULL;
+
+    captured = 0;
+    dropped = 0;
+    failed = 0;
+  }
+
+  ~LFrameCapture() { Stop(); }
+
+  // buffers are rgba, one frame each
+  bool Start(int width, int height, int nBuffers = 4) {
+    if (running) {
+      return true;
+    }
+
+    this->width = width;
+    this->height = height;
+
+    buffers.resize(nBuffers);
+    freeBuffers.clear();
+    for (int i = 0; i < nBuffers; ++i) {
+      buffers[i].resize((size_t)width * height * 4);
+      freeBuffers.push_back(i);
+    }
+
+    // recording end markers don't hold a buffer, so leave room for them
+    queue.resize(nBuffers * 2);
+    queueHead = 0;
+    queueCount = 0;
+
+    yuv.resize((size_t)width * height + 2 * ChromaSize());
+
+    running = true;
+    worker = std::thread(&LFrameCapture::Work, this);
+
+    return true;
+  }
+
+  // finishes everything queued, closes any recording, joins the worker
+  void Stop() {
+    if (!running) {
+      return;
+    }
+
+    StopRecording();
+
+    {
+      std::lock_guard<std::mutex> lock(mtx);
+      running = false;
+    }
+
+    cv.notify_one();
+    worker.join();
+  }
+
+  // false if the frame was dropped
+  bool Screenshot(SDL_Renderer *renderer, const char *path) {
+    return Capture(renderer, JOB_PNG, path);
+  }
+
+  // frames go to path as they're captured; the file is opened by the worker
+  void StartRecording(const char *path, int fps) {
+    if (!running || recording) {
+      return;
+    }
+
+    recording = true;
+    recordFps = fps;
+    snprintf(recordPath, sizeof(recordPath), "%s", path);
+    recordStarted = false;
+  }
+
+  void StopRecording() {
+    if (!recording) {
+      return;
+    }
+
+    recording = false;
+
+    std::lock_guard<std::mutex> lock(mtx);
+    Job job = {JOB_Y4M_END, -1, ""};
+    Push(job);
+    cv.notify_one();
+  }
+
+  bool IsRecording() { return recording; }
+
+  // false if the frame was dropped
+  bool CaptureFrame(SDL_Renderer *renderer) {
+    if (!recording) {
+      return false;
+    }
+
+    // the first frame carries the path, so the worker knows to open it
+    bool ok = Capture(renderer, recordStarted ? JOB_Y4M_FRAME : JOB_Y4M_START,
+                      recordPath);
+    if (ok) {
+      recordStarted = true;
+    }
+
+    return ok;
+  }
+
+  // bytes held by the frame buffers and the worker's yuv scratch
+  size_t GetMemoryUsage() {
+    size_t bytes = yuv.capacity();
+    for (size_t i = 0; i < buffers.size(); ++i) {
+      bytes += buffers[i].capacity();
+    }
+
+    return bytes;
+  }
+
+  bool IsRunning() { return running; }
+
+  int GetCaptured() { return captured; }
+
+  int GetDropped() { return dropped; }
+
+  void PrintStats() {
+    std::lock_guard<std::mutex> lock(mtx);
+
+    printf("capture: %d frames captured, %d dropped, %d failed writes\n",
+           captured, dropped, failed);
+    readbackTimes.Print("capture readback");
+    encodeTimes.Print("capture encode");
+  }
+
+private:
+  typedef enum JobKind {
+    JOB_PNG,
+    JOB_Y4M_START,
+    JOB_Y4M_FRAME,
+    JOB_Y4M_END
+  } JobKind;
+
+  struct Job {
+    JobKind kind;
+    int buffer;
+    char path[256];
+  };
+
+  size_t ChromaSize() { return (size_t)((width + 1) / 2) * ((height + 1) / 2); }
+
+  bool Capture(SDL_Renderer *renderer, JobKind kind, const char *path) {
+    if (!running) {
+      return false;
+    }
+
+    int buffer;
+    {
+      std::lock_guard<std::mutex> lock(mtx);
+
+      if (freeBuffers.empty() || queueCount == (int)queue.size()) {
+        dropped++;
+        return false;
+      }
+
+      buffer = freeBuffers.back();
+      freeBuffers.pop_back();
+    }
+
+    // the only part the frame pays for
+    auto start = std::chrono::high_resolution_clock::now();
+    int result = SDL_RenderReadPixels(renderer, NULL, SDL_PIXELFORMAT_RGBA32,
+                                      buffers[buffer].data(), width * 4);
+    float readbackMs =
+        std::chrono::duration<float, std::chrono::milliseconds::period>(
+            std::chrono::high_resolution_clock::now() - start)
+            .count();
+
+    std::lock_guard<std::mutex> lock(mtx);
+    readbackTimes.Add(readbackMs);
+
+    if (result != 0) {
+      printf("Unable to read frame: %s\n", SDL_GetError());
+      freeBuffers.push_back(buffer);
+      failed++;
+      return false;
+    }
+
+    Job job;
+    job.kind = kind;
+    job.buffer = buffer;
+    snprintf(job.path, sizeof(job.path), "%s", path);
+
+    Push(job);
+    captured++;
+    cv.notify_one();
+
+    return true;
+  }
+
+  // under mtx; callers make sure there's room
+  void Push(const Job &job) {
+    if (queueCount == (int)queue.size()) {
+      return;
+    }
+
+    queue[(queueHead + queueCount) % queue.size()] = job;
+    queueCount++;
+  }
+
+  void Work() {
+    std::unique_lock<std::mutex> lock(mtx);
+
+    while (true) {
+      cv.wait(lock, [this] { return queueCount > 0 || !running; });
+
+      if (queueCount == 0) {
+        // stopped with nothing left to write
+        break;
+      }
+
+      Job job = queue[queueHead];
+      queueHead = (queueHead + 1) % queue.size();
+      queueCount--;
+
+      lock.unlock();
+
+      auto start = std::chrono::high_resolution_clock::now();
+      bool ok = Process(job);
+      float encodeMs =
+          std::chrono::duration<float, std::chrono::milliseconds::period>(
+              std::chrono::high_resolution_clock::now() - start)
+              .count();
+
+      lock.lock();
+
+      if (job.buffer >= 0) {
+        freeBuffers.push_back(job.buffer);
+        encodeTimes.Add(encodeMs);
+      }
+
+      if (!ok) {
+        failed++;
+      }
+    }
+
+    // stopped mid recording
+    CloseRecording();
+  }
+
+  // worker thread
+  bool Process(const Job &job) {
+    switch (job.kind) {
+    case JOB_PNG:
+      return WritePng(job);
+    case JOB_Y4M_START:
+      if (!OpenRecording(job.path)) {
+        return false;
+      }
+      return WriteY4mFrame(job);
+    case JOB_Y4M_FRAME:
+      return WriteY4mFrame(job);
+    case JOB_Y4M_END:
+      CloseRecording();
+      return true;
+    default:
+      return false;
+    }
+  }
+
+  bool WritePng(const Job &job) {
+    SDL_Surface *surf = SDL_CreateRGBSurfaceWithFormatFrom(
+        buffers[job.buffer].data(), width, height, 32, width * 4,
+        SDL_PIXELFORMAT_RGBA32);
+    if (surf == NULL) {
+      printf("Unable to wrap frame: %s\n", SDL_GetError());
+      return false;
+    }
+
+    bool ok = IMG_SavePNG(surf, job.path) == 0;
+    if (!ok) {
+      printf("Unable to save %s: %s\n", job.path, SDL_GetError());
+    }
+
+    SDL_FreeSurface(surf);
+    return ok;
+  }
+
+  bool OpenRecording(const char *path) {
+    CloseRecording();
+
+    recordFile = SDL_RWFromFile(path, "wb");
+    if (recordFile == NULL) {
+      printf("Unable to open %s: %s\n", path, SDL_GetError());
+      return false;
+    }
+
+    // C420jpeg: full range bt.601, chroma centered in each 2x2 block
+    char header[128];
+    int n = snprintf(header, sizeof(header),
+                     "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n", width,
+                     height, recordFps);
+
+    return SDL_RWwrite(recordFile, header, n, 1) == 1;
+  }
+
+  void CloseRecording() {
+    if (recordFile != NULL) {
+      SDL_RWclose(recordFile);
+      recordFile = NULL;
+    }
+  }
+
+  bool WriteY4mFrame(const Job &job) {
+    // frames after a failed open have nowhere to go
+    if (recordFile == NULL) {
+      return false;
+    }
+
+    const Uint8 *rgba = buffers[job.buffer].data();
+    Uint8 *yPlane = yuv.data();
+    Uint8 *uPlane = yPlane + (size_t)width * height;
+    Uint8 *vPlane = uPlane + ChromaSize();
+    int chromaW = (width + 1) / 2;
+
+    for (int y = 0; y < height; ++y) {
+      const Uint8 *row = rgba + (size_t)y * width * 4;
+      Uint8 *yRow = yPlane + (size_t)y * width;
+
+      for (int x = 0; x < width; ++x) {
+        int r = row[x * 4], g = row[x * 4 + 1], b = row[x * 4 + 2];
+        yRow[x] = (Uint8)((77 * r + 150 * g + 29 * b + 128) >> 8);
+      }
+    }
+
+    // chroma from the average of each 2x2 block
+    for (int cy = 0; cy < (height + 1) / 2; ++cy) {
+      for (int cx = 0; cx < chromaW; ++cx) {
+        int r = 0, g = 0, b = 0, n = 0;
+
+        for (int y = cy * 2; y < SDL_min(cy * 2 + 2, height); ++y) {
+          for (int x = cx * 2; x < SDL_min(cx * 2 + 2, width); ++x) {
+            const Uint8 *p = rgba + ((size_t)y * width + x) * 4;
+            r += p[0];
+            g += p[1];
+            b += p[2];
+            n++;
+          }
+        }
+
+        r /= n;
+        g /= n;
+        b /= n;
+
+        int u = ((-43 * r - 85 * g + 128 * b + 128) >> 8) + 128;
+        int v = ((128 * r - 107 * g - 21 * b + 128) >> 8) + 128;
+
+        uPlane[cy * chromaW + cx] = (Uint8)SDL_max(0, SDL_min(u, 255));
+        vPlane[cy * chromaW + cx] = (Uint8)SDL_max(0, SDL_min(v, 255));
+      }
+    }
+
+    static const char FRAME[] = "FRAME\n";
+    return SDL_RWwrite(recordFile, FRAME, sizeof(FRAME) - 1, 1) == 1 &&
+           SDL_RWwrite(recordFile, yuv.data(), yuv.size(), 1) == 1;
+  }
+
+  int width;
+  int height;
+
+  // main thread only
+  bool recording;
+  bool recordStarted;
+  int recordFps;
+  char recordPath[256];
+
+  // shared with the worker, under mtx
+  std::thread worker;
+  std::mutex mtx;
+  std::condition_variable cv;
+  bool running;
+  std::vector<int> freeBuffers;
+  std::vector<Job> queue;
+  int queueHead;
+  int queueCount;
+
+  int captured;
+  int dropped;
+  int failed;
+  LHistogram readbackTimes;
+  LHistogram encodeTimes;
+
+  // buffers are owned by whoever holds their index; yuv and the file are
+  // worker only
+  std::vector<std::vector<Uint8>> buffers;
+  std::vector<Uint8> yuv;
+  SDL_RWops *recordFile;
+};
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <string.h>
+#include <vector>
+
+// text with a hole at the cursor
+// inserting or deleting at the gap is a memcpy of just the new text; moving
+// the gap costs the distance moved, which for typing is nothing and for
+// clicking around is at most the text between the two spots
+// positions are byte offsets into the text as if the gap weren't there
+class LGapBuffer {
+public:
+  LGapBuffer(size_t capacity = 64) {
+    data.resize(capacity);
+    gapStart = 0;
+    gapEnd = capacity;
+  }
+
+  size_t Length() { return data.size() - (gapEnd - gapStart); }
+
+  char At(size_t pos) {
+    return pos < gapStart ? data[pos] : data[pos + (gapEnd - gapStart)];
+  }
+
+  void Insert(size_t pos, const char *text, size_t n) {
+    MoveGap(pos);
+
+    if (n > gapEnd - gapStart) {
+      Grow(n);
+    }
+
+    memcpy(data.data() + gapStart, text, n);
+    gapStart += n;
+  }
+
+  void Erase(size_t pos, size_t n) {
+    MoveGap(pos);
+    gapEnd += n;
+  }
+
+  void Clear() {
+    gapStart = 0;
+    gapEnd = data.size();
+  }
+
+  // n bytes from pos into dst (no terminator)
+  void Copy(size_t pos, size_t n, char *dst) {
+    // part before the gap
+    if (pos < gapStart) {
+      size_t before = gapStart - pos < n ? gapStart - pos : n;
+      memcpy(dst, data.data() + pos, before);
+
+      dst += before;
+      pos += before;
+      n -= before;
+    }
+
+    if (n > 0) {
+      memcpy(dst, data.data() + (pos + (gapEnd - gapStart)), n);
+    }
+  }
+
+  size_t GetCapacity() { return data.size(); }
+
+private:
+  void MoveGap(size_t pos) {
+    if (pos < gapStart) {
+      // text between pos and the gap slides to the gap's end
+      size_t n = gapStart - pos;
+      memmove(data.data() + (gapEnd - n), data.data() + pos, n);
+      gapStart -= n;
+      gapEnd -= n;
+    }
+
+    else if (pos > gapStart) {
+      size_t n = pos - gapStart;
+      memmove(data.data() + gapStart, data.data() + gapEnd, n);
+      gapStart += n;
+      gapEnd += n;
+    }
+  }
+
+  // at least double, so repeated inserts stay amortized constant
+  void Grow(size_t needed) {
+    size_t oldSize = data.size();
+    size_t after = oldSize - gapEnd;
+
+    size_t newSize = oldSize * 2;
+    if (newSize < Length() + needed) {
+      newSize = Length() + needed;
+    }
+
+    data.resize(newSize);
+
+    // text after the gap moves to the new end
+    memmove(data.data() + (newSize - after), data.data() + gapEnd, after);
+    gapEnd = newSize - after;
+  }
+
+  std::vector<char> data;
+  size_t gapStart;
+  size_t gapEnd;
+};
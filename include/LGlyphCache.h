@@ -0,0 +1,125 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+#include <stdio.h>
+
+// printable ascii pre-rendered into one texture, so text that changes every
+// frame is just a RenderCopy per character instead of a new surface and
+// texture each time
+// glyph positions come from measuring prefixes of the atlas string, which
+// keeps any spacing the font applies between characters
+class LGlyphCache {
+public:
+  LGlyphCache() {
+    texture = NULL;
+    height = 0;
+  }
+
+  ~LGlyphCache() { Free(); }
+
+  bool Build(SDL_Renderer *renderer, TTF_Font *font, SDL_Color color) {
+    Free();
+
+    char chars[GLYPH_COUNT + 1];
+    for (int i = 0; i < GLYPH_COUNT; ++i) {
+      chars[i] = (char)(FIRST_GLYPH + i);
+    }
+
+    chars[GLYPH_COUNT] = '\0';
+
+    SDL_Surface *surf = TTF_RenderText_Solid(font, chars, color);
+    if (surf == NULL) {
+      printf("Unable to render glyphs: %s\n", TTF_GetError());
+      return false;
+    }
+
+    texture = SDL_CreateTextureFromSurface(renderer, surf);
+    height = surf->h;
+    SDL_FreeSurface(surf);
+
+    if (texture == NULL) {
+      printf("Unable to make glyph texture: %s\n", SDL_GetError());
+      return false;
+    }
+
+    // x of glyph i is the width of the first i characters
+    int prev = 0;
+    for (int i = 0; i < GLYPH_COUNT; ++i) {
+      char saved = chars[i + 1];
+      chars[i + 1] = '\0';
+
+      int w, h;
+      TTF_SizeText(font, chars, &w, &h);
+      chars[i + 1] = saved;
+
+      glyphs[i].x = prev;
+      glyphs[i].y = 0;
+      glyphs[i].w = w - prev;
+      glyphs[i].h = height;
+
+      prev = w;
+    }
+
+    return true;
+  }
+
+  void Free() {
+    if (texture != NULL) {
+      SDL_DestroyTexture(texture);
+      texture = NULL;
+    }
+  }
+
+  // returns the width drawn; characters outside the atlas are skipped
+  int Render(SDL_Renderer *renderer, const char *text, int x, int y) {
+    int startX = x;
+
+    for (const char *c = text; *c != '\0'; ++c) {
+      SDL_Rect *src = Find(*c);
+      if (src == NULL) {
+        continue;
+      }
+
+      SDL_Rect dst = {x, y, src->w, src->h};
+      SDL_RenderCopy(renderer, texture, src, &dst);
+      x += src->w;
+    }
+
+    return x - startX;
+  }
+
+  int Measure(const char *text) {
+    int w = 0;
+
+    for (const char *c = text; *c != '\0'; ++c) {
+      SDL_Rect *src = Find(*c);
+      if (src != NULL) {
+        w += src->w;
+      }
+    }
+
+    return w;
+  }
+
+  int GetHeight() { return height; }
+
+  SDL_Texture *GetTexture() { return texture; }
+
+private:
+  static const int FIRST_GLYPH = 32;
+  static const int GLYPH_COUNT = 127 - FIRST_GLYPH;
+
+  SDL_Rect *Find(char c) {
+    int i = (unsigned char)c - FIRST_GLYPH;
+    if (i < 0 || i >= GLYPH_COUNT) {
+      return NULL;
+    }
+
+    return &glyphs[i];
+  }
+
+  SDL_Texture *texture;
+  SDL_Rect glyphs[GLYPH_COUNT];
+  int height;
+};
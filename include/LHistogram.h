@@ -0,0 +1,90 @@
+#pragma once
+
+#include <stdio.h>
+#include <vector>
+
+// fixed-width bucket histogram for timings in ms
+// buckets are linear so percentiles are exact to within one bucket width,
+// anything past the last bucket is lumped into it (but max is still exact)
+class LHistogram {
+public:
+  LHistogram(float bucketWidth = 0.05f, int nBuckets = 2000) {
+    this->bucketWidth = bucketWidth;
+    buckets.assign(nBuckets, 0);
+
+    Reset();
+  }
+
+  void Reset() {
+    for (int i = 0; i < (int)buckets.size(); ++i) {
+      buckets[i] = 0;
+    }
+
+    count = 0;
+    sum = 0;
+    max = 0;
+  }
+
+  void Add(float ms) {
+    if (ms < 0) {
+      ms = 0;
+    }
+
+    int b = (int)(ms / bucketWidth);
+
+    if (b >= (int)buckets.size()) {
+      b = buckets.size() - 1;
+    }
+
+    buckets[b]++;
+
+    count++;
+    sum += ms;
+
+    if (ms > max) {
+      max = ms;
+    }
+  }
+
+  int GetCount() { return count; }
+
+  float GetMax() { return max; }
+
+  float GetMean() { return count > 0 ? sum / count : 0; }
+
+  // p in [0, 1]; returns upper edge of the bucket the percentile lands in
+  float Percentile(float p) {
+    if (count == 0) {
+      return 0;
+    }
+
+    long target = (long)(p * count);
+    long seen = 0;
+
+    for (int i = 0; i < (int)buckets.size(); ++i) {
+      seen += buckets[i];
+
+      if (seen > target) {
+        float edge = (i + 1) * bucketWidth;
+        return edge < max ? edge : max;
+      }
+    }
+
+    return max;
+  }
+
+  void Print(const char *label) {
+    printf("%-16s n=%-7d mean=%7.3f p50=%7.3f p90=%7.3f p99=%7.3f max=%7.3f "
+           "(ms)\n",
+           label, count, GetMean(), Percentile(0.5f), Percentile(0.9f),
+           Percentile(0.99f), max);
+  }
+
+private:
+  std::vector<int> buckets;
+  float bucketWidth;
+
+  int count;
+  double sum;
+  float max;
+};
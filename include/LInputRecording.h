@@ -0,0 +1,437 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <SDL_rwops.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+// input recording file, little endian:
+//   header: Uint32 magic, Uint32 version, float fps (as Uint32 bits)
+//   records: Uint8 type, varint frame delta, varint timestamp delta, payload
+// payload per type:
+//   key down/up:   varint scancode, varint keycode, varint mod, Uint8 repeat
+//   text input:    varint length, bytes
+//   mouse motion:  varint state, zigzag x, zigzag y, zigzag xrel, zigzag yrel
+//   mouse button:  Uint8 button, Uint8 clicks, zigzag x, zigzag y
+//   quit:          nothing
+//   clipboard:     varint length, bytes (what a paste read at record time)
+//   end:           nothing; marks the last recorded frame
+// frames are main loop iterations, so a replay feeds each event back on the
+// same frame it was polled on
+
+const Uint32 INPUT_MAGIC = 0x31504E49; // "INP1"
+const Uint32 INPUT_VERSION = 1;
+
+typedef enum InputRecordType {
+  INPUT_RECORD_KEYDOWN,
+  INPUT_RECORD_KEYUP,
+  INPUT_RECORD_TEXT,
+  INPUT_RECORD_MOUSEMOTION,
+  INPUT_RECORD_MOUSEDOWN,
+  INPUT_RECORD_MOUSEUP,
+  INPUT_RECORD_QUIT,
+  INPUT_RECORD_CLIPBOARD,
+  INPUT_RECORD_END
+} InputRecordType;
+
+class LInputRecorder {
+public:
+  LInputRecorder() {
+    file = NULL;
+    lastFrame = 0;
+    lastTimestamp = 0;
+  }
+
+  ~LInputRecorder() { Close(0); }
+
+  bool Open(const char *path, float fps) {
+    file = SDL_RWFromFile(path, "wb");
+    if (file == NULL) {
+      printf("Unable to open input recording: %s\n", SDL_GetError());
+      return false;
+    }
+
+    Uint32 fpsBits;
+    memcpy(&fpsBits, &fps, 4);
+
+    SDL_WriteLE32(file, INPUT_MAGIC);
+    SDL_WriteLE32(file, INPUT_VERSION);
+    SDL_WriteLE32(file, fpsBits);
+
+    lastFrame = 0;
+    lastTimestamp = 0;
+
+    return true;
+  }
+
+  bool IsOpen() { return file != NULL; }
+
+  // events we don't replay (window, audio device...) are skipped
+  void Record(Uint32 frame, const SDL_Event &e) {
+    if (file == NULL) {
+      return;
+    }
+
+    switch (e.type) {
+    case SDL_KEYDOWN:
+    case SDL_KEYUP:
+      Header(e.type == SDL_KEYDOWN ? INPUT_RECORD_KEYDOWN : INPUT_RECORD_KEYUP,
+             frame, e.key.timestamp);
+      PushVarint(e.key.keysym.scancode);
+      PushVarint((Uint32)e.key.keysym.sym);
+      PushVarint(e.key.keysym.mod);
+      buffer.push_back(e.key.repeat);
+      break;
+
+    case SDL_TEXTINPUT:
+      Header(INPUT_RECORD_TEXT, frame, e.text.timestamp);
+      PushBytes(e.text.text, strlen(e.text.text));
+      break;
+
+    case SDL_MOUSEMOTION:
+      Header(INPUT_RECORD_MOUSEMOTION, frame, e.motion.timestamp);
+      PushVarint(e.motion.state);
+      PushZigzag(e.motion.x);
+      PushZigzag(e.motion.y);
+      PushZigzag(e.motion.xrel);
+      PushZigzag(e.motion.yrel);
+      break;
+
+    case SDL_MOUSEBUTTONDOWN:
+    case SDL_MOUSEBUTTONUP:
+      Header(e.type == SDL_MOUSEBUTTONDOWN ? INPUT_RECORD_MOUSEDOWN
+                                           : INPUT_RECORD_MOUSEUP,
+             frame, e.button.timestamp);
+      buffer.push_back(e.button.button);
+      buffer.push_back(e.button.clicks);
+      PushZigzag(e.button.x);
+      PushZigzag(e.button.y);
+      break;
+
+    case SDL_QUIT:
+      Header(INPUT_RECORD_QUIT, frame, e.common.timestamp);
+      break;
+    }
+
+    FlushIfFull();
+  }
+
+  // clipboard contents are outside input, but pastes depend on them
+  void RecordClipboard(Uint32 frame, const char *text) {
+    if (file == NULL) {
+      return;
+    }
+
+    Header(INPUT_RECORD_CLIPBOARD, frame, lastTimestamp);
+    PushBytes(text, strlen(text));
+
+    FlushIfFull();
+  }
+
+  // writes the end marker so replay runs exactly as many frames
+  void Close(Uint32 lastFrame) {
+    if (file == NULL) {
+      return;
+    }
+
+    Header(INPUT_RECORD_END, lastFrame, lastTimestamp);
+    Flush();
+
+    SDL_RWclose(file);
+    file = NULL;
+  }
+
+private:
+  // written in chunks so recording doesn't hit the disk every frame
+  static const size_t FLUSH_BYTES = 64 * 1024;
+
+  void Header(InputRecordType type, Uint32 frame, Uint32 timestamp) {
+    buffer.push_back(type);
+    PushVarint(frame - lastFrame);
+    PushVarint(timestamp - lastTimestamp);
+
+    lastFrame = frame;
+    lastTimestamp = timestamp;
+  }
+
+  void PushVarint(Uint32 v) {
+    while (v >= 0x80) {
+      buffer.push_back((Uint8)(v | 0x80));
+      v >>= 7;
+    }
+
+    buffer.push_back((Uint8)v);
+  }
+
+  // small negative numbers stay small
+  void PushZigzag(Sint32 v) {
+    PushVarint(((Uint32)v << 1) ^ (Uint32)(v >> 31));
+  }
+
+  void PushBytes(const char *s, size_t n) {
+    PushVarint(n);
+    buffer.insert(buffer.end(), s, s + n);
+  }
+
+  void FlushIfFull() {
+    if (buffer.size() >= FLUSH_BYTES) {
+      Flush();
+    }
+  }
+
+  void Flush() {
+    if (!buffer.empty() &&
+        SDL_RWwrite(file, buffer.data(), buffer.size(), 1) != 1) {
+      printf("Unable to write input recording: %s\n", SDL_GetError());
+    }
+
+    buffer.clear();
+  }
+
+  SDL_RWops *file;
+  std::vector<Uint8> buffer;
+
+  Uint32 lastFrame;
+  Uint32 lastTimestamp;
+};
+
+class LInputReplay {
+public:
+  LInputReplay() {
+    pos = 0;
+    pendingType = INPUT_RECORD_END;
+    nextFrame = 0;
+    timestamp = 0;
+    endFrame = 0;
+    fps = 0;
+    loaded = false;
+    finished = false;
+  }
+
+  bool Load(const char *path) {
+    SDL_RWops *file = SDL_RWFromFile(path, "rb");
+    if (file == NULL) {
+      printf("Unable to open input replay: %s\n", SDL_GetError());
+      return false;
+    }
+
+    Sint64 size = SDL_RWsize(file);
+
+    bool ok = size >= 12 && SDL_ReadLE32(file) == INPUT_MAGIC &&
+              SDL_ReadLE32(file) == INPUT_VERSION;
+
+    if (ok) {
+      Uint32 fpsBits = SDL_ReadLE32(file);
+      memcpy(&fps, &fpsBits, 4);
+
+      // the replay steps at 1 / fps, so a bad rate would divide by zero or
+      // stall; written as !(in range) so nan fails too
+      if (!(fps > 0 && fps <= 10000)) {
+        printf("%s has a bad frame rate: %g\n", path, fps);
+        SDL_RWclose(file);
+        return false;
+      }
+
+      data.resize(size - 12);
+      if (!data.empty() && SDL_RWread(file, data.data(), data.size(), 1) != 1) {
+        ok = false;
+      }
+    }
+
+    SDL_RWclose(file);
+
+    if (!ok) {
+      printf("%s is not an input recording\n", path);
+      return false;
+    }
+
+    pos = 0;
+    nextFrame = 0;
+    timestamp = 0;
+    loaded = true;
+    finished = false;
+
+    ReadHeader();
+
+    return true;
+  }
+
+  bool IsLoaded() { return loaded; }
+
+  // fps the recording was simulated at
+  float GetFPS() { return fps; }
+
+  // true once the end marker's frame has been reached
+  bool IsFinished(Uint32 frame) {
+    return finished && frame >= endFrame;
+  }
+
+  // next recorded event for this frame; false when there are no more
+  bool Poll(Uint32 frame, SDL_Event *e) {
+    while (!finished && nextFrame <= frame) {
+      Uint8 type = pendingType;
+      bool isEvent = Decode(type, e);
+
+      ReadHeader();
+
+      if (isEvent) {
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  // text a paste read while recording; must be called right after the paste
+  // key event was polled, which is where the recorder put it
+  const char *TakeClipboard() {
+    if (finished || pendingType != INPUT_RECORD_CLIPBOARD) {
+      return "";
+    }
+
+    Uint32 n = ReadVarint();
+    if (pos + n <= data.size()) {
+      clipboard.assign((const char *)data.data() + pos, n);
+    }
+
+    else {
+      clipboard.clear();
+    }
+
+    pos += n;
+
+    ReadHeader();
+
+    return clipboard.c_str();
+  }
+
+private:
+  // reads the type + frame of the next record, so Poll knows when it's due
+  void ReadHeader() {
+    if (pos >= data.size()) {
+      finished = true;
+      endFrame = nextFrame;
+      return;
+    }
+
+    pendingType = data[pos++];
+    nextFrame += ReadVarint();
+    timestamp += ReadVarint();
+
+    if (pendingType == INPUT_RECORD_END) {
+      finished = true;
+      endFrame = nextFrame;
+    }
+  }
+
+  // returns false for records that aren't events (stray clipboard data)
+  bool Decode(Uint8 type, SDL_Event *e) {
+    memset(e, 0, sizeof(SDL_Event));
+
+    switch (type) {
+    case INPUT_RECORD_KEYDOWN:
+    case INPUT_RECORD_KEYUP:
+      e->type = type == INPUT_RECORD_KEYDOWN ? SDL_KEYDOWN : SDL_KEYUP;
+      e->key.timestamp = timestamp;
+      e->key.state = type == INPUT_RECORD_KEYDOWN ? SDL_PRESSED : SDL_RELEASED;
+      e->key.keysym.scancode = (SDL_Scancode)ReadVarint();
+      e->key.keysym.sym = (SDL_Keycode)ReadVarint();
+      e->key.keysym.mod = ReadVarint();
+      e->key.repeat = ReadU8();
+      return true;
+
+    case INPUT_RECORD_TEXT: {
+      e->type = SDL_TEXTINPUT;
+      e->text.timestamp = timestamp;
+
+      Uint32 n = ReadVarint();
+      Uint32 kept = n < sizeof(e->text.text) ? n : sizeof(e->text.text) - 1;
+      if (pos + n <= data.size()) {
+        memcpy(e->text.text, &data[pos], kept);
+      }
+
+      pos += n;
+      return true;
+    }
+
+    case INPUT_RECORD_MOUSEMOTION:
+      e->type = SDL_MOUSEMOTION;
+      e->motion.timestamp = timestamp;
+      e->motion.state = ReadVarint();
+      e->motion.x = ReadZigzag();
+      e->motion.y = ReadZigzag();
+      e->motion.xrel = ReadZigzag();
+      e->motion.yrel = ReadZigzag();
+      return true;
+
+    case INPUT_RECORD_MOUSEDOWN:
+    case INPUT_RECORD_MOUSEUP:
+      e->type = type == INPUT_RECORD_MOUSEDOWN ? SDL_MOUSEBUTTONDOWN
+                                               : SDL_MOUSEBUTTONUP;
+      e->button.timestamp = timestamp;
+      e->button.state =
+          type == INPUT_RECORD_MOUSEDOWN ? SDL_PRESSED : SDL_RELEASED;
+      e->button.button = ReadU8();
+      e->button.clicks = ReadU8();
+      e->button.x = ReadZigzag();
+      e->button.y = ReadZigzag();
+      return true;
+
+    case INPUT_RECORD_QUIT:
+      e->type = SDL_QUIT;
+      e->common.timestamp = timestamp;
+      return true;
+
+    case INPUT_RECORD_CLIPBOARD:
+      // nobody asked for it; skip the payload
+      pos += ReadVarint();
+      return false;
+    }
+
+    printf("Unknown input record type %d, stopping replay\n", type);
+    finished = true;
+    endFrame = nextFrame;
+    return false;
+  }
+
+  Uint8 ReadU8() { return pos < data.size() ? data[pos++] : 0; }
+
+  Uint32 ReadVarint() {
+    Uint32 v = 0;
+    int shift = 0;
+
+    while (pos < data.size() && shift < 35) {
+      Uint8 b = data[pos++];
+      v |= (Uint32)(b & 0x7F) << shift;
+
+      if (!(b & 0x80)) {
+        break;
+      }
+
+      shift += 7;
+    }
+
+    return v;
+  }
+
+  Sint32 ReadZigzag() {
+    Uint32 v = ReadVarint();
+    return (Sint32)(v >> 1) ^ -(Sint32)(v & 1);
+  }
+
+  std::vector<Uint8> data;
+  size_t pos;
+
+  Uint8 pendingType;
+  Uint32 nextFrame;
+  Uint32 timestamp;
+  Uint32 endFrame;
+
+  std::string clipboard;
+
+  float fps;
+  bool loaded;
+  bool finished;
+};
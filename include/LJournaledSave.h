@@ -0,0 +1,388 @@
+#pragma once
+
+#include "LSaveFile.h"
+
+#include <SDL2/SDL.h>
+#include <SDL_rwops.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+// base savefile plus an append-only journal next to it (<path>.journal)
+// each Save() diffs against what's already on disk and appends only the
+// changed records, so write volume follows what changed instead of the
+// total save size; once the journal outgrows the base we compact it back
+// into a fresh base file
+//
+// journal layout (little endian):
+//   header: Uint32 magic, Uint32 generation, Uint32 record size
+//   commits: Uint32 total size, Uint32 run count,
+//            runs of (Uint32 first record, Uint32 record count, data),
+//            Uint32 checksum of the commit
+// generation must match the base file's; a journal left behind by a crash
+// mid-compaction has an older generation and is ignored
+// a torn commit at the tail fails its checksum and is dropped on load
+
+const Uint32 JOURNAL_MAGIC = 0x314E524A; // "JRN1"
+
+class LJournaledSave {
+public:
+  LJournaledSave(Uint32 recordSize = sizeof(Sint32)) {
+    this->recordSize = recordSize;
+
+    generation = 0;
+    journalSize = 0;
+
+    bytesWritten = 0;
+    commits = 0;
+    compactions = 0;
+  }
+
+  // reads base + journal into data (up to size bytes; the rest is zeroed)
+  // returns false if there is no usable base save
+  bool Load(const char *path, Uint8 *data, size_t size) {
+    SetPath(path);
+
+    memset(data, 0, size);
+
+    if (!ReadSaveFile(basePath.c_str(), persisted, &generation)) {
+      persisted.clear();
+      generation = 0;
+      return false;
+    }
+
+    bool clean = Replay();
+
+    size_t n = persisted.size() < size ? persisted.size() : size;
+    memcpy(data, persisted.data(), n);
+
+    // fold everything into a fresh base if the journal was stale or torn,
+    // otherwise later commits would land after the garbage
+    if (!clean) {
+      return Compact();
+    }
+
+    return true;
+  }
+
+  // sets where Save() writes without loading anything (new save)
+  void SetPath(const char *path) {
+    basePath = path;
+    journalPath = basePath + ".journal";
+  }
+
+  // persists data; appends changed records or compacts when due
+  bool Save(const Uint8 *data, size_t size) {
+    // size change, or nothing on disk yet; journal can't express that
+    if (size != persisted.size() || journalSize == 0) {
+      persisted.assign(data, data + size);
+      return Compact();
+    }
+
+    BuildCommit(data, size);
+
+    // nothing changed, nothing to write
+    if (commit.empty()) {
+      return true;
+    }
+
+    if (!AppendCommit()) {
+      return false;
+    }
+
+    commits++;
+
+    // journal has grown past the base; cheaper to rewrite the base now than
+    // to keep replaying all of it on load
+    if (journalSize > COMPACT_MIN_BYTES && journalSize > persisted.size()) {
+      return Compact();
+    }
+
+    return true;
+  }
+
+  // writes a fresh base with everything persisted so far and resets the
+  // journal; base is replaced first so a crash in between only leaves a
+  // stale journal behind, which Load() ignores
+  bool Compact() {
+    if (!WriteSaveFile(basePath.c_str(), generation + 1, persisted.data(),
+                       persisted.size(), scratch)) {
+      return false;
+    }
+
+    generation++;
+    bytesWritten += 16 + scratch.size();
+    compactions++;
+
+    SDL_RWops *file = SDL_RWFromFile(journalPath.c_str(), "wb");
+    if (file == NULL) {
+      printf("Unable to reset journal: %s\n", SDL_GetError());
+      journalSize = 0;
+      return false;
+    }
+
+    bool ok = SDL_WriteLE32(file, JOURNAL_MAGIC) == 1 &&
+              SDL_WriteLE32(file, generation) == 1 &&
+              SDL_WriteLE32(file, recordSize) == 1;
+
+    if (SDL_RWclose(file) != 0) {
+      ok = false;
+    }
+
+    journalSize = ok ? 12 : 0;
+    bytesWritten += 12;
+
+    return ok;
+  }
+
+  size_t GetBytesWritten() { return bytesWritten; }
+
+  int GetCommits() { return commits; }
+
+  int GetCompactions() { return compactions; }
+
+private:
+  static const size_t COMPACT_MIN_BYTES = 4096;
+
+  // applies journal commits on top of persisted
+  // returns false if the journal had to be (partly) discarded
+  bool Replay() {
+    journalSize = 0;
+
+    SDL_RWops *file = SDL_RWFromFile(journalPath.c_str(), "rb");
+    if (file == NULL) {
+      // no journal yet; fine, but we need a header before appending
+      return false;
+    }
+
+    Sint64 fileSize = SDL_RWsize(file);
+
+    bool ok = fileSize >= 12 && SDL_ReadLE32(file) == JOURNAL_MAGIC &&
+              SDL_ReadLE32(file) == generation &&
+              SDL_ReadLE32(file) == recordSize;
+
+    if (!ok) {
+      SDL_RWclose(file);
+      printf("Ignoring stale save journal\n");
+      return false;
+    }
+
+    std::vector<Uint8> journal(fileSize - 12);
+    if (!journal.empty() &&
+        SDL_RWread(file, journal.data(), journal.size(), 1) != 1) {
+      journal.clear();
+      ok = false;
+    }
+
+    SDL_RWclose(file);
+
+    // each commit is checked before it's applied so a torn one can't
+    // half-apply
+    size_t pos = 0;
+    while (pos < journal.size()) {
+      size_t end = CheckCommit(journal, pos);
+
+      if (end == 0) {
+        printf("Save journal has a torn commit, dropping it\n");
+        ok = false;
+        break;
+      }
+
+      ApplyCommit(journal, pos);
+      pos = end;
+    }
+
+    journalSize = 12 + pos;
+
+    return ok;
+  }
+
+  // returns the offset after the commit at pos, or 0 if it's corrupt
+  size_t CheckCommit(const std::vector<Uint8> &journal, size_t pos) {
+    size_t start = pos;
+    Uint32 totalSize, runCount;
+
+    // Save() compacts whenever the size changes, so every commit in a valid
+    // journal has the base's size
+    if (!ReadU32(journal, pos, totalSize) || !ReadU32(journal, pos, runCount) ||
+        totalSize != persisted.size()) {
+      return 0;
+    }
+
+    for (Uint32 r = 0; r < runCount; ++r) {
+      Uint32 first, count;
+      if (!ReadU32(journal, pos, first) || !ReadU32(journal, pos, count)) {
+        return 0;
+      }
+
+      Uint64 bytes = RunBytes(first, count, totalSize);
+      if (bytes == 0 || pos + bytes > journal.size()) {
+        return 0;
+      }
+
+      pos += bytes;
+    }
+
+    Uint32 sum;
+    if (!ReadU32(journal, pos, sum) ||
+        sum != Checksum(journal.data() + start, pos - 4 - start)) {
+      return 0;
+    }
+
+    return pos;
+  }
+
+  // copies a commit that already passed CheckCommit() into persisted
+  void ApplyCommit(const std::vector<Uint8> &journal, size_t pos) {
+    Uint32 totalSize, runCount;
+    ReadU32(journal, pos, totalSize);
+    ReadU32(journal, pos, runCount);
+
+    for (Uint32 r = 0; r < runCount; ++r) {
+      Uint32 first, count;
+      ReadU32(journal, pos, first);
+      ReadU32(journal, pos, count);
+
+      Uint64 bytes = RunBytes(first, count, totalSize);
+      memcpy(persisted.data() + (size_t)first * recordSize,
+             journal.data() + pos, bytes);
+      pos += bytes;
+    }
+  }
+
+  // byte length of a run; the last record may be partial if the size isn't a
+  // multiple of recordSize, and 0 means the run is out of bounds
+  Uint64 RunBytes(Uint32 first, Uint32 count, Uint32 totalSize) {
+    Uint64 offset = (Uint64)first * recordSize;
+    Uint64 end = offset + (Uint64)count * recordSize;
+
+    if (count == 0 || offset >= totalSize) {
+      return 0;
+    }
+
+    return (end < totalSize ? end : totalSize) - offset;
+  }
+
+  // fills commit with runs of changed records and updates persisted
+  void BuildCommit(const Uint8 *data, size_t size) {
+    commit.clear();
+
+    Uint32 nRecords = (size + recordSize - 1) / recordSize;
+    Uint32 runCount = 0;
+
+    PushU32(commit, size);
+    PushU32(commit, 0); // run count, patched below
+
+    Uint32 r = 0;
+    while (r < nRecords) {
+      if (!RecordChanged(data, size, r)) {
+        r++;
+        continue;
+      }
+
+      Uint32 first = r;
+      while (r < nRecords && RecordChanged(data, size, r)) {
+        r++;
+      }
+
+      size_t offset = (size_t)first * recordSize;
+      size_t end = (size_t)r * recordSize < size ? r * recordSize : size;
+
+      PushU32(commit, first);
+      PushU32(commit, r - first);
+      commit.insert(commit.end(), data + offset, data + end);
+
+      memcpy(persisted.data() + offset, data + offset, end - offset);
+      runCount++;
+    }
+
+    if (runCount == 0) {
+      commit.clear();
+      return;
+    }
+
+    for (int i = 0; i < 4; ++i) {
+      commit[4 + i] = (Uint8)(runCount >> (8 * i));
+    }
+
+    PushU32(commit, Checksum(commit.data(), commit.size()));
+  }
+
+  bool RecordChanged(const Uint8 *data, size_t size, Uint32 r) {
+    size_t offset = (size_t)r * recordSize;
+    size_t n = offset + recordSize < size ? recordSize : size - offset;
+
+    return memcmp(data + offset, persisted.data() + offset, n) != 0;
+  }
+
+  bool AppendCommit() {
+    SDL_RWops *file = SDL_RWFromFile(journalPath.c_str(), "ab");
+    if (file == NULL) {
+      printf("Unable to open save journal: %s\n", SDL_GetError());
+      return false;
+    }
+
+    bool ok = SDL_RWwrite(file, commit.data(), commit.size(), 1) == 1;
+
+    if (SDL_RWclose(file) != 0) {
+      ok = false;
+    }
+
+    if (!ok) {
+      // the tail may now be torn; start over from a clean base
+      printf("Unable to append to save journal: %s\n", SDL_GetError());
+      return Compact();
+    }
+
+    journalSize += commit.size();
+    bytesWritten += commit.size();
+
+    return true;
+  }
+
+  // journal is little endian, like the SDL_WriteLE32 header fields
+  static void PushU32(std::vector<Uint8> &v, Uint32 x) {
+    Uint8 b[4] = {(Uint8)x, (Uint8)(x >> 8), (Uint8)(x >> 16),
+                  (Uint8)(x >> 24)};
+    v.insert(v.end(), b, b + 4);
+  }
+
+  static bool ReadU32(const std::vector<Uint8> &v, size_t &pos, Uint32 &x) {
+    if (pos + 4 > v.size()) {
+      return false;
+    }
+
+    x = v[pos] | v[pos + 1] << 8 | v[pos + 2] << 16 | (Uint32)v[pos + 3] << 24;
+    pos += 4;
+
+    return true;
+  }
+
+  // fnv-1a; catches torn writes, not meant to be cryptographic
+  static Uint32 Checksum(const Uint8 *p, size_t n) {
+    Uint32 h = 2166136261u;
+    for (size_t i = 0; i < n; ++i) {
+      h = (h ^ p[i]) * 16777619u;
+    }
+
+    return h;
+  }
+
+  std::string basePath;
+  std::string journalPath;
+
+  Uint32 recordSize;
+  Uint32 generation;
+  size_t journalSize; // 0 = no valid journal on disk yet
+
+  // what's on disk right now (base + journal)
+  std::vector<Uint8> persisted;
+
+  std::vector<Uint8> commit;
+  std::vector<Uint8> scratch;
+
+  size_t bytesWritten;
+  int commits;
+  int compactions;
+};
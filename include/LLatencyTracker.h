@@ -0,0 +1,125 @@
+#pragma once
+
+#include "LHistogram.h"
+
+#include <SDL2/SDL.h>
+
+typedef enum LLatencyAxis { LATENCY_AXIS_X, LATENCY_AXIS_Y } LLatencyAxis;
+
+// input-to-photon latency for movement input
+// an input is tagged when it's polled, waits until the simulation shows its
+// effect, and completes when that frame is presented; each input belongs to
+// one axis, and its effect is the player's movement along that axis
+// changing (starting, stopping or reversing), so a second key pressed into
+// a wall while another is held doesn't borrow the held key's movement
+// we keep two numbers:
+//   event -> present: from the SDL event timestamp (ms resolution), includes
+//                     time the event sat in SDL's queue before we polled it
+//   poll -> present:  from when we polled it (performance counter), which is
+//                     the part the main loop's ordering controls
+class LLatencyTracker {
+public:
+  LLatencyTracker() {
+    count = 0;
+    dropped = 0;
+    lastDx = 0;
+    lastDy = 0;
+  }
+
+  // eventTicks is the SDL timestamp (SDL_GetTicks() base)
+  void OnInput(Uint32 eventTicks, LLatencyAxis axis) {
+    // age out inputs that never showed an effect (blocked by a wall, press
+    // and release in the same frame...), so they don't sit in the table
+    ExpireOld();
+
+    if (count == MAX_PENDING) {
+      dropped++;
+      return;
+    }
+
+    Pending &p = pending[count++];
+    p.eventTicks = eventTicks;
+    p.pollCounter = SDL_GetPerformanceCounter();
+    p.axis = axis;
+    p.effected = false;
+  }
+
+  // the player's movement this simulation step; inputs on an axis whose
+  // movement differs from last step's are visible in this frame
+  void OnMove(int dx, int dy) {
+    bool changed[2] = {dx != lastDx, dy != lastDy};
+    lastDx = dx;
+    lastDy = dy;
+
+    for (int i = 0; i < count; ++i) {
+      if (changed[pending[i].axis]) {
+        pending[i].effected = true;
+      }
+    }
+  }
+
+  // call right after SDL_RenderPresent
+  void OnPresent() {
+    Uint32 nowTicks = SDL_GetTicks();
+    Uint64 nowCounter = SDL_GetPerformanceCounter();
+    double freq = (double)SDL_GetPerformanceFrequency();
+
+    int kept = 0;
+    for (int i = 0; i < count; ++i) {
+      if (!pending[i].effected) {
+        pending[kept++] = pending[i];
+        continue;
+      }
+
+      eventToPresent.Add((float)(nowTicks - pending[i].eventTicks));
+      pollToPresent.Add(
+          (float)((nowCounter - pending[i].pollCounter) * 1000.0 / freq));
+    }
+
+    count = kept;
+  }
+
+  LHistogram &GetEventToPresent() { return eventToPresent; }
+
+  LHistogram &GetPollToPresent() { return pollToPresent; }
+
+  int GetDropped() { return dropped; }
+
+private:
+  static const int MAX_PENDING = 16;
+  static const Uint32 EXPIRE_MS = 1000;
+
+  struct Pending {
+    Uint32 eventTicks;
+    Uint64 pollCounter;
+    LLatencyAxis axis;
+    bool effected;
+  };
+
+  void ExpireOld() {
+    Uint32 now = SDL_GetTicks();
+
+    int kept = 0;
+    for (int i = 0; i < count; ++i) {
+      if (now - pending[i].eventTicks > EXPIRE_MS) {
+        dropped++;
+        continue;
+      }
+
+      pending[kept++] = pending[i];
+    }
+
+    count = kept;
+  }
+
+  Pending pending[MAX_PENDING];
+  int count;
+  int dropped;
+
+  // last step's movement, to tell when an axis changes
+  int lastDx;
+  int lastDy;
+
+  LHistogram eventToPresent;
+  LHistogram pollToPresent;
+};
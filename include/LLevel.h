@@ -0,0 +1,532 @@
+#pragma once
+
+#include "LHistogram.h"
+#include "LSaveFile.h"
+
+#include <SDL2/SDL.h>
+#include <SDL_rwops.h>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+// level file, all little endian:
+//   header:    magic, tile size (px), chunk size (tiles), width and height
+//              (chunks), all u32
+//   directory: offset + size (u32 each) per chunk, row major; size 0 is an
+//              all-empty chunk with nothing stored
+//   chunks:    rle (see LSaveFile.h) of chunk size^2 tile bytes, row major
+// only the header is read up front; a chunk's directory entry is read when
+// the chunk is, so the file can be any size
+const Uint32 LEVEL_MAGIC = 0x314C564C; // "LVL1"
+const int LEVEL_HEADER_SIZE = 5 * 4;
+
+typedef enum LevelTile { LEVEL_TILE_EMPTY, LEVEL_TILE_BRICK } LevelTile;
+
+// tiles is widthTiles x heightTiles, row major; edges are padded out to
+// whole chunks with empty tiles
+inline bool WriteLevelFile(const char *path, int tileSize, int chunkTiles,
+                           int widthTiles, int heightTiles,
+                           const Uint8 *tiles) {
+  int widthChunks = (widthTiles + chunkTiles - 1) / chunkTiles;
+  int heightChunks = (heightTiles + chunkTiles - 1) / chunkTiles;
+  int nChunks = widthChunks * heightChunks;
+
+  std::vector<Uint8> raw(chunkTiles * chunkTiles);
+  std::vector<Uint8> encoded;
+  std::vector<Uint8> payload;
+  std::vector<Uint32> directory;
+
+  Uint32 offset = LEVEL_HEADER_SIZE + nChunks * 8;
+
+  for (int cy = 0; cy < heightChunks; ++cy) {
+    for (int cx = 0; cx < widthChunks; ++cx) {
+      bool empty = true;
+
+      for (int y = 0; y < chunkTiles; ++y) {
+        for (int x = 0; x < chunkTiles; ++x) {
+          int tx = cx * chunkTiles + x;
+          int ty = cy * chunkTiles + y;
+
+          Uint8 t = LEVEL_TILE_EMPTY;
+          if (tx < widthTiles && ty < heightTiles) {
+            t = tiles[ty * widthTiles + tx];
+          }
+
+          raw[y * chunkTiles + x] = t;
+          empty = empty && t == LEVEL_TILE_EMPTY;
+        }
+      }
+
+      if (empty) {
+        directory.push_back(0);
+        directory.push_back(0);
+        continue;
+      }
+
+      RleEncode(raw.data(), raw.size(), encoded);
+      directory.push_back(offset + payload.size());
+      directory.push_back(encoded.size());
+      payload.insert(payload.end(), encoded.begin(), encoded.end());
+    }
+  }
+
+  SDL_RWops *file = SDL_RWFromFile(path, "wb");
+  if (file == NULL) {
+    return false;
+  }
+
+  bool ok = SDL_WriteLE32(file, LEVEL_MAGIC) == 1 &&
+            SDL_WriteLE32(file, tileSize) == 1 &&
+            SDL_WriteLE32(file, chunkTiles) == 1 &&
+            SDL_WriteLE32(file, widthChunks) == 1 &&
+            SDL_WriteLE32(file, heightChunks) == 1;
+
+  for (size_t i = 0; ok && i < directory.size(); ++i) {
+    ok = SDL_WriteLE32(file, directory[i]) == 1;
+  }
+
+  if (ok && !payload.empty()) {
+    ok = SDL_RWwrite(file, payload.data(), payload.size(), 1) == 1;
+  }
+
+  SDL_RWclose(file);
+
+  return ok;
+}
+
+struct LevelChunk {
+  int cx, cy;
+  std::vector<Uint8> tiles;
+};
+
+// keeps the chunks around the camera loaded
+// Update() runs on the main thread once per frame: chunks within the view
+// plus a margin get requested, and a worker thread reads and decodes them;
+// chunks further than one more chunk out are evicted (the extra ring is
+// hysteresis, so walking back and forth over a chunk edge doesn't reload)
+// chunk buffers are recycled, so memory stays at what the view needs
+// however big the level is; Reserve() allocates them and the request lists
+// for a view size up front, so streaming doesn't allocate mid-game
+class LLevelStreamer {
+public:
+  LLevelStreamer() {
+    file = NULL;
+    running = false;
+
+    tileSize = 0;
+    chunkTiles = 0;
+    widthChunks = 0;
+    heightChunks = 0;
+    margin = 1;
+    maxResident = 0;
+
+    chunksLoaded = 0;
+    chunksEvicted = 0;
+    peakResident = 0;
+    chunksAllocated = 0;
+  }
+
+  ~LLevelStreamer() { Close(); }
+
+  // reads the header and starts the worker; no chunks are loaded yet
+  bool Open(const char *path, int marginChunks = 1) {
+    Close();
+
+    file = SDL_RWFromFile(path, "rb");
+    if (file == NULL) {
+      return false;
+    }
+
+    Uint32 magic = SDL_ReadLE32(file);
+    tileSize = SDL_ReadLE32(file);
+    chunkTiles = SDL_ReadLE32(file);
+    widthChunks = SDL_ReadLE32(file);
+    heightChunks = SDL_ReadLE32(file);
+
+    if (magic != LEVEL_MAGIC || tileSize <= 0 || chunkTiles <= 0 ||
+        widthChunks <= 0 || heightChunks <= 0) {
+      printf("Level file is corrupt: %s\n", path);
+      SDL_RWclose(file);
+      file = NULL;
+      return false;
+    }
+
+    margin = marginChunks;
+
+    running = true;
+    worker = std::thread(&LLevelStreamer::Work, this);
+
+    return true;
+  }
+
+  void Close() {
+    if (file == NULL) {
+      return;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(mtx);
+      running = false;
+    }
+
+    cv.notify_one();
+    worker.join();
+
+    SDL_RWclose(file);
+    file = NULL;
+
+    for (size_t i = 0; i < resident.size(); ++i) {
+      delete resident[i];
+    }
+
+    for (size_t i = 0; i < pool.size(); ++i) {
+      delete pool[i];
+    }
+
+    for (size_t i = 0; i < requests.size(); ++i) {
+      delete requests[i];
+    }
+
+    for (size_t i = 0; i < loaded.size(); ++i) {
+      delete loaded[i];
+    }
+
+    resident.clear();
+    pool.clear();
+    requests.clear();
+    loaded.clear();
+    pending.clear();
+    chunksAllocated = 0;
+  }
+
+  // chunk buffers and list room for the most a view this size can need:
+  // the view plus margin plus the hysteresis ring, twice over for loads
+  // still in flight from where the view was before
+  void Reserve(int viewW, int viewH) {
+    int chunkPx = chunkTiles * tileSize;
+    int w = viewW / chunkPx + 2 + 2 * margin + 2;
+    int h = viewH / chunkPx + 2 + 2 * margin + 2;
+    int n = 2 * w * h;
+    maxResident = w * h;
+
+    while (chunksAllocated < n) {
+      LevelChunk *c = new LevelChunk();
+      c->tiles.resize(chunkTiles * chunkTiles);
+      pool.push_back(c);
+      chunksAllocated++;
+    }
+
+    resident.reserve(n);
+    pool.reserve(n);
+    arrived.reserve(n);
+    pending.reserve(n);
+
+    std::lock_guard<std::mutex> lock(mtx);
+    requests.reserve(n);
+    loaded.reserve(n);
+  }
+
+  int GetTileSize() { return tileSize; }
+
+  // level size in pixels
+  int GetWidth() { return widthChunks * chunkTiles * tileSize; }
+
+  int GetHeight() { return heightChunks * chunkTiles * tileSize; }
+
+  // main thread; view in pixels
+  // returns true if chunks were added or evicted
+  bool Update(const SDL_Rect &view) {
+    bool changed = false;
+
+    int chunkPx = chunkTiles * tileSize;
+    int x0 = view.x / chunkPx - margin;
+    int y0 = view.y / chunkPx - margin;
+    int x1 = (view.x + view.w - 1) / chunkPx + margin;
+    int y1 = (view.y + view.h - 1) / chunkPx + margin;
+
+    // finished loads
+    {
+      std::lock_guard<std::mutex> lock(mtx);
+      arrived.swap(loaded);
+    }
+
+    for (size_t i = 0; i < arrived.size(); ++i) {
+      LevelChunk *c = arrived[i];
+      RemovePending(c->cx, c->cy);
+
+      // camera moved on while it was loading
+      if (!InRect(c->cx, c->cy, x0 - 1, y0 - 1, x1 + 1, y1 + 1)) {
+        pool.push_back(c);
+        continue;
+      }
+
+      resident.push_back(c);
+      changed = true;
+    }
+
+    arrived.clear();
+
+    // evict outside the hysteresis ring
+    for (size_t i = 0; i < resident.size();) {
+      LevelChunk *c = resident[i];
+
+      if (InRect(c->cx, c->cy, x0 - 1, y0 - 1, x1 + 1, y1 + 1)) {
+        ++i;
+        continue;
+      }
+
+      pool.push_back(c);
+      resident[i] = resident.back();
+      resident.pop_back();
+
+      chunksEvicted++;
+      changed = true;
+    }
+
+    // request what's missing
+    bool requested = false;
+
+    for (int cy = SDL_max(y0, 0); cy <= SDL_min(y1, heightChunks - 1); ++cy) {
+      for (int cx = SDL_max(x0, 0); cx <= SDL_min(x1, widthChunks - 1);
+           ++cx) {
+        if (FindResident(cx, cy) >= 0 || IsPending(cx, cy)) {
+          continue;
+        }
+
+        LevelChunk *c;
+        if (!pool.empty()) {
+          c = pool.back();
+          pool.pop_back();
+        }
+
+        else {
+          c = new LevelChunk();
+          c->tiles.resize(chunkTiles * chunkTiles);
+          chunksAllocated++;
+        }
+
+        c->cx = cx;
+        c->cy = cy;
+        pending.push_back(cy * widthChunks + cx);
+
+        std::lock_guard<std::mutex> lock(mtx);
+        requests.push_back(c);
+        requested = true;
+      }
+    }
+
+    if (requested) {
+      cv.notify_one();
+    }
+
+    if ((int)resident.size() > peakResident) {
+      peakResident = resident.size();
+    }
+
+    return changed;
+  }
+
+  // blocks until everything around the view is loaded; for startup, before
+  // there's a frame to hitch, and for runs that must stream the same way
+  // every time (recording, replay)
+  // returns true if chunks were added or evicted
+  bool LoadAround(const SDL_Rect &view) {
+    bool changed = Update(view);
+
+    while (!pending.empty()) {
+      {
+        std::unique_lock<std::mutex> lock(mtx);
+        doneCv.wait(lock, [this] { return !loaded.empty(); });
+      }
+
+      changed = Update(view) || changed;
+    }
+
+    return changed;
+  }
+
+  int GetResidentCount() { return (int)resident.size(); }
+
+  LevelChunk *GetResident(int i) { return resident[i]; }
+
+  int GetChunkTiles() { return chunkTiles; }
+
+  // most chunks resident at once for the view size given to Reserve()
+  int GetMaxResident() { return maxResident; }
+
+  // every chunk ever allocated, resident or pooled; the pool only grows to
+  // the most that were needed at once
+  size_t GetMemoryUsage() {
+    return chunksAllocated * (sizeof(LevelChunk) + chunkTiles * chunkTiles);
+  }
+
+  // pixel rect covering every resident chunk
+  SDL_Rect GetResidentBounds() {
+    SDL_Rect r = {0, 0, 0, 0};
+    if (resident.empty()) {
+      return r;
+    }
+
+    int x0 = resident[0]->cx, x1 = x0;
+    int y0 = resident[0]->cy, y1 = y0;
+
+    for (size_t i = 1; i < resident.size(); ++i) {
+      x0 = SDL_min(x0, resident[i]->cx);
+      x1 = SDL_max(x1, resident[i]->cx);
+      y0 = SDL_min(y0, resident[i]->cy);
+      y1 = SDL_max(y1, resident[i]->cy);
+    }
+
+    int chunkPx = chunkTiles * tileSize;
+    r.x = x0 * chunkPx;
+    r.y = y0 * chunkPx;
+    r.w = (x1 - x0 + 1) * chunkPx;
+    r.h = (y1 - y0 + 1) * chunkPx;
+
+    return r;
+  }
+
+  void PrintStats() {
+    std::lock_guard<std::mutex> lock(mtx);
+
+    printf("level: %d chunks loaded, %d evicted, peak %d resident "
+           "(%d tiles each)\n",
+           (int)chunksLoaded, chunksEvicted, peakResident,
+           chunkTiles * chunkTiles);
+    loadTimes.Print("chunk load");
+  }
+
+private:
+  static bool InRect(int x, int y, int x0, int y0, int x1, int y1) {
+    return x >= x0 && y >= y0 && x <= x1 && y <= y1;
+  }
+
+  int FindResident(int cx, int cy) {
+    for (size_t i = 0; i < resident.size(); ++i) {
+      if (resident[i]->cx == cx && resident[i]->cy == cy) {
+        return i;
+      }
+    }
+
+    return -1;
+  }
+
+  bool IsPending(int cx, int cy) {
+    int index = cy * widthChunks + cx;
+    for (size_t i = 0; i < pending.size(); ++i) {
+      if (pending[i] == index) {
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  void RemovePending(int cx, int cy) {
+    int index = cy * widthChunks + cx;
+    for (size_t i = 0; i < pending.size(); ++i) {
+      if (pending[i] == index) {
+        pending[i] = pending.back();
+        pending.pop_back();
+        return;
+      }
+    }
+  }
+
+  void Work() {
+    std::unique_lock<std::mutex> lock(mtx);
+
+    while (true) {
+      cv.wait(lock, [this] { return !requests.empty() || !running; });
+
+      if (!running) {
+        break;
+      }
+
+      LevelChunk *c = requests.front();
+      requests.erase(requests.begin());
+
+      lock.unlock();
+
+      auto start = std::chrono::high_resolution_clock::now();
+
+      if (!ReadChunk(c)) {
+        // leave it empty rather than asking for it again every frame
+        printf("Level chunk %d,%d is corrupt\n", c->cx, c->cy);
+        memset(c->tiles.data(), LEVEL_TILE_EMPTY, c->tiles.size());
+      }
+
+      float ms =
+          std::chrono::duration<float, std::chrono::milliseconds::period>(
+              std::chrono::high_resolution_clock::now() - start)
+              .count();
+
+      lock.lock();
+
+      loadTimes.Add(ms);
+      chunksLoaded++;
+      loaded.push_back(c);
+      doneCv.notify_one();
+    }
+  }
+
+  // worker only; the file handle and scratch buffer are its own
+  bool ReadChunk(LevelChunk *c) {
+    int index = c->cy * widthChunks + c->cx;
+
+    if (SDL_RWseek(file, LEVEL_HEADER_SIZE + index * 8, RW_SEEK_SET) < 0) {
+      return false;
+    }
+
+    Uint32 offset = SDL_ReadLE32(file);
+    Uint32 size = SDL_ReadLE32(file);
+
+    if (size == 0) {
+      memset(c->tiles.data(), LEVEL_TILE_EMPTY, c->tiles.size());
+      return true;
+    }
+
+    scratch.resize(size);
+    if (SDL_RWseek(file, offset, RW_SEEK_SET) < 0 ||
+        SDL_RWread(file, scratch.data(), size, 1) != 1) {
+      return false;
+    }
+
+    return RleDecode(scratch.data(), size, c->tiles.data(), c->tiles.size());
+  }
+
+  SDL_RWops *file;
+  std::vector<Uint8> scratch;
+
+  int tileSize;
+  int chunkTiles;
+  int widthChunks;
+  int heightChunks;
+  int margin;
+  int maxResident;
+
+  // main thread only
+  std::vector<LevelChunk *> resident;
+  std::vector<LevelChunk *> pool;
+  std::vector<LevelChunk *> arrived;
+  std::vector<int> pending;
+
+  // shared with the worker, under mtx
+  std::thread worker;
+  std::mutex mtx;
+  std::condition_variable cv;
+  std::condition_variable doneCv;
+  std::vector<LevelChunk *> requests;
+  std::vector<LevelChunk *> loaded;
+  bool running;
+
+  LHistogram loadTimes;
+  int chunksLoaded;
+  int chunksEvicted;
+  int peakResident;
+  int chunksAllocated;
+};
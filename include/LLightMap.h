@@ -0,0 +1,633 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+// per-tile lighting and the player's field of view, on the level's tile
+// grid
+// each cell keeps one byte per channel of light (ambient plus every light
+// that reaches it) and one byte for whether the viewer can see it; lights
+// and sight both go through recursive shadowcasting, with opaque cells
+// (walls) blocking
+// the map is split into BLOCK x BLOCK cell blocks; moving a light, or
+// changing a wall a light can reach, marks the blocks it covers dirty, and
+// Update() clears and relights only those blocks, recasting only the lights
+// that touch them, so the cost follows what changed and not the level size
+// the result goes on screen as one texture (a texel per cell, filtered)
+// multiplied over the world
+class LLightMap {
+public:
+  static constexpr int BLOCK = 8;
+
+  LLightMap() {
+    width = 0;
+    height = 0;
+    blocksW = 0;
+    blocksH = 0;
+
+    ambient[0] = ambient[1] = ambient[2] = 255;
+    maxRadius = 0;
+
+    viewX = 0;
+    viewY = 0;
+    viewRadius = -1;
+    viewDirty = false;
+    fovBox = {0, 0, 0, 0};
+
+    dirtyBox = {0, 0, 0, 0};
+    version = 0;
+
+    overlay = NULL;
+    overlayW = 0;
+    overlayH = 0;
+    overlayX = 0;
+    overlayY = 0;
+    overlayVersion = 0;
+
+    updates = 0;
+    cellsRelit = 0;
+    lightCasts = 0;
+    fovCasts = 0;
+  }
+
+  ~LLightMap() { Free(); }
+
+  // w x h cells; everything starts open and dark (ambient only, unseen)
+  void Init(int w, int h) {
+    Free();
+
+    width = w;
+    height = h;
+    blocksW = (w + BLOCK - 1) / BLOCK;
+    blocksH = (h + BLOCK - 1) / BLOCK;
+
+    light.assign((size_t)w * h * 3, 0);
+    opaque.assign((size_t)w * h, 0);
+    visible.assign((size_t)w * h, 0);
+    blockDirty.assign((size_t)blocksW * blocksH, 0);
+    dirtyBlocks.reserve(blockDirty.size());
+
+    MarkAllDirty();
+  }
+
+  void Free() {
+    if (overlay != NULL) {
+      SDL_DestroyTexture(overlay);
+      overlay = NULL;
+    }
+
+    light.clear();
+    opaque.clear();
+    visible.clear();
+    blockDirty.clear();
+    dirtyBlocks.clear();
+    overlayPixels.clear();
+    lights.clear();
+    freeLights.clear();
+
+    width = 0;
+    height = 0;
+  }
+
+  int GetWidth() { return width; }
+
+  int GetHeight() { return height; }
+
+  // light every cell gets, lights or not
+  void SetAmbient(Uint8 r, Uint8 g, Uint8 b) {
+    ambient[0] = r;
+    ambient[1] = g;
+    ambient[2] = b;
+    MarkAllDirty();
+  }
+
+  bool IsOpaque(int x, int y) {
+    return !InBounds(x, y) || opaque[(size_t)y * width + x] != 0;
+  }
+
+  // only marks anything when it actually changes
+  void SetOpaque(int x, int y, bool isOpaque) {
+    if (!InBounds(x, y) || (opaque[(size_t)y * width + x] != 0) == isOpaque) {
+      return;
+    }
+
+    opaque[(size_t)y * width + x] = isOpaque;
+
+    // any light that reaches this cell is within maxRadius of it, and so is
+    // every cell whose shadow it changes
+    MarkDirty(x - maxRadius, y - maxRadius, x + maxRadius, y + maxRadius);
+
+    if (viewRadius >= 0 && abs(x - viewX) <= viewRadius &&
+        abs(y - viewY) <= viewRadius) {
+      viewDirty = true;
+    }
+  }
+
+  // position in cells, radius in cells; returns a handle
+  int AddLight(int x, int y, int radius, Uint8 r, Uint8 g, Uint8 b) {
+    int handle;
+    if (!freeLights.empty()) {
+      handle = freeLights.back();
+      freeLights.pop_back();
+    }
+
+    else {
+      handle = (int)lights.size();
+      lights.push_back(Light());
+    }
+
+    Light &l = lights[handle];
+    l.x = x;
+    l.y = y;
+    l.radius = radius;
+    l.color[0] = r;
+    l.color[1] = g;
+    l.color[2] = b;
+    l.used = true;
+
+    if (radius > maxRadius) {
+      maxRadius = radius;
+    }
+
+    MarkLight(l);
+    return handle;
+  }
+
+  // only marks anything when the light changes cell
+  void MoveLight(int handle, int x, int y) {
+    Light &l = lights[handle];
+    if (l.x == x && l.y == y) {
+      return;
+    }
+
+    MarkLight(l);
+    l.x = x;
+    l.y = y;
+    MarkLight(l);
+  }
+
+  void RemoveLight(int handle) {
+    if (handle < 0 || handle >= (int)lights.size() || !lights[handle].used) {
+      return;
+    }
+
+    MarkLight(lights[handle]);
+    lights[handle].used = false;
+    freeLights.push_back(handle);
+  }
+
+  // field of view; a negative radius turns it off (everything visible)
+  void SetViewer(int x, int y, int radius) {
+    if (x == viewX && y == viewY && radius == viewRadius) {
+      return;
+    }
+
+    viewX = x;
+    viewY = y;
+    viewRadius = radius;
+    viewDirty = true;
+  }
+
+  void MarkAllDirty() {
+    MarkDirty(0, 0, width - 1, height - 1);
+    viewDirty = true;
+  }
+
+  // relights the dirty blocks and redoes the field of view if it changed;
+  // returns false if there was nothing to do
+  bool Update() {
+    if (dirtyBlocks.empty() && !viewDirty) {
+      return false;
+    }
+
+    if (!dirtyBlocks.empty()) {
+      Relight();
+    }
+
+    if (viewDirty) {
+      UpdateView();
+    }
+
+    version++;
+    updates++;
+    return true;
+  }
+
+  // rgb, one byte each
+  const Uint8 *GetLight(int x, int y) {
+    return &light[((size_t)y * width + x) * 3];
+  }
+
+  bool IsVisible(int x, int y) {
+    return viewRadius < 0 || visible[(size_t)y * width + x] != 0;
+  }
+
+  // overlay texture big enough for a screenW x screenH view of tileSize
+  // cells, wherever it's scrolled to
+  bool InitOverlay(SDL_Renderer *renderer, int screenW, int screenH,
+                   int tileSize) {
+    overlayW = screenW / tileSize + 2;
+    overlayH = screenH / tileSize + 2;
+
+    overlay = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGB24,
+                                SDL_TEXTUREACCESS_STREAMING, overlayW,
+                                overlayH);
+    if (overlay == NULL) {
+      printf("Unable to create light overlay: %s\n", SDL_GetError());
+      return false;
+    }
+
+    // multiplies the world by the light; texels blend into each other
+    // between cell centers
+    SDL_SetTextureBlendMode(overlay, SDL_BLENDMODE_MOD);
+    SDL_SetTextureScaleMode(overlay, SDL_ScaleModeLinear);
+
+    overlayPixels.assign((size_t)overlayW * overlayH * 3, 0);
+    overlayVersion = version - 1;
+
+    return true;
+  }
+
+  // the texture is only refilled when the view moves to another cell or
+  // the map changed since the last call
+  void RenderOverlay(SDL_Renderer *renderer, int camX, int camY,
+                     int tileSize) {
+    if (overlay == NULL) {
+      return;
+    }
+
+    int ox = FloorDiv(camX, tileSize);
+    int oy = FloorDiv(camY, tileSize);
+
+    if (ox != overlayX || oy != overlayY || overlayVersion != version) {
+      overlayX = ox;
+      overlayY = oy;
+      overlayVersion = version;
+      FillOverlay();
+    }
+
+    SDL_Rect dst = {ox * tileSize - camX, oy * tileSize - camY,
+                    overlayW * tileSize, overlayH * tileSize};
+    SDL_RenderCopy(renderer, overlay, NULL, &dst);
+  }
+
+  int GetLightCount() { return (int)(lights.size() - freeLights.size()); }
+
+  int GetUpdates() { return updates; }
+
+  // totals since Init
+  long long GetCellsRelit() { return cellsRelit; }
+
+  int GetLightCasts() { return lightCasts; }
+
+  int GetViewCasts() { return fovCasts; }
+
+  size_t GetMemoryUsage() {
+    return light.capacity() + opaque.capacity() + visible.capacity() +
+           blockDirty.capacity() + dirtyBlocks.capacity() * sizeof(int) +
+           scratch.capacity() + overlayPixels.capacity() +
+           lights.capacity() * sizeof(Light) +
+           (size_t)overlayW * overlayH * 3;
+  }
+
+private:
+  struct Light {
+    int x, y;
+    int radius;
+    Uint8 color[3];
+    bool used;
+  };
+
+  bool InBounds(int x, int y) {
+    return x >= 0 && y >= 0 && x < width && y < height;
+  }
+
+  static int FloorDiv(int a, int b) {
+    return a >= 0 ? a / b : -((-a + b - 1) / b);
+  }
+
+  // cells, inclusive; clipped to the map
+  void MarkDirty(int x0, int y0, int x1, int y1) {
+    x0 = SDL_max(x0, 0);
+    y0 = SDL_max(y0, 0);
+    x1 = SDL_min(x1, width - 1);
+    y1 = SDL_min(y1, height - 1);
+    if (x0 > x1 || y0 > y1) {
+      return;
+    }
+
+    int bx0 = x0 / BLOCK, by0 = y0 / BLOCK;
+    int bx1 = x1 / BLOCK, by1 = y1 / BLOCK;
+
+    for (int by = by0; by <= by1; ++by) {
+      for (int bx = bx0; bx <= bx1; ++bx) {
+        int b = by * blocksW + bx;
+        if (!blockDirty[b]) {
+          blockDirty[b] = 1;
+          dirtyBlocks.push_back(b);
+        }
+      }
+    }
+
+    // whole blocks get relit, so the box covers whole blocks too; it's in
+    // cells, so lights nowhere near can be turned away without a lookup
+    SDL_Rect r = {bx0 * BLOCK, by0 * BLOCK, (bx1 - bx0 + 1) * BLOCK,
+                  (by1 - by0 + 1) * BLOCK};
+    if (dirtyBox.w == 0) {
+      dirtyBox = r;
+    }
+
+    else {
+      SDL_UnionRect(&dirtyBox, &r, &dirtyBox);
+    }
+  }
+
+  void MarkLight(const Light &l) {
+    MarkDirty(l.x - l.radius, l.y - l.radius, l.x + l.radius,
+              l.y + l.radius);
+  }
+
+  bool IsBlockDirty(int x, int y) {
+    return blockDirty[(y / BLOCK) * blocksW + x / BLOCK] != 0;
+  }
+
+  bool AnyDirty(int x0, int y0, int x1, int y1) {
+    x0 = SDL_max(x0, 0);
+    y0 = SDL_max(y0, 0);
+    x1 = SDL_min(x1, width - 1);
+    y1 = SDL_min(y1, height - 1);
+
+    for (int by = y0 / BLOCK; by <= y1 / BLOCK; ++by) {
+      for (int bx = x0 / BLOCK; bx <= x1 / BLOCK; ++bx) {
+        if (blockDirty[by * blocksW + bx]) {
+          return true;
+        }
+      }
+    }
+
+    return false;
+  }
+
+  void Relight() {
+    // back to ambient
+    for (int b : dirtyBlocks) {
+      int x0 = (b % blocksW) * BLOCK;
+      int y0 = (b / blocksW) * BLOCK;
+      int x1 = SDL_min(x0 + BLOCK, width);
+      int y1 = SDL_min(y0 + BLOCK, height);
+
+      for (int y = y0; y < y1; ++y) {
+        Uint8 *p = &light[((size_t)y * width + x0) * 3];
+        for (int x = x0; x < x1; ++x, p += 3) {
+          p[0] = ambient[0];
+          p[1] = ambient[1];
+          p[2] = ambient[2];
+        }
+      }
+
+      cellsRelit += (x1 - x0) * (y1 - y0);
+    }
+
+    // then every light that reaches a dirty block, added into those blocks
+    // only
+    for (const Light &l : lights) {
+      if (!l.used) {
+        continue;
+      }
+
+      SDL_Rect box = {l.x - l.radius, l.y - l.radius, l.radius * 2 + 1,
+                      l.radius * 2 + 1};
+      if (!SDL_HasIntersection(&box, &dirtyBox) ||
+          !AnyDirty(box.x, box.y, box.x + box.w - 1, box.y + box.h - 1)) {
+        continue;
+      }
+
+      CastLight(l);
+      lightCasts++;
+    }
+
+    for (int b : dirtyBlocks) {
+      blockDirty[b] = 0;
+    }
+
+    dirtyBlocks.clear();
+    dirtyBox = {0, 0, 0, 0};
+  }
+
+  // shadowcasts into scratch first (a cell on an octant edge is reached
+  // twice, and light must only be added once), then adds it in
+  void CastLight(const Light &l) {
+    int side = l.radius * 2 + 1;
+    scratch.assign((size_t)side * side, 0);
+
+    int x0 = l.x - l.radius;
+    int y0 = l.y - l.radius;
+    float falloff = 1.0f / (l.radius + 1);
+
+    Cast(l.x, l.y, l.radius, [&](int x, int y, int d2) {
+      float f = 1 - sqrtf((float)d2) * falloff;
+      scratch[(size_t)(y - y0) * side + (x - x0)] = (Uint8)(f * 255);
+    });
+
+    for (int y = SDL_max(y0, 0); y < SDL_min(y0 + side, height); ++y) {
+      for (int x = SDL_max(x0, 0); x < SDL_min(x0 + side, width); ++x) {
+        int f = scratch[(size_t)(y - y0) * side + (x - x0)];
+        if (f == 0 || !IsBlockDirty(x, y)) {
+          continue;
+        }
+
+        Uint8 *p = &light[((size_t)y * width + x) * 3];
+        for (int k = 0; k < 3; ++k) {
+          int v = p[k] + l.color[k] * f / 255;
+          p[k] = (Uint8)(v > 255 ? 255 : v);
+        }
+      }
+    }
+  }
+
+  // clears what the last view could see, then casts from the new spot
+  void UpdateView() {
+    viewDirty = false;
+
+    for (int y = fovBox.y; y < fovBox.y + fovBox.h; ++y) {
+      memset(&visible[(size_t)y * width + fovBox.x], 0, fovBox.w);
+    }
+
+    fovBox = {0, 0, 0, 0};
+    if (viewRadius < 0) {
+      return;
+    }
+
+    SDL_Rect box = {viewX - viewRadius, viewY - viewRadius,
+                    viewRadius * 2 + 1, viewRadius * 2 + 1};
+    SDL_Rect map = {0, 0, width, height};
+    if (!SDL_IntersectRect(&box, &map, &fovBox)) {
+      fovBox = {0, 0, 0, 0};
+      return;
+    }
+
+    Cast(viewX, viewY, viewRadius, [&](int x, int y, int) {
+      visible[(size_t)y * width + x] = 1;
+    });
+
+    fovCasts++;
+  }
+
+  // recursive shadowcasting over the eight octants around (cx, cy); visit
+  // gets every in-bounds cell within radius that has a line of sight to the
+  // center, walls included, with its squared distance
+  template <typename F> void Cast(int cx, int cy, int radius, F visit) {
+    if (InBounds(cx, cy)) {
+      visit(cx, cy, 0);
+    }
+
+    // octant transforms: (col, row) -> (x, y)
+    static const int XX[8] = {1, 0, 0, -1, -1, 0, 0, 1};
+    static const int XY[8] = {0, 1, -1, 0, 0, -1, 1, 0};
+    static const int YX[8] = {0, 1, 1, 0, 0, -1, -1, 0};
+    static const int YY[8] = {1, 0, 0, 1, -1, 0, 0, -1};
+
+    for (int o = 0; o < 8; ++o) {
+      CastOctant(cx, cy, 1, 1.0f, 0.0f, radius, XX[o], XY[o], YX[o], YY[o],
+                 visit);
+    }
+  }
+
+  // slopes run from start (steep) down to end; a wall in the row splits the
+  // visible range, and the part before it goes on in a recursive call
+  template <typename F>
+  void CastOctant(int cx, int cy, int row, float start, float end,
+                  int radius, int xx, int xy, int yx, int yy, F &visit) {
+    if (start < end) {
+      return;
+    }
+
+    int r2 = radius * radius;
+    float newStart = 0;
+
+    for (int j = row; j <= radius; ++j) {
+      int dy = -j;
+      bool blocked = false;
+
+      for (int dx = -j; dx <= 0; ++dx) {
+        float leftSlope = (dx - 0.5f) / (dy + 0.5f);
+        float rightSlope = (dx + 0.5f) / (dy - 0.5f);
+
+        if (start < rightSlope) {
+          continue;
+        }
+
+        if (end > leftSlope) {
+          break;
+        }
+
+        int x = cx + dx * xx + dy * xy;
+        int y = cy + dx * yx + dy * yy;
+        int d2 = dx * dx + dy * dy;
+
+        if (d2 <= r2 && InBounds(x, y)) {
+          visit(x, y, d2);
+        }
+
+        bool wall = IsOpaque(x, y);
+
+        if (blocked) {
+          if (wall) {
+            newStart = rightSlope;
+            continue;
+          }
+
+          blocked = false;
+          start = newStart;
+        }
+
+        else if (wall && j < radius) {
+          blocked = true;
+          CastOctant(cx, cy, j + 1, start, leftSlope, radius, xx, xy, yx, yy,
+                     visit);
+          newStart = rightSlope;
+        }
+      }
+
+      if (blocked) {
+        break;
+      }
+    }
+  }
+
+  // what's on screen, light dimmed to a quarter outside the view
+  void FillOverlay() {
+    for (int ty = 0; ty < overlayH; ++ty) {
+      Uint8 *out = &overlayPixels[(size_t)ty * overlayW * 3];
+
+      for (int tx = 0; tx < overlayW; ++tx, out += 3) {
+        int x = overlayX + tx;
+        int y = overlayY + ty;
+
+        if (!InBounds(x, y)) {
+          out[0] = out[1] = out[2] = 0;
+          continue;
+        }
+
+        const Uint8 *p = GetLight(x, y);
+        int shift = IsVisible(x, y) ? 0 : 2;
+        out[0] = p[0] >> shift;
+        out[1] = p[1] >> shift;
+        out[2] = p[2] >> shift;
+      }
+    }
+
+    SDL_UpdateTexture(overlay, NULL, overlayPixels.data(), overlayW * 3);
+  }
+
+  int width;
+  int height;
+  int blocksW;
+  int blocksH;
+
+  // rgb per cell
+  std::vector<Uint8> light;
+  std::vector<Uint8> opaque;
+  std::vector<Uint8> visible;
+
+  // a flag per block, and the dirty ones as a list
+  std::vector<Uint8> blockDirty;
+  std::vector<int> dirtyBlocks;
+  SDL_Rect dirtyBox;
+
+  // one light's shadowcast, (2 * radius + 1)^2
+  std::vector<Uint8> scratch;
+
+  std::vector<Light> lights;
+  std::vector<int> freeLights;
+  Uint8 ambient[3];
+
+  // largest radius any light has had; how far a wall change can reach
+  int maxRadius;
+
+  int viewX;
+  int viewY;
+  int viewRadius;
+  bool viewDirty;
+  SDL_Rect fovBox;
+
+  // bumped by every Update that changed something
+  Uint32 version;
+
+  SDL_Texture *overlay;
+  std::vector<Uint8> overlayPixels;
+  int overlayW;
+  int overlayH;
+  int overlayX;
+  int overlayY;
+  Uint32 overlayVersion;
+
+  int updates;
+  long long cellsRelit;
+  int lightCasts;
+  int fovCasts;
+};
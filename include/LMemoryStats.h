@@ -0,0 +1,184 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <algorithm>
+#include <stdio.h>
+#include <vector>
+
+typedef enum LMemCategory {
+  MEM_TEXTURE,
+  MEM_TEXT,
+  MEM_AUDIO,
+  MEM_GAME_STATE,
+  MEM_SUBSYSTEM,
+  MEM_CATEGORY_COUNT
+} LMemCategory;
+
+// estimated bytes held by each texture, sound and subsystem, keyed by the
+// owning object
+// textures are format bytes-per-pixel x w x h, which is what the driver has
+// to keep somewhere (vram or not); sounds are their decoded pcm; subsystems
+// report the capacity of their buffers
+// names are copied into fixed storage and the entry list is reserved up
+// front, so re-tracking a texture every time some text changes doesn't
+// allocate
+class LMemoryStats {
+public:
+  LMemoryStats() {
+    entries.reserve(64);
+    peakTotal = 0;
+    budget = 0;
+  }
+
+  // adds or updates owner's entry
+  void Set(const void *owner, LMemCategory category, const char *name,
+           size_t bytes) {
+    Entry *entry = Find(owner);
+
+    if (entry == NULL) {
+      entries.push_back(Entry());
+      entry = &entries.back();
+      entry->owner = owner;
+    }
+
+    entry->category = category;
+    entry->bytes = bytes;
+    snprintf(entry->name, sizeof(entry->name), "%s", name);
+
+    size_t total = GetTotal();
+    if (total > peakTotal) {
+      peakTotal = total;
+    }
+  }
+
+  void Remove(const void *owner) {
+    Entry *entry = Find(owner);
+    if (entry == NULL) {
+      return;
+    }
+
+    *entry = entries.back();
+    entries.pop_back();
+  }
+
+  size_t GetBytes(const void *owner) {
+    Entry *entry = Find(owner);
+    return entry != NULL ? entry->bytes : 0;
+  }
+
+  size_t GetTotal(LMemCategory category) {
+    size_t total = 0;
+
+    for (size_t i = 0; i < entries.size(); ++i) {
+      if (entries[i].category == category) {
+        total += entries[i].bytes;
+      }
+    }
+
+    return total;
+  }
+
+  size_t GetTotal() {
+    size_t total = 0;
+
+    for (size_t i = 0; i < entries.size(); ++i) {
+      total += entries[i].bytes;
+    }
+
+    return total;
+  }
+
+  size_t GetPeakTotal() { return peakTotal; }
+
+  // 0 = no budget; the report flags going over it
+  void SetBudget(size_t bytes) { budget = bytes; }
+
+  size_t GetBudget() { return budget; }
+
+  bool OverBudget() { return budget > 0 && GetTotal() > budget; }
+
+  // per-category totals, then every entry largest first
+  void Report(FILE *out = stdout) {
+    std::sort(entries.begin(), entries.end(),
+              [](const Entry &a, const Entry &b) { return a.bytes > b.bytes; });
+
+    fprintf(out, "memory: %.2f MB tracked (peak %.2f MB)\n", ToMB(GetTotal()),
+            ToMB(peakTotal));
+
+    if (budget > 0) {
+      fprintf(out, "  budget %.2f MB%s\n", ToMB(budget),
+              OverBudget() ? "  ** OVER **" : "");
+    }
+
+    for (int c = 0; c < MEM_CATEGORY_COUNT; ++c) {
+      fprintf(out, "  %-12s %10.1f KB\n", GetCategoryName((LMemCategory)c),
+              GetTotal((LMemCategory)c) / 1024.0);
+    }
+
+    for (size_t i = 0; i < entries.size(); ++i) {
+      fprintf(out, "    %10.1f KB  %-10s %s\n", entries[i].bytes / 1024.0,
+              GetCategoryName(entries[i].category), entries[i].name);
+    }
+  }
+
+  static const char *GetCategoryName(LMemCategory category) {
+    switch (category) {
+    case MEM_TEXTURE:
+      return "textures";
+    case MEM_TEXT:
+      return "text";
+    case MEM_AUDIO:
+      return "audio";
+    case MEM_GAME_STATE:
+      return "game state";
+    case MEM_SUBSYSTEM:
+      return "subsystems";
+    default:
+      return "?";
+    }
+  }
+
+  // 0 for NULL and for planar formats, which report no bytes per pixel
+  static size_t TextureBytes(SDL_Texture *texture) {
+    if (texture == NULL) {
+      return 0;
+    }
+
+    Uint32 format;
+    int w, h;
+    if (SDL_QueryTexture(texture, &format, NULL, &w, &h) != 0) {
+      return 0;
+    }
+
+    return (size_t)SDL_BYTESPERPIXEL(format) * w * h;
+  }
+
+  // vector's heap block, not its size
+  template <typename T> static size_t VectorBytes(const std::vector<T> &v) {
+    return v.capacity() * sizeof(T);
+  }
+
+private:
+  struct Entry {
+    const void *owner;
+    LMemCategory category;
+    size_t bytes;
+    char name[48];
+  };
+
+  Entry *Find(const void *owner) {
+    for (size_t i = 0; i < entries.size(); ++i) {
+      if (entries[i].owner == owner) {
+        return &entries[i];
+      }
+    }
+
+    return NULL;
+  }
+
+  static double ToMB(size_t bytes) { return bytes / (1024.0 * 1024.0); }
+
+  std::vector<Entry> entries;
+  size_t peakTotal;
+  size_t budget;
+};
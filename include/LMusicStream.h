@@ -0,0 +1,356 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_mixer.h>
+#include <SDL_rwops.h>
+#include <atomic>
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+// lock-free byte ring between the decode worker (writer) and the audio
+// callback (reader); capacity must be a power of two
+class LByteRing {
+public:
+  LByteRing(size_t capacity) : head(0), tail(0) { data.resize(capacity); }
+
+  size_t Available() {
+    return tail.load(std::memory_order_acquire) -
+           head.load(std::memory_order_relaxed);
+  }
+
+  size_t Free() {
+    return data.size() - (tail.load(std::memory_order_relaxed) -
+                          head.load(std::memory_order_acquire));
+  }
+
+  // writer side; caller checks Free() first
+  void Write(const Uint8 *src, size_t n) {
+    size_t t = tail.load(std::memory_order_relaxed);
+    size_t start = t & (data.size() - 1);
+    size_t first = Contiguous(start, n);
+
+    memcpy(&data[start], src, first);
+    memcpy(&data[0], src + first, n - first);
+
+    tail.store(t + n, std::memory_order_release);
+  }
+
+  // reader side; returns bytes actually read
+  size_t Read(Uint8 *dst, size_t n) {
+    size_t h = head.load(std::memory_order_relaxed);
+    size_t avail = tail.load(std::memory_order_acquire) - h;
+    if (n > avail) {
+      n = avail;
+    }
+
+    size_t start = h & (data.size() - 1);
+    size_t first = Contiguous(start, n);
+
+    memcpy(dst, &data[start], first);
+    memcpy(dst + first, &data[0], n - first);
+
+    head.store(h + n, std::memory_order_release);
+
+    return n;
+  }
+
+  // only when neither side is running
+  void Reset() {
+    head = 0;
+    tail = 0;
+  }
+
+private:
+  // bytes of n that fit before the end of the buffer
+  size_t Contiguous(size_t start, size_t n) {
+    size_t toEnd = data.size() - start;
+    return n < toEnd ? n : toEnd;
+  }
+
+  std::vector<Uint8> data;
+  std::atomic<size_t> head;
+  std::atomic<size_t> tail;
+};
+
+// streams a pcm .wav from disk instead of loading it whole
+// Open() only reads the header; once started, a worker reads fixed-size
+// blocks, converts them to the mixer's format and keeps a read-ahead ring
+// topped up, and SDL_mixer's music hook drains the ring from the audio
+// callback; at the end of the data the worker seeks back to the start, so
+// loops are seamless
+// memory stays at the ring + one block no matter how long the track is
+class LMusicStream {
+public:
+  LMusicStream() : ring(RING_BYTES) {
+    file = NULL;
+    converter = NULL;
+
+    dataStart = 0;
+    dataSize = 0;
+    remaining = 0;
+    frameBytes = 0;
+
+    running = false;
+    paused = false;
+    started = false;
+    underruns = 0;
+  }
+
+  ~LMusicStream() { Close(); }
+
+  // reads the wav header; false if it isn't a pcm wav we can stream
+  // call after Mix_OpenAudio, the converter targets the mixer's format
+  bool Open(const char *path) {
+    Close();
+
+    file = SDL_RWFromFile(path, "rb");
+    if (file == NULL) {
+      printf("Unable to open music: %s\n", SDL_GetError());
+      return false;
+    }
+
+    SDL_AudioFormat srcFormat;
+    Uint8 srcChannels;
+    int srcRate;
+
+    if (!ReadHeader(&srcFormat, &srcChannels, &srcRate)) {
+      SDL_RWclose(file);
+      file = NULL;
+      return false;
+    }
+
+    int freq, channels;
+    Uint16 format;
+    if (Mix_QuerySpec(&freq, &format, &channels) == 0) {
+      printf("Could not query mixer: %s\n", Mix_GetError());
+      Close();
+      return false;
+    }
+
+    converter = SDL_NewAudioStream(srcFormat, srcChannels, srcRate, format,
+                                   channels, freq);
+    if (converter == NULL) {
+      printf("Unable to convert music: %s\n", SDL_GetError());
+      Close();
+      return false;
+    }
+
+    frameBytes = channels * (SDL_AUDIO_BITSIZE(format) / 8);
+    silence = format == AUDIO_U8 ? 0x80 : 0;
+
+    return true;
+  }
+
+  bool IsOpen() { return file != NULL; }
+
+  // starts decoding and hooks the stream into the mixer
+  void Play() {
+    if (file == NULL || started) {
+      return;
+    }
+
+    remaining = dataSize;
+    SDL_RWseek(file, dataStart, RW_SEEK_SET);
+    SDL_AudioStreamClear(converter);
+    ring.Reset();
+
+    paused = false;
+    running = true;
+    worker = std::thread(&LMusicStream::Work, this);
+
+    Mix_HookMusic(Callback, this);
+    started = true;
+  }
+
+  bool IsPlaying() { return started; }
+
+  bool IsPaused() { return paused; }
+
+  // callback keeps running but outputs silence and doesn't consume the ring
+  void SetPaused(bool paused) { this->paused = paused; }
+
+  void Close() {
+    if (started) {
+      // unhook first so the callback is done with the ring
+      Mix_HookMusic(NULL, NULL);
+
+      running = false;
+      worker.join();
+
+      started = false;
+    }
+
+    if (converter != NULL) {
+      SDL_FreeAudioStream(converter);
+      converter = NULL;
+    }
+
+    if (file != NULL) {
+      SDL_RWclose(file);
+      file = NULL;
+    }
+  }
+
+  int GetUnderruns() { return underruns; }
+
+  // read-ahead ring plus the worker's block buffer while it runs
+  size_t GetMemoryUsage() {
+    return RING_BYTES + (worker.joinable() ? BLOCK_BYTES : 0);
+  }
+
+private:
+  // read-ahead ~1.5s of 44.1kHz stereo s16; blocks are what we read from
+  // disk at a time
+  static const size_t RING_BYTES = 256 * 1024;
+  static const size_t BLOCK_BYTES = 16 * 1024;
+
+  bool ReadHeader(SDL_AudioFormat *format, Uint8 *channels, int *rate) {
+    Uint8 riff[12];
+    if (SDL_RWread(file, riff, 12, 1) != 1 || memcmp(riff, "RIFF", 4) != 0 ||
+        memcmp(riff + 8, "WAVE", 4) != 0) {
+      printf("Music is not a wav file\n");
+      return false;
+    }
+
+    bool haveFormat = false;
+
+    // walk chunks until we have fmt and find data
+    while (true) {
+      Uint8 id[4];
+      if (SDL_RWread(file, id, 4, 1) != 1) {
+        printf("Music wav has no data chunk\n");
+        return false;
+      }
+
+      Uint32 size = SDL_ReadLE32(file);
+      Sint64 next = SDL_RWtell(file) + size + (size & 1);
+
+      if (memcmp(id, "fmt ", 4) == 0) {
+        Uint16 tag = SDL_ReadLE16(file);
+        *channels = (Uint8)SDL_ReadLE16(file);
+        *rate = SDL_ReadLE32(file);
+        SDL_ReadLE32(file); // byte rate
+        Uint16 blockAlign = SDL_ReadLE16(file);
+        Uint16 bits = SDL_ReadLE16(file);
+
+        // 1 = integer pcm, 3 = float
+        if (tag == 1 && bits == 16) {
+          *format = AUDIO_S16LSB;
+        }
+
+        else if (tag == 1 && bits == 8) {
+          *format = AUDIO_U8;
+        }
+
+        else if (tag == 3 && bits == 32) {
+          *format = AUDIO_F32LSB;
+        }
+
+        else {
+          printf("Can't stream wav format %d (%d bit)\n", tag, bits);
+          return false;
+        }
+
+        srcBlockAlign = blockAlign > 0 ? blockAlign : 1;
+        haveFormat = true;
+      }
+
+      else if (memcmp(id, "data", 4) == 0) {
+        if (!haveFormat) {
+          printf("Music wav has data before fmt\n");
+          return false;
+        }
+
+        dataStart = SDL_RWtell(file);
+        dataSize = size - size % srcBlockAlign;
+        return dataSize > 0;
+      }
+
+      SDL_RWseek(file, next, RW_SEEK_SET);
+    }
+  }
+
+  // worker: keep the ring full
+  void Work() {
+    std::vector<Uint8> block(BLOCK_BYTES);
+
+    while (running) {
+      size_t room = ring.Free();
+      room -= room % frameBytes;
+
+      // converted audio waiting; move what fits
+      int ready = SDL_AudioStreamAvailable(converter);
+      if (ready > 0 && room > 0) {
+        size_t n = (size_t)ready < room ? ready : room;
+        n = n < block.size() ? n : block.size();
+        n -= n % frameBytes;
+
+        int got = SDL_AudioStreamGet(converter, block.data(), n);
+        if (got > 0) {
+          ring.Write(block.data(), got);
+        }
+
+        continue;
+      }
+
+      // ring full (or nothing converted yet and no room); wait for the
+      // callback to drain some
+      if (ready > 0 || room < block.size()) {
+        SDL_Delay(5);
+        continue;
+      }
+
+      // loop back to the start of the data
+      if (remaining == 0) {
+        SDL_RWseek(file, dataStart, RW_SEEK_SET);
+        remaining = dataSize;
+      }
+
+      size_t n = remaining < BLOCK_BYTES ? remaining : BLOCK_BYTES;
+      n -= n % srcBlockAlign;
+
+      if (n == 0 || SDL_RWread(file, block.data(), n, 1) != 1) {
+        printf("Music read failed, stopping stream\n");
+        break;
+      }
+
+      remaining -= n;
+      SDL_AudioStreamPut(converter, block.data(), n);
+    }
+  }
+
+  static void Callback(void *udata, Uint8 *stream, int len) {
+    LMusicStream *self = (LMusicStream *)udata;
+
+    size_t got = 0;
+    if (!self->paused) {
+      got = self->ring.Read(stream, len);
+
+      if (got < (size_t)len) {
+        self->underruns++;
+      }
+    }
+
+    memset(stream + got, self->silence, len - got);
+  }
+
+  SDL_RWops *file;
+  SDL_AudioStream *converter;
+  std::thread worker;
+
+  LByteRing ring;
+
+  Sint64 dataStart;
+  size_t dataSize;
+  size_t remaining;
+  int srcBlockAlign;
+  int frameBytes;
+  Uint8 silence;
+
+  std::atomic<bool> running;
+  std::atomic<bool> paused;
+  bool started;
+  std::atomic<int> underruns;
+};
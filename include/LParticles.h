@@ -0,0 +1,478 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// particles (embers, dust) as parallel arrays of position, velocity, life
+// and color, sized once in Init; nothing is allocated after that, a full
+// pool just drops new particles
+// a tick walks the pool in fixed-size batches: each batch is integrated
+// with simd while it's in cache, then its live particles are packed down
+// over the dead ones, so the arrays stay dense without reallocating
+// big pools can be split across worker threads, a run of batches each
+// all live particles are drawn as colored quads in one SDL_RenderGeometry
+class LParticleSystem {
+public:
+  static constexpr int BATCH = 1024;
+
+  LParticleSystem() {
+    count = 0;
+    capacity = 0;
+    maxDrawn = 0;
+
+    gravity = 0;
+    drag = 0;
+    size = 1;
+
+    dropped = 0;
+    drawn = 0;
+
+    running = false;
+    generation = 0;
+    pending = 0;
+    jobDt = 0;
+  }
+
+  ~LParticleSystem() { Free(); }
+
+  // threads are extra workers; the calling thread always takes a share too
+  void Init(int maxParticles, int maxDrawnParticles, int threads = 0) {
+    Free();
+
+    // whole batches, so a batch never runs off the end
+    capacity = (maxParticles + BATCH - 1) / BATCH * BATCH;
+
+    posX.resize(capacity);
+    posY.resize(capacity);
+    velX.resize(capacity);
+    velY.resize(capacity);
+    life.resize(capacity);
+    invLifetime.resize(capacity);
+    color.resize(capacity);
+
+    // quads share their corners' order, so the indices never change
+    maxDrawn = maxDrawnParticles;
+    vertices.resize((size_t)maxDrawn * 4);
+    indices.resize((size_t)maxDrawn * 6);
+
+    for (int i = 0; i < maxDrawn; ++i) {
+      int *q = &indices[(size_t)i * 6];
+      q[0] = i * 4;
+      q[1] = i * 4 + 1;
+      q[2] = i * 4 + 2;
+      q[3] = i * 4 + 2;
+      q[4] = i * 4 + 3;
+      q[5] = i * 4;
+    }
+
+    ranges.resize(threads + 1);
+
+    // workers start from generation 0 whenever they get scheduled, so an
+    // Update that comes first isn't missed
+    running = true;
+    generation = 0;
+    for (int i = 0; i < threads; ++i) {
+      workers.push_back(std::thread(&LParticleSystem::Work, this, i + 1));
+    }
+  }
+
+  void Free() {
+    if (running) {
+      {
+        std::lock_guard<std::mutex> lock(mtx);
+        running = false;
+      }
+
+      cv.notify_all();
+      for (size_t i = 0; i < workers.size(); ++i) {
+        workers[i].join();
+      }
+
+      workers.clear();
+    }
+
+    count = 0;
+    capacity = 0;
+    maxDrawn = 0;
+
+    posX.clear();
+    posY.clear();
+    velX.clear();
+    velY.clear();
+    life.clear();
+    invLifetime.clear();
+    color.clear();
+    vertices.clear();
+    indices.clear();
+    ranges.clear();
+  }
+
+  // pixels per second squared, down is positive
+  void SetGravity(float g) { gravity = g; }
+
+  // fraction of velocity lost per second
+  void SetDrag(float d) { drag = d; }
+
+  // side of each particle's square, in pixels
+  void SetSize(float pixels) { size = pixels; }
+
+  // false (and counted) when the pool is full
+  bool Emit(float x, float y, float vx, float vy, float lifetime,
+            SDL_Color c) {
+    if (count >= capacity || lifetime <= 0) {
+      dropped++;
+      return false;
+    }
+
+    posX[count] = x;
+    posY[count] = y;
+    velX[count] = vx;
+    velY[count] = vy;
+    life[count] = lifetime;
+    invLifetime[count] = 1 / lifetime;
+    color[count] = c;
+    count++;
+
+    return true;
+  }
+
+  void Clear() { count = 0; }
+
+  void Update(float dt) {
+    if (count == 0) {
+      return;
+    }
+
+    int batches = (count + BATCH - 1) / BATCH;
+    int nRanges = (int)ranges.size();
+
+    // not worth waking the workers for a few batches
+    if (nRanges == 1 || batches < nRanges * 4) {
+      count = Step(0, count, dt);
+      return;
+    }
+
+    // whole batches per range; the last one takes the remainder
+    int per = (batches + nRanges - 1) / nRanges;
+    for (int i = 0; i < nRanges; ++i) {
+      ranges[i].begin = std::min(i * per * BATCH, count);
+      ranges[i].end = std::min((i + 1) * per * BATCH, count);
+      ranges[i].alive = 0;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(mtx);
+      jobDt = dt;
+      pending = nRanges - 1;
+      generation++;
+    }
+
+    cv.notify_all();
+
+    ranges[0].alive = Step(ranges[0].begin, ranges[0].end, dt);
+
+    {
+      std::unique_lock<std::mutex> lock(mtx);
+      doneCv.wait(lock, [this] { return pending == 0; });
+    }
+
+    // each range packed its live particles to its own start; close the gaps
+    int live = ranges[0].alive;
+    for (int i = 1; i < nRanges; ++i) {
+      Move(ranges[i].begin, live, ranges[i].alive);
+      live += ranges[i].alive;
+    }
+
+    count = live;
+  }
+
+  // draws at most the maxDrawn set in Init; returns how many were drawn
+  int Render(SDL_Renderer *renderer, int camX, int camY, int screenW,
+             int screenH) {
+    int n = 0;
+
+    for (int i = 0; i < count && n < maxDrawn; ++i) {
+      float x = posX[i] - camX;
+      float y = posY[i] - camY;
+
+      if (x + size < 0 || y + size < 0 || x > screenW || y > screenH) {
+        continue;
+      }
+
+      // fades out over its lifetime
+      SDL_Color c = color[i];
+      c.a = (Uint8)(c.a * std::min(life[i] * invLifetime[i], 1.0f));
+
+      SDL_Vertex *v = &vertices[(size_t)n * 4];
+      v[0].position = {x, y};
+      v[1].position = {x + size, y};
+      v[2].position = {x + size, y + size};
+      v[3].position = {x, y + size};
+
+      for (int k = 0; k < 4; ++k) {
+        v[k].color = c;
+        v[k].tex_coord = {0, 0};
+      }
+
+      n++;
+    }
+
+    drawn = n;
+
+    if (n == 0) {
+      return 0;
+    }
+
+    // untextured geometry blends with the draw blend mode
+    SDL_BlendMode oldMode;
+    SDL_GetRenderDrawBlendMode(renderer, &oldMode);
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+
+    if (SDL_RenderGeometry(renderer, NULL, vertices.data(), n * 4,
+                           indices.data(), n * 6) != 0) {
+      printf("Unable to draw particles: %s\n", SDL_GetError());
+    }
+
+    SDL_SetRenderDrawBlendMode(renderer, oldMode);
+
+    return n;
+  }
+
+  int GetCount() { return count; }
+
+  int GetCapacity() { return capacity; }
+
+  // emits that found the pool full
+  int GetDropped() { return dropped; }
+
+  // last Render's count
+  int GetDrawn() { return drawn; }
+
+  int GetThreads() { return (int)workers.size(); }
+
+  size_t GetMemoryUsage() {
+    return (size_t)capacity * (sizeof(float) * 6 + sizeof(SDL_Color)) +
+           vertices.capacity() * sizeof(SDL_Vertex) +
+           indices.capacity() * sizeof(int);
+  }
+
+private:
+  struct Range {
+    int begin;
+    int end;
+    int alive;
+  };
+
+  // integrates and packs [begin, end) a batch at a time; returns how many
+  // are left alive, now at [begin, begin + alive)
+  int Step(int begin, int end, float dt) {
+    // implicit drag, so a long tick can't flip a particle's direction
+    float keep = 1 / (1 + drag * dt);
+    float fall = gravity * dt;
+
+    int out = begin;
+    for (int b = begin; b < end; b += BATCH) {
+      int n = std::min(BATCH, end - b);
+
+      // most batches lose nobody in a tick; those only need to slide down
+      // over earlier holes, if there are any
+      if (Integrate(b, n, dt, keep, fall)) {
+        out = Compact(b, n, out);
+      }
+
+      else {
+        Move(b, out, n);
+        out += n;
+      }
+    }
+
+    return out - begin;
+  }
+
+  // true if any of them died
+  bool Integrate(int begin, int n, float dt, float keep, float fall) {
+    float *px = posX.data() + begin;
+    float *py = posY.data() + begin;
+    float *vx = velX.data() + begin;
+    float *vy = velY.data() + begin;
+    float *l = life.data() + begin;
+
+    int i = 0;
+    bool died = false;
+
+#if defined(__AVX2__)
+    __m256 dead8 = _mm256_setzero_ps();
+    __m256 dt8 = _mm256_set1_ps(dt);
+    __m256 keep8 = _mm256_set1_ps(keep);
+    __m256 fall8 = _mm256_set1_ps(fall);
+    for (; i + 8 <= n; i += 8) {
+      __m256 x = _mm256_mul_ps(_mm256_loadu_ps(vx + i), keep8);
+      __m256 y = _mm256_add_ps(
+          _mm256_mul_ps(_mm256_loadu_ps(vy + i), keep8), fall8);
+      _mm256_storeu_ps(vx + i, x);
+      _mm256_storeu_ps(vy + i, y);
+      _mm256_storeu_ps(px + i, _mm256_add_ps(_mm256_loadu_ps(px + i),
+                                             _mm256_mul_ps(x, dt8)));
+      _mm256_storeu_ps(py + i, _mm256_add_ps(_mm256_loadu_ps(py + i),
+                                             _mm256_mul_ps(y, dt8)));
+
+      __m256 left = _mm256_sub_ps(_mm256_loadu_ps(l + i), dt8);
+      _mm256_storeu_ps(l + i, left);
+      dead8 = _mm256_or_ps(
+          dead8, _mm256_cmp_ps(left, _mm256_setzero_ps(), _CMP_LE_OQ));
+    }
+
+    died = _mm256_movemask_ps(dead8) != 0;
+#endif
+#if defined(__SSE2__)
+    __m128 dead4 = _mm_setzero_ps();
+    __m128 dt4 = _mm_set1_ps(dt);
+    __m128 keep4 = _mm_set1_ps(keep);
+    __m128 fall4 = _mm_set1_ps(fall);
+    for (; i + 4 <= n; i += 4) {
+      __m128 x = _mm_mul_ps(_mm_loadu_ps(vx + i), keep4);
+      __m128 y = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(vy + i), keep4), fall4);
+      _mm_storeu_ps(vx + i, x);
+      _mm_storeu_ps(vy + i, y);
+      _mm_storeu_ps(px + i,
+                    _mm_add_ps(_mm_loadu_ps(px + i), _mm_mul_ps(x, dt4)));
+      _mm_storeu_ps(py + i,
+                    _mm_add_ps(_mm_loadu_ps(py + i), _mm_mul_ps(y, dt4)));
+
+      __m128 left = _mm_sub_ps(_mm_loadu_ps(l + i), dt4);
+      _mm_storeu_ps(l + i, left);
+      dead4 = _mm_or_ps(dead4, _mm_cmple_ps(left, _mm_setzero_ps()));
+    }
+
+    died |= _mm_movemask_ps(dead4) != 0;
+#endif
+    for (; i < n; ++i) {
+      vx[i] = vx[i] * keep;
+      vy[i] = vy[i] * keep + fall;
+      px[i] += vx[i] * dt;
+      py[i] += vy[i] * dt;
+      l[i] -= dt;
+      died |= l[i] <= 0;
+    }
+
+    return died;
+  }
+
+  // packs the live ones of [begin, begin + n) down to out; out <= begin, so
+  // nothing is read after it's been overwritten
+  // survivors are listed first (branch-free), then each array is gathered
+  // on its own, so the stores walk forward instead of waiting on the loads
+  int Compact(int begin, int n, int out) {
+    int keep[BATCH];
+    int k = 0;
+    for (int i = begin; i < begin + n; ++i) {
+      keep[k] = i;
+      k += life[i] > 0;
+    }
+
+    Gather(posX.data(), keep, k, out);
+    Gather(posY.data(), keep, k, out);
+    Gather(velX.data(), keep, k, out);
+    Gather(velY.data(), keep, k, out);
+    Gather(life.data(), keep, k, out);
+    Gather(invLifetime.data(), keep, k, out);
+    Gather(color.data(), keep, k, out);
+
+    return out + k;
+  }
+
+  template <typename T>
+  static void Gather(T *a, const int *keep, int k, int out) {
+    for (int j = 0; j < k; ++j) {
+      a[out + j] = a[keep[j]];
+    }
+  }
+
+  void Move(int from, int to, int n) {
+    if (from == to || n == 0) {
+      return;
+    }
+
+    memmove(&posX[to], &posX[from], n * sizeof(float));
+    memmove(&posY[to], &posY[from], n * sizeof(float));
+    memmove(&velX[to], &velX[from], n * sizeof(float));
+    memmove(&velY[to], &velY[from], n * sizeof(float));
+    memmove(&life[to], &life[from], n * sizeof(float));
+    memmove(&invLifetime[to], &invLifetime[from], n * sizeof(float));
+    memmove(&color[to], &color[from], n * sizeof(SDL_Color));
+  }
+
+  // worker index steps ranges[index] each time the generation moves on
+  void Work(int index) {
+    std::unique_lock<std::mutex> lock(mtx);
+    Uint32 seen = 0;
+
+    while (true) {
+      cv.wait(lock, [&] { return !running || generation != seen; });
+      if (!running) {
+        return;
+      }
+
+      seen = generation;
+      float dt = jobDt;
+
+      lock.unlock();
+      Range &r = ranges[index];
+      r.alive = Step(r.begin, r.end, dt);
+      lock.lock();
+
+      if (--pending == 0) {
+        doneCv.notify_one();
+      }
+    }
+  }
+
+  std::vector<float> posX;
+  std::vector<float> posY;
+  std::vector<float> velX;
+  std::vector<float> velY;
+  std::vector<float> life;
+  std::vector<float> invLifetime;
+  std::vector<SDL_Color> color;
+
+  int count;
+  int capacity;
+
+  float gravity;
+  float drag;
+  float size;
+
+  int dropped;
+  int drawn;
+
+  // one draw's worth
+  std::vector<SDL_Vertex> vertices;
+  std::vector<int> indices;
+  int maxDrawn;
+
+  // shared with the workers, under mtx; a worker only touches the arrays
+  // inside its own range
+  std::vector<std::thread> workers;
+  std::vector<Range> ranges;
+  std::mutex mtx;
+  std::condition_variable cv;
+  std::condition_variable doneCv;
+  bool running;
+  Uint32 generation;
+  int pending;
+  float jobDt;
+};
@@ -0,0 +1,364 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <chrono>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// per-phase cpu counters for bench runs, from linux perf_event_open
+// one counter group is opened on the main thread (user space only, so it
+// works with the default perf_event_paranoid); each phase reads the group
+// on Begin and End and keeps the difference, so the numbers are what that
+// phase cost on this thread, worker threads not included
+// hardware counters (cycles, instructions, cache and branch misses) are
+// tried first; vms and containers often don't have them, so then it falls
+// back to software ones (task clock, page faults, context switches), and
+// with none at all only wall time is kept
+//
+// usage:
+//   perf.Open();
+//   perf.Begin(PERF_PHASE_POLL);
+//   ...
+//   perf.End(PERF_PHASE_POLL);
+//   perf.Print();
+
+typedef enum LPerfPhase {
+  PERF_PHASE_POLL,
+  PERF_PHASE_TILES,
+  PERF_PHASE_MOVE,
+  PERF_PHASE_PRESENT,
+  PERF_PHASE_COUNT
+} LPerfPhase;
+
+typedef enum LPerfCounter {
+  PERF_CYCLES,
+  PERF_INSTRUCTIONS,
+  PERF_CACHE_MISSES,
+  PERF_BRANCH_MISSES,
+
+  PERF_TASK_CLOCK,
+  PERF_PAGE_FAULTS,
+  PERF_CONTEXT_SWITCHES,
+
+  PERF_COUNTER_COUNT
+} LPerfCounter;
+
+class LPerfCounters {
+public:
+  LPerfCounters() {
+    leader = -1;
+    nOpen = 0;
+    hardware = false;
+    open = false;
+
+    for (int i = 0; i < PERF_COUNTER_COUNT; ++i) {
+      fds[i] = -1;
+      slot[i] = -1;
+    }
+
+    for (int i = 0; i < PERF_PHASE_COUNT; ++i) {
+      for (int c = 0; c < PERF_COUNTER_COUNT; ++c) {
+        phases[i].start[c] = 0;
+        phases[i].total[c] = 0;
+      }
+
+      phases[i].ns = 0;
+      phases[i].calls = 0;
+    }
+  }
+
+  ~LPerfCounters() { Close(); }
+
+  // false if no counters at all could be opened; phases are still timed
+  // either way
+  bool Open() {
+    Close();
+    open = true;
+
+#if defined(__linux__)
+    int hwErr = OpenGroup(PERF_CYCLES, PERF_BRANCH_MISSES);
+    if (nOpen > 0) {
+      hardware = true;
+    }
+
+    else {
+      int swErr = OpenGroup(PERF_TASK_CLOCK, PERF_CONTEXT_SWITCHES);
+      if (nOpen == 0) {
+        printf("perf counters unavailable (%s), timing phases only\n",
+               strerror(swErr));
+        return false;
+      }
+
+      printf("no hardware perf counters (%s), using software counters\n",
+             strerror(hwErr));
+    }
+
+    ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+
+    return true;
+#else
+    printf("perf counters need linux, timing phases only\n");
+    return false;
+#endif
+  }
+
+  void Close() {
+#if defined(__linux__)
+    for (int i = 0; i < PERF_COUNTER_COUNT; ++i) {
+      if (fds[i] >= 0) {
+        close(fds[i]);
+      }
+    }
+#endif
+
+    for (int i = 0; i < PERF_COUNTER_COUNT; ++i) {
+      fds[i] = -1;
+      slot[i] = -1;
+    }
+
+    leader = -1;
+    nOpen = 0;
+    hardware = false;
+    open = false;
+  }
+
+  bool IsOpen() { return open; }
+
+  bool HasHardware() { return hardware; }
+
+  // does nothing unless Open was called
+  void Begin(LPerfPhase phase) {
+    if (!open) {
+      return;
+    }
+
+    Phase &p = phases[phase];
+    Read(p.start);
+    p.startTime = std::chrono::high_resolution_clock::now();
+  }
+
+  void End(LPerfPhase phase) {
+    if (!open) {
+      return;
+    }
+
+    Phase &p = phases[phase];
+    auto now = std::chrono::high_resolution_clock::now();
+
+    Uint64 end[PERF_COUNTER_COUNT];
+    Read(end);
+
+    for (int i = 0; i < nOpen; ++i) {
+      p.total[i] += end[i] - p.start[i];
+    }
+
+    p.ns += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                now - p.startTime)
+                .count();
+    p.calls++;
+  }
+
+  // one row per phase; rates are per call, misses per 1000 instructions
+  void Print() {
+    if (!open) {
+      return;
+    }
+
+    static const char *NAMES[PERF_PHASE_COUNT] = {"event poll", "tiles",
+                                                  "player move", "present"};
+
+    if (hardware) {
+      printf("%-12s %8s %10s %12s %12s %6s %10s %10s\n", "phase", "calls",
+             "ms/call", "cycles", "instr", "ipc", "cache mpki",
+             "branch mpki");
+    }
+
+    else if (nOpen > 0) {
+      printf("%-12s %8s %10s %12s %12s %12s\n", "phase", "calls", "ms/call",
+             "task ms", "faults", "ctx switches");
+    }
+
+    else {
+      printf("%-12s %8s %10s\n", "phase", "calls", "ms/call");
+    }
+
+    for (int i = 0; i < PERF_PHASE_COUNT; ++i) {
+      Phase &p = phases[i];
+      if (p.calls == 0) {
+        continue;
+      }
+
+      double calls = (double)p.calls;
+      printf("%-12s %8d %10.4f", NAMES[i], p.calls, p.ns / calls / 1e6);
+
+      if (hardware) {
+        double cycles = Total(p, PERF_CYCLES);
+        double instr = Total(p, PERF_INSTRUCTIONS);
+        double cache = Total(p, PERF_CACHE_MISSES);
+        double branch = Total(p, PERF_BRANCH_MISSES);
+
+        printf(" %12.0f %12.0f", cycles / calls, instr / calls);
+        PrintRate(instr, cycles, 1, 6);
+        PrintRate(cache, instr, 1000, 10);
+        PrintRate(branch, instr, 1000, 10);
+      }
+
+      else if (nOpen > 0) {
+        printf(" %12.4f %12.2f %12.2f",
+               Total(p, PERF_TASK_CLOCK) / calls / 1e6,
+               Total(p, PERF_PAGE_FAULTS) / calls,
+               Total(p, PERF_CONTEXT_SWITCHES) / calls);
+      }
+
+      printf("\n");
+    }
+
+    // counters the kernel didn't have show as -
+    if (hardware && (slot[PERF_CACHE_MISSES] < 0 ||
+                     slot[PERF_BRANCH_MISSES] < 0)) {
+      printf("(- : counter not supported here)\n");
+    }
+  }
+
+private:
+  struct Phase {
+    Uint64 start[PERF_COUNTER_COUNT];
+    Uint64 total[PERF_COUNTER_COUNT];
+    std::chrono::high_resolution_clock::time_point startTime;
+    Uint64 ns;
+    int calls;
+  };
+
+  // -1 if the counter isn't open
+  double Total(Phase &p, LPerfCounter c) {
+    return slot[c] < 0 ? -1 : (double)p.total[slot[c]];
+  }
+
+  // num / den * scale in a column width wide, or - if either is missing
+  static void PrintRate(double num, double den, double scale, int width) {
+    if (num < 0 || den <= 0) {
+      printf(" %*s", width, "-");
+      return;
+    }
+
+    printf(" %*.2f", width, num / den * scale);
+  }
+
+#if defined(__linux__)
+  // opens counters first..last into one group, skipping any the kernel
+  // refuses; returns the first error seen
+  int OpenGroup(int first, int last) {
+    int err = 0;
+
+    for (int c = first; c <= last; ++c) {
+      perf_event_attr attr;
+      memset(&attr, 0, sizeof(attr));
+      attr.size = sizeof(attr);
+      Describe((LPerfCounter)c, attr);
+
+      attr.disabled = leader < 0;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      attr.read_format = PERF_FORMAT_GROUP;
+
+      int fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0);
+      if (fd < 0) {
+        if (err == 0) {
+          err = errno;
+        }
+
+        continue;
+      }
+
+      if (leader < 0) {
+        leader = fd;
+      }
+
+      fds[c] = fd;
+      slot[c] = nOpen++;
+    }
+
+    return err;
+  }
+
+  static void Describe(LPerfCounter c, perf_event_attr &attr) {
+    switch (c) {
+    case PERF_CYCLES:
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.config = PERF_COUNT_HW_CPU_CYCLES;
+      break;
+
+    case PERF_INSTRUCTIONS:
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+      break;
+
+    case PERF_CACHE_MISSES:
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.config = PERF_COUNT_HW_CACHE_MISSES;
+      break;
+
+    case PERF_BRANCH_MISSES:
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+      break;
+
+    case PERF_TASK_CLOCK:
+      attr.type = PERF_TYPE_SOFTWARE;
+      attr.config = PERF_COUNT_SW_TASK_CLOCK;
+      break;
+
+    case PERF_PAGE_FAULTS:
+      attr.type = PERF_TYPE_SOFTWARE;
+      attr.config = PERF_COUNT_SW_PAGE_FAULTS;
+      break;
+
+    default:
+      attr.type = PERF_TYPE_SOFTWARE;
+      attr.config = PERF_COUNT_SW_CONTEXT_SWITCHES;
+      break;
+    }
+  }
+#endif
+
+  // the whole group in one read: count, then one value per open counter
+  void Read(Uint64 *values) {
+#if defined(__linux__)
+    if (leader >= 0) {
+      Uint64 buf[1 + PERF_COUNTER_COUNT];
+      if (read(leader, buf, sizeof(buf)) > 0) {
+        for (int i = 0; i < nOpen && i < (int)buf[0]; ++i) {
+          values[i] = buf[1 + i];
+        }
+
+        return;
+      }
+    }
+#endif
+
+    for (int i = 0; i < nOpen; ++i) {
+      values[i] = 0;
+    }
+  }
+
+  int fds[PERF_COUNTER_COUNT];
+
+  // index into the group's read values, or -1
+  int slot[PERF_COUNTER_COUNT];
+
+  int leader;
+  int nOpen;
+  bool hardware;
+  bool open;
+
+  Phase phases[PERF_PHASE_COUNT];
+};
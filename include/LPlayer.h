@@ -0,0 +1,217 @@
+#pragma once
+
+#include "LEngine.h"
+#include "LSprite.h"
+#include "LStateArena.h"
+#include "LTexture.h"
+#include "LTile.h"
+
+#include <SDL2/SDL.h>
+#include <stdlib.h>
+#include <vector>
+
+inline LTexture tSpriteSheet;
+inline SDL_Rect charSpriteClips[] = {{0, 0, 16, 16}, {0, 16, 16, 16}};
+
+class Player {
+public:
+  static const int PLAYER_VEL = 5;
+
+  LSprite sprite;
+
+  // sprite doesn't have a default constructor; must explicitly initialize it
+  // using this syntax
+  Player() : sprite(&tSpriteSheet, charSpriteClips, 2) {
+    posX = 0;
+    posY = 0;
+
+    velX = 0;
+    velY = 0;
+
+    // will take the dimensions of curr. frame, for better or worse
+    collider.w = 0;
+    collider.h = 0;
+  }
+
+  SDL_Rect *GetCollider() { return &this->collider; }
+
+  void HandleEvent(SDL_Event &e) {
+    // when key is pressed, update velocity to match direction
+    if (e.type == SDL_KEYDOWN && e.key.repeat == 0) {
+      switch (e.key.keysym.sym) {
+      case SDLK_UP:
+        velY -= PLAYER_VEL;
+        break;
+      case SDLK_DOWN:
+        velY += PLAYER_VEL;
+        break;
+      case SDLK_LEFT:
+        velX -= PLAYER_VEL;
+        break;
+      case SDLK_RIGHT:
+        velX += PLAYER_VEL;
+        break;
+      }
+    }
+
+    // when key released, undo vel change not by setting to 0, but by
+    // subtracting what the downpress did very logical, it doesn't mess with
+    // any other vel changes we made!
+    else if (e.type == SDL_KEYUP && e.key.repeat == 0) {
+      switch (e.key.keysym.sym) {
+      case SDLK_UP:
+        velY += PLAYER_VEL;
+        break;
+      case SDLK_DOWN:
+        velY -= PLAYER_VEL;
+        break;
+      case SDLK_LEFT:
+        velX += PLAYER_VEL;
+        break;
+      case SDLK_RIGHT:
+        velX -= PLAYER_VEL;
+        break;
+      }
+    }
+  }
+
+  void SetPosition(int x, int y) {
+    posX = x;
+    posY = y;
+  }
+
+  bool CheckTileCollisions(Tile **candidates, int nCandidates) {
+    for (int i = 0; i < nCandidates; ++i) {
+      if (CheckCollision(collider, *candidates[i]->GetCollider())) {
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  // tiles that could touch the player anywhere along this move; the two
+  // axis checks only look at these
+  int GatherCandidates(std::vector<Tile> &tiles, int camX, int camY,
+                       Tile **out) {
+    SDL_Rect reach = {posX - camX - abs(velX), posY - camY - abs(velY),
+                      sprite.GetWidth() + 2 * abs(velX),
+                      sprite.GetHeight() + 2 * abs(velY)};
+
+    int n = 0;
+    for (int i = 0; i < tiles.size(); ++i) {
+      if (CheckCollision(reach, *tiles[i].GetCollider())) {
+        out[n++] = &tiles[i];
+      }
+    }
+
+    return n;
+  }
+
+  int GetPosX() { return posX; }
+
+  int GetPosY() { return posY; }
+
+  void Move(std::vector<Tile> &tiles, int camX, int camY) {
+    // candidate list only lives for this frame; if the arena can't hold
+    // one pointer per tile, use a list that only ever grows, so collision
+    // is never skipped
+    Tile **candidates = frameArena.AllocArray<Tile *>(tiles.size());
+    if (candidates == NULL) {
+      if (spareCandidates.size() < tiles.size()) {
+        spareCandidates.resize(tiles.size());
+      }
+
+      candidates = spareCandidates.data();
+    }
+
+    int nCandidates = GatherCandidates(tiles, camX, camY, candidates);
+
+    // update collider with position
+    // this fixes clipping (how???)
+    posX += velX;
+    collider.x = posX - camX;
+    collider.w = sprite.GetWidth();
+
+    // reverse vel if hit bounds
+    // account for the fact that pos is in topleft for 2nd part of ||
+    // dont move if colliding
+    if (posX < levelBounds.x ||
+        posX + sprite.GetWidth() > levelBounds.x + levelBounds.w ||
+        CheckTileCollisions(candidates, nCandidates)) {
+      posX -= velX;
+      collider.x = posX;
+    }
+
+    posY += velY;
+    collider.y = posY - camY;
+    collider.h = sprite.GetHeight();
+
+    if (posY < levelBounds.y ||
+        posY + sprite.GetHeight() > levelBounds.y + levelBounds.h ||
+        CheckTileCollisions(candidates, nCandidates)) {
+      posY -= velY;
+      collider.y = posY;
+    }
+  }
+
+  void Render(int camX, int camY) {
+    // walk while there's velocity; held keys alone don't count, since the
+    // arrows can belong to the text box (see Stop)
+    if (velX != 0 || velY != 0) {
+      sprite.SetFPS(4);
+    }
+
+    else {
+      sprite.SetFPS(0);
+    }
+
+    sprite.Render(posX - camX, posY - camY);
+  }
+
+  void PlaySound() {
+    if (sprite.GetMovedFrame()) {
+      voices.Play(step, SOUND_PRIORITY_HIGH, posX + sprite.GetWidth() / 2,
+                  posY + sprite.GetHeight() / 2, SDL_GetTicks());
+    }
+  }
+
+  // drops the held-key velocity, e.g. while the keyboard is typing instead
+  void Stop() {
+    velX = 0;
+    velY = 0;
+  }
+
+  // velocity tracks held keys through down/up deltas, so after restoring an
+  // old snapshot it has to be rebuilt from what's actually held now
+  void ResyncVelocity() {
+    velX = ((int)KEYS[RIGHT] - (int)KEYS[LEFT]) * PLAYER_VEL;
+    velY = ((int)KEYS[DOWN] - (int)KEYS[UP]) * PLAYER_VEL;
+  }
+
+  void Snapshot(LStateArena &a) {
+    a.Write(posX);
+    a.Write(posY);
+    a.Write(velX);
+    a.Write(velY);
+    a.Write(collider);
+    sprite.Snapshot(a);
+  }
+
+  void Restore(LStateArena &a) {
+    a.Read(posX);
+    a.Read(posY);
+    a.Read(velX);
+    a.Read(velY);
+    a.Read(collider);
+    sprite.Restore(a);
+  }
+
+private:
+  int posX, posY;
+  int velX, velY;
+  SDL_Rect collider;
+
+  // Move's fallback when the frame arena is full
+  std::vector<Tile *> spareCandidates;
+};
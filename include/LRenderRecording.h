@@ -0,0 +1,678 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <SDL_rwops.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+// render command recording, little endian:
+//   header: Uint32 magic, Uint32 version, Uint32 width, Uint32 height
+//   records: Uint8 type, payload
+// payload per type:
+//   texture:     varint id, varint w, varint h, Uint8 blend mode,
+//                w * h * 4 bytes of rgba
+//   free:        varint id
+//   color mod:   varint id, Uint8 r, g, b
+//   alpha mod:   varint id, Uint8 a
+//   blend mode:  varint id, Uint8 mode
+//   copy:        varint id, Uint8 flags, [zigzag src x y w h],
+//                zigzag dst x y w h, [float angle (as Uint32 bits), Uint8 flip]
+//                [zigzag center x y]
+//   clear:       Uint8 r, g, b, a (the draw color at the time)
+//   present:     nothing
+// texture ids are handed out per load, so a text texture that's rendered again
+// gets a new id along with its new pixels
+// only what reaches the window is recorded; draws and clears while a render
+// target is bound (the hud cache) are skipped, since the stream has no
+// targets and they'd land on the window in the replay
+
+const Uint32 RENDER_MAGIC = 0x31435252; // "RRC1"
+const Uint32 RENDER_VERSION = 1;
+
+typedef enum RenderRecordType {
+  RENDER_RECORD_TEXTURE,
+  RENDER_RECORD_FREE,
+  RENDER_RECORD_COLOR_MOD,
+  RENDER_RECORD_ALPHA_MOD,
+  RENDER_RECORD_BLEND_MODE,
+  RENDER_RECORD_COPY,
+  RENDER_RECORD_CLEAR,
+  RENDER_RECORD_PRESENT
+} RenderRecordType;
+
+// copy flags
+const Uint8 RENDER_COPY_SRC = 1;
+const Uint8 RENDER_COPY_EX = 2;
+const Uint8 RENDER_COPY_CENTER = 4;
+
+class LRenderRecorder {
+public:
+  LRenderRecorder() {
+    file = NULL;
+    nextId = 1;
+    commands = 0;
+    frames = 0;
+  }
+
+  ~LRenderRecorder() { Close(); }
+
+  bool Open(const char *path, int width, int height) {
+    file = SDL_RWFromFile(path, "wb");
+    if (file == NULL) {
+      printf("Unable to open render recording: %s\n", SDL_GetError());
+      return false;
+    }
+
+    SDL_WriteLE32(file, RENDER_MAGIC);
+    SDL_WriteLE32(file, RENDER_VERSION);
+    SDL_WriteLE32(file, width);
+    SDL_WriteLE32(file, height);
+
+    // records are small, so this never grows between flushes
+    buffer.reserve(FLUSH_BYTES + 256);
+
+    commands = 0;
+    frames = 0;
+
+    return true;
+  }
+
+  bool IsOpen() { return file != NULL; }
+
+  // every load gets one, recording or not
+  Uint32 NewTextureId() { return nextId++; }
+
+  // pixels come from the surface the texture was made from, before it's freed
+  void DefineTexture(Uint32 id, SDL_Surface *surface, SDL_Texture *texture) {
+    if (file == NULL) {
+      return;
+    }
+
+    SDL_Surface *rgba =
+        SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_RGBA32, 0);
+    if (rgba == NULL) {
+      printf("Unable to convert texture %u for recording: %s\n", id,
+             SDL_GetError());
+      return;
+    }
+
+    SDL_BlendMode mode = SDL_BLENDMODE_NONE;
+    SDL_GetTextureBlendMode(texture, &mode);
+
+    buffer.push_back(RENDER_RECORD_TEXTURE);
+    PushVarint(id);
+    PushVarint(rgba->w);
+    PushVarint(rgba->h);
+    buffer.push_back((Uint8)mode);
+
+    // pixels go straight to the file, they'd only be copied once more here
+    Flush();
+
+    SDL_LockSurface(rgba);
+    for (int y = 0; y < rgba->h; ++y) {
+      SDL_RWwrite(file, (Uint8 *)rgba->pixels + y * rgba->pitch, rgba->w * 4,
+                  1);
+    }
+    SDL_UnlockSurface(rgba);
+
+    SDL_FreeSurface(rgba);
+  }
+
+  void FreeTexture(Uint32 id) {
+    if (file == NULL) {
+      return;
+    }
+
+    buffer.push_back(RENDER_RECORD_FREE);
+    PushVarint(id);
+
+    FlushIfFull();
+  }
+
+  void ColorMod(Uint32 id, Uint8 r, Uint8 g, Uint8 b) {
+    if (file == NULL) {
+      return;
+    }
+
+    buffer.push_back(RENDER_RECORD_COLOR_MOD);
+    PushVarint(id);
+    buffer.push_back(r);
+    buffer.push_back(g);
+    buffer.push_back(b);
+
+    FlushIfFull();
+  }
+
+  void AlphaMod(Uint32 id, Uint8 a) {
+    if (file == NULL) {
+      return;
+    }
+
+    buffer.push_back(RENDER_RECORD_ALPHA_MOD);
+    PushVarint(id);
+    buffer.push_back(a);
+
+    FlushIfFull();
+  }
+
+  void BlendMode(Uint32 id, SDL_BlendMode mode) {
+    if (file == NULL) {
+      return;
+    }
+
+    buffer.push_back(RENDER_RECORD_BLEND_MODE);
+    PushVarint(id);
+    buffer.push_back((Uint8)mode);
+
+    FlushIfFull();
+  }
+
+  void Copy(SDL_Renderer *renderer, Uint32 id, const SDL_Rect *src,
+            const SDL_Rect *dst) {
+    if (file == NULL || !OnWindow(renderer)) {
+      return;
+    }
+
+    CopyHeader(id, src != NULL ? RENDER_COPY_SRC : 0, src, dst);
+
+    commands++;
+    FlushIfFull();
+  }
+
+  void CopyEx(SDL_Renderer *renderer, Uint32 id, const SDL_Rect *src,
+              const SDL_Rect *dst, double angle, const SDL_Point *center,
+              SDL_RendererFlip flip) {
+    if (file == NULL || !OnWindow(renderer)) {
+      return;
+    }
+
+    Uint8 flags = RENDER_COPY_EX;
+    flags |= src != NULL ? RENDER_COPY_SRC : 0;
+    flags |= center != NULL ? RENDER_COPY_CENTER : 0;
+
+    CopyHeader(id, flags, src, dst);
+
+    float a = (float)angle;
+    Uint32 angleBits;
+    memcpy(&angleBits, &a, 4);
+    PushLE32(angleBits);
+    buffer.push_back((Uint8)flip);
+
+    if (center != NULL) {
+      PushZigzag(center->x);
+      PushZigzag(center->y);
+    }
+
+    commands++;
+    FlushIfFull();
+  }
+
+  // clears with whatever the draw color is, so that's recorded too
+  void Clear(SDL_Renderer *renderer) {
+    if (file == NULL || !OnWindow(renderer)) {
+      return;
+    }
+
+    Uint8 r = 0, g = 0, b = 0, a = 0;
+    SDL_GetRenderDrawColor(renderer, &r, &g, &b, &a);
+
+    buffer.push_back(RENDER_RECORD_CLEAR);
+    buffer.push_back(r);
+    buffer.push_back(g);
+    buffer.push_back(b);
+    buffer.push_back(a);
+
+    commands++;
+    FlushIfFull();
+  }
+
+  void Present() {
+    if (file == NULL) {
+      return;
+    }
+
+    buffer.push_back(RENDER_RECORD_PRESENT);
+
+    frames++;
+    FlushIfFull();
+  }
+
+  void Close() {
+    if (file == NULL) {
+      return;
+    }
+
+    Flush();
+
+    SDL_RWclose(file);
+    file = NULL;
+
+    printf("render recording: %d frames, %d commands\n", frames, commands);
+  }
+
+private:
+  // written in chunks so recording doesn't hit the disk every frame
+  static const size_t FLUSH_BYTES = 64 * 1024;
+
+  static bool OnWindow(SDL_Renderer *renderer) {
+    return SDL_GetRenderTarget(renderer) == NULL;
+  }
+
+  void CopyHeader(Uint32 id, Uint8 flags, const SDL_Rect *src,
+                  const SDL_Rect *dst) {
+    buffer.push_back(RENDER_RECORD_COPY);
+    PushVarint(id);
+    buffer.push_back(flags);
+
+    if (src != NULL) {
+      PushRect(*src);
+    }
+
+    PushRect(*dst);
+  }
+
+  void PushRect(const SDL_Rect &r) {
+    PushZigzag(r.x);
+    PushZigzag(r.y);
+    PushZigzag(r.w);
+    PushZigzag(r.h);
+  }
+
+  void PushLE32(Uint32 v) {
+    for (int i = 0; i < 4; ++i) {
+      buffer.push_back((Uint8)(v >> (i * 8)));
+    }
+  }
+
+  void PushVarint(Uint32 v) {
+    while (v >= 0x80) {
+      buffer.push_back((Uint8)(v | 0x80));
+      v >>= 7;
+    }
+
+    buffer.push_back((Uint8)v);
+  }
+
+  // small negative numbers stay small
+  void PushZigzag(Sint32 v) {
+    PushVarint(((Uint32)v << 1) ^ (Uint32)(v >> 31));
+  }
+
+  void FlushIfFull() {
+    if (buffer.size() >= FLUSH_BYTES) {
+      Flush();
+    }
+  }
+
+  void Flush() {
+    if (!buffer.empty() &&
+        SDL_RWwrite(file, buffer.data(), buffer.size(), 1) != 1) {
+      printf("Unable to write render recording: %s\n", SDL_GetError());
+    }
+
+    buffer.clear();
+  }
+
+  SDL_RWops *file;
+  std::vector<Uint8> buffer;
+
+  Uint32 nextId;
+  int commands;
+  int frames;
+};
+
+// a recording decoded up front into plain commands, with every texture it
+// uses already uploaded, so playing it back is nothing but renderer calls
+class LRenderReplay {
+public:
+  LRenderReplay() {
+    width = 0;
+    height = 0;
+    frames = 0;
+  }
+
+  ~LRenderReplay() { Free(); }
+
+  bool Load(const char *path, SDL_Renderer *renderer) {
+    Free();
+
+    SDL_RWops *file = SDL_RWFromFile(path, "rb");
+    if (file == NULL) {
+      printf("Unable to open render recording: %s\n", SDL_GetError());
+      return false;
+    }
+
+    Sint64 size = SDL_RWsize(file);
+
+    bool ok = size >= 16 && SDL_ReadLE32(file) == RENDER_MAGIC &&
+              SDL_ReadLE32(file) == RENDER_VERSION;
+
+    if (ok) {
+      width = SDL_ReadLE32(file);
+      height = SDL_ReadLE32(file);
+
+      data.resize(size - 16);
+      if (!data.empty() && SDL_RWread(file, data.data(), data.size(), 1) != 1) {
+        ok = false;
+      }
+    }
+
+    SDL_RWclose(file);
+
+    if (!ok) {
+      printf("%s is not a render recording\n", path);
+      return false;
+    }
+
+    pos = 0;
+    ok = Decode(renderer);
+
+    // the commands are all that's needed from here on
+    data.clear();
+    data.shrink_to_fit();
+
+    return ok;
+  }
+
+  int GetWidth() { return width; }
+
+  int GetHeight() { return height; }
+
+  int GetFrames() { return frames; }
+
+  int GetCommandCount() { return commands.size(); }
+
+  int GetTextureCount() {
+    int n = 0;
+    for (size_t i = 0; i < textures.size(); ++i) {
+      n += textures[i].texture != NULL;
+    }
+
+    return n;
+  }
+
+  // bytes of pixels uploaded for the replay
+  size_t GetTextureBytes() {
+    size_t bytes = 0;
+    for (size_t i = 0; i < textures.size(); ++i) {
+      bytes += (size_t)textures[i].w * textures[i].h * 4;
+    }
+
+    return bytes;
+  }
+
+  // plays every command once; onPresent (if set) is called right after each
+  // present, for timing frames
+  void Play(SDL_Renderer *renderer, void (*onPresent)(void *) = NULL,
+            void *userdata = NULL) {
+    // textures start each pass as they were loaded, like they did in game
+    for (size_t i = 0; i < textures.size(); ++i) {
+      if (textures[i].texture != NULL) {
+        SDL_SetTextureColorMod(textures[i].texture, 255, 255, 255);
+        SDL_SetTextureAlphaMod(textures[i].texture, 255);
+        SDL_SetTextureBlendMode(textures[i].texture, textures[i].blend);
+      }
+    }
+
+    for (size_t i = 0; i < commands.size(); ++i) {
+      const Command &c = commands[i];
+      SDL_Texture *t = c.id < textures.size() ? textures[c.id].texture : NULL;
+
+      switch (c.type) {
+      case RENDER_RECORD_COLOR_MOD:
+        SDL_SetTextureColorMod(t, c.color[0], c.color[1], c.color[2]);
+        break;
+
+      case RENDER_RECORD_ALPHA_MOD:
+        SDL_SetTextureAlphaMod(t, c.color[3]);
+        break;
+
+      case RENDER_RECORD_BLEND_MODE:
+        SDL_SetTextureBlendMode(t, (SDL_BlendMode)c.color[0]);
+        break;
+
+      case RENDER_RECORD_COPY:
+        if (c.flags & RENDER_COPY_EX) {
+          SDL_RenderCopyEx(renderer, t,
+                           (c.flags & RENDER_COPY_SRC) ? &c.src : NULL, &c.dst,
+                           c.angle,
+                           (c.flags & RENDER_COPY_CENTER) ? &c.center : NULL,
+                           (SDL_RendererFlip)c.flip);
+        }
+
+        else {
+          SDL_RenderCopy(renderer, t,
+                         (c.flags & RENDER_COPY_SRC) ? &c.src : NULL, &c.dst);
+        }
+        break;
+
+      case RENDER_RECORD_CLEAR:
+        SDL_SetRenderDrawColor(renderer, c.color[0], c.color[1], c.color[2],
+                               c.color[3]);
+        SDL_RenderClear(renderer);
+        break;
+
+      case RENDER_RECORD_PRESENT:
+        SDL_RenderPresent(renderer);
+        if (onPresent != NULL) {
+          onPresent(userdata);
+        }
+        break;
+      }
+    }
+  }
+
+  void Free() {
+    for (size_t i = 0; i < textures.size(); ++i) {
+      if (textures[i].texture != NULL) {
+        SDL_DestroyTexture(textures[i].texture);
+      }
+    }
+
+    textures.clear();
+    commands.clear();
+    frames = 0;
+  }
+
+private:
+  struct Command {
+    Uint8 type;
+    Uint8 flags;
+    Uint8 flip;
+    Uint8 color[4];
+    Uint32 id;
+    SDL_Rect src;
+    SDL_Rect dst;
+    SDL_Point center;
+    double angle;
+  };
+
+  struct Texture {
+    SDL_Texture *texture;
+    SDL_BlendMode blend;
+    int w;
+    int h;
+  };
+
+  // frees mean nothing here; every texture stays up for the whole replay so
+  // uploads never land inside the timed part
+  bool Decode(SDL_Renderer *renderer) {
+    while (pos < data.size()) {
+      Command c;
+      memset(&c, 0, sizeof(c));
+      c.type = data[pos++];
+
+      switch (c.type) {
+      case RENDER_RECORD_TEXTURE:
+        if (!DecodeTexture(renderer)) {
+          return false;
+        }
+        continue;
+
+      case RENDER_RECORD_FREE:
+        ReadVarint();
+        continue;
+
+      case RENDER_RECORD_COLOR_MOD:
+        c.id = ReadVarint();
+        c.color[0] = ReadU8();
+        c.color[1] = ReadU8();
+        c.color[2] = ReadU8();
+        break;
+
+      case RENDER_RECORD_ALPHA_MOD:
+        c.id = ReadVarint();
+        c.color[3] = ReadU8();
+        break;
+
+      case RENDER_RECORD_BLEND_MODE:
+        c.id = ReadVarint();
+        c.color[0] = ReadU8();
+        break;
+
+      case RENDER_RECORD_COPY:
+        c.id = ReadVarint();
+        c.flags = ReadU8();
+
+        if (c.flags & RENDER_COPY_SRC) {
+          c.src = ReadRect();
+        }
+
+        c.dst = ReadRect();
+
+        if (c.flags & RENDER_COPY_EX) {
+          Uint32 angleBits = ReadLE32();
+          float a;
+          memcpy(&a, &angleBits, 4);
+          c.angle = a;
+          c.flip = ReadU8();
+        }
+
+        if (c.flags & RENDER_COPY_CENTER) {
+          c.center.x = ReadZigzag();
+          c.center.y = ReadZigzag();
+        }
+        break;
+
+      case RENDER_RECORD_CLEAR:
+        for (int i = 0; i < 4; ++i) {
+          c.color[i] = ReadU8();
+        }
+        break;
+
+      case RENDER_RECORD_PRESENT:
+        frames++;
+        break;
+
+      default:
+        printf("Unknown render record type %d at byte %zu\n", c.type, pos - 1);
+        return false;
+      }
+
+      commands.push_back(c);
+    }
+
+    return true;
+  }
+
+  bool DecodeTexture(SDL_Renderer *renderer) {
+    Uint32 id = ReadVarint();
+    int w = ReadVarint();
+    int h = ReadVarint();
+    SDL_BlendMode blend = (SDL_BlendMode)ReadU8();
+
+    size_t bytes = (size_t)w * h * 4;
+    if (pos + bytes > data.size()) {
+      printf("Render recording ends inside texture %u\n", id);
+      return false;
+    }
+
+    SDL_Surface *surf = SDL_CreateRGBSurfaceWithFormatFrom(
+        data.data() + pos, w, h, 32, w * 4, SDL_PIXELFORMAT_RGBA32);
+    pos += bytes;
+
+    if (surf == NULL) {
+      printf("Unable to wrap texture %u: %s\n", id, SDL_GetError());
+      return false;
+    }
+
+    SDL_Texture *texture = SDL_CreateTextureFromSurface(renderer, surf);
+    SDL_FreeSurface(surf);
+
+    if (texture == NULL) {
+      printf("Unable to create texture %u: %s\n", id, SDL_GetError());
+      return false;
+    }
+
+    SDL_SetTextureBlendMode(texture, blend);
+
+    if (id >= textures.size()) {
+      Texture none = {NULL, SDL_BLENDMODE_NONE, 0, 0};
+      textures.resize(id + 1, none);
+    }
+
+    // a repeated id would leak the old one otherwise
+    if (textures[id].texture != NULL) {
+      SDL_DestroyTexture(textures[id].texture);
+    }
+
+    Texture t = {texture, blend, w, h};
+    textures[id] = t;
+
+    return true;
+  }
+
+  Uint8 ReadU8() { return pos < data.size() ? data[pos++] : 0; }
+
+  Uint32 ReadLE32() {
+    Uint32 v = 0;
+    for (int i = 0; i < 4; ++i) {
+      v |= (Uint32)ReadU8() << (i * 8);
+    }
+
+    return v;
+  }
+
+  Uint32 ReadVarint() {
+    Uint32 v = 0;
+    int shift = 0;
+
+    while (pos < data.size() && shift < 35) {
+      Uint8 b = data[pos++];
+      v |= (Uint32)(b & 0x7F) << shift;
+
+      if (!(b & 0x80)) {
+        break;
+      }
+
+      shift += 7;
+    }
+
+    return v;
+  }
+
+  Sint32 ReadZigzag() {
+    Uint32 v = ReadVarint();
+    return (Sint32)(v >> 1) ^ -(Sint32)(v & 1);
+  }
+
+  SDL_Rect ReadRect() {
+    SDL_Rect r;
+    r.x = ReadZigzag();
+    r.y = ReadZigzag();
+    r.w = ReadZigzag();
+    r.h = ReadZigzag();
+    return r;
+  }
+
+  std::vector<Uint8> data;
+  size_t pos;
+
+  std::vector<Command> commands;
+  std::vector<Texture> textures;
+
+  int width;
+  int height;
+  int frames;
+};
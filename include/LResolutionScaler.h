@@ -0,0 +1,150 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <vector>
+
+// picks a render scale for the world from recent frame times
+// frames are averaged over a window; a window over budget drops one step
+// right away, but going back up takes several windows with real headroom,
+// so the scale doesn't flip back and forth around the budget
+class LResolutionScaler {
+public:
+  LResolutionScaler() {
+    budgetMs = 0;
+    minScale = 1;
+    maxScale = 1;
+    step = 1;
+    scale = 1;
+
+    windowSum = 0;
+    windowCount = 0;
+    calmWindows = 0;
+    lastAverage = 0;
+    frames = 0;
+  }
+
+  void Init(float budgetMs, float minScale = 0.5f, float maxScale = 1.0f,
+            float step = 0.125f) {
+    this->budgetMs = budgetMs;
+    this->minScale = minScale;
+    this->maxScale = maxScale;
+    this->step = step;
+    scale = maxScale;
+
+    windowSum = 0;
+    windowCount = 0;
+    calmWindows = 0;
+    frames = 0;
+
+    framesAtLevel.assign(GetLevel(minScale) + 1, 0);
+
+    changes.clear();
+    changes.reserve(MAX_CHANGES);
+  }
+
+  // returns true if the scale changed
+  bool AddFrame(float ms) {
+    frames++;
+    framesAtLevel[GetLevel(scale)]++;
+
+    windowSum += ms;
+    windowCount++;
+
+    if (windowCount < WINDOW_FRAMES) {
+      return false;
+    }
+
+    lastAverage = windowSum / windowCount;
+    windowSum = 0;
+    windowCount = 0;
+
+    float next = scale;
+
+    if (lastAverage > budgetMs) {
+      calmWindows = 0;
+      next = SDL_max(scale - step, minScale);
+    }
+
+    else if (lastAverage < budgetMs * HEADROOM) {
+      if (++calmWindows >= CALM_WINDOWS) {
+        calmWindows = 0;
+        next = SDL_min(scale + step, maxScale);
+      }
+    }
+
+    else {
+      calmWindows = 0;
+    }
+
+    if (next == scale) {
+      return false;
+    }
+
+    scale = next;
+
+    // history is fixed size so the frame loop never allocates for it
+    if (changes.size() < changes.capacity()) {
+      Change c = {frames, scale, lastAverage};
+      changes.push_back(c);
+    }
+
+    return true;
+  }
+
+  float GetScale() { return scale; }
+
+  // mean frame time of the last full window
+  float GetLastAverage() { return lastAverage; }
+
+  int GetChangeCount() { return changes.size(); }
+
+  void PrintStats() {
+    printf("dynamic resolution: budget %.2fms, %d scale changes\n", budgetMs,
+           (int)changes.size());
+
+    for (size_t i = 0; i < changes.size(); ++i) {
+      printf("  frame %6d: scale %.3f (window avg %.2fms)\n",
+             changes[i].frame, changes[i].scale, changes[i].averageMs);
+    }
+
+    for (int i = 0; i < (int)framesAtLevel.size(); ++i) {
+      if (framesAtLevel[i] == 0) {
+        continue;
+      }
+
+      printf("  scale %.3f: %5.1f%% of frames\n", maxScale - i * step,
+             100.0f * framesAtLevel[i] / frames);
+    }
+  }
+
+private:
+  static const int WINDOW_FRAMES = 30;
+  static const int CALM_WINDOWS = 4;
+  static constexpr float HEADROOM = 0.7f;
+  static const size_t MAX_CHANGES = 256;
+
+  struct Change {
+    int frame;
+    float scale;
+    float averageMs;
+  };
+
+  // 0 = max scale, counting down in steps
+  int GetLevel(float s) { return (int)((maxScale - s) / step + 0.5f); }
+
+  float budgetMs;
+  float minScale;
+  float maxScale;
+  float step;
+  float scale;
+
+  float windowSum;
+  int windowCount;
+  int calmWindows;
+  float lastAverage;
+  int frames;
+
+  std::vector<int> framesAtLevel;
+  std::vector<Change> changes;
+};
@@ -0,0 +1,197 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <SDL_rwops.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+// savefile layout (all little endian):
+//   Uint32 magic, Uint32 generation, Uint32 raw size, Uint32 encoded size,
+//   rle payload
+// generation pairs the base file with its journal (see LJournaledSave.h)
+// SAV1 files are the same minus the generation; older saves are just the raw
+// Sint32s back to back, so if the magic doesn't match we read the file as-is
+
+const Uint32 SAVE_MAGIC_V1 = 0x31564153; // "SAV1"
+const Uint32 SAVE_MAGIC = 0x32564153;    // "SAV2"
+
+// packbits-style rle; save data is mostly zeroes so this is plenty
+// control byte c < 128: c + 1 literal bytes follow
+// control byte c >= 128: next byte repeats c - 125 times (3..130)
+inline void RleEncode(const Uint8 *src, size_t size, std::vector<Uint8> &out) {
+  out.clear();
+
+  size_t i = 0;
+  while (i < size) {
+    // measure run at i
+    size_t run = 1;
+    while (i + run < size && run < 130 && src[i + run] == src[i]) {
+      run++;
+    }
+
+    if (run >= 3) {
+      out.push_back((Uint8)(run + 125));
+      out.push_back(src[i]);
+      i += run;
+      continue;
+    }
+
+    // gather literals until the next run of 3+ starts
+    size_t start = i;
+    while (i < size && i - start < 128) {
+      if (i + 2 < size && src[i] == src[i + 1] && src[i] == src[i + 2]) {
+        break;
+      }
+
+      i++;
+    }
+
+    out.push_back((Uint8)(i - start - 1));
+    out.insert(out.end(), src + start, src + i);
+  }
+}
+
+// returns false if payload is corrupt or doesn't fill dst exactly
+inline bool RleDecode(const Uint8 *src, size_t size, Uint8 *dst,
+                      size_t dstSize) {
+  size_t i = 0;
+  size_t o = 0;
+
+  while (i < size) {
+    Uint8 c = src[i++];
+
+    if (c < 128) {
+      size_t n = c + 1;
+      if (i + n > size || o + n > dstSize) {
+        return false;
+      }
+
+      memcpy(dst + o, src + i, n);
+      i += n;
+      o += n;
+    }
+
+    else {
+      size_t n = c - 125;
+      if (i >= size || o + n > dstSize) {
+        return false;
+      }
+
+      memset(dst + o, src[i++], n);
+      o += n;
+    }
+  }
+
+  return o == dstSize;
+}
+
+// encodes to a temp file next to path and renames it over the old save, so a
+// crash mid-write never leaves a half-written savefile behind
+// scratch is passed in so repeated saves reuse the same encode buffer
+inline bool WriteSaveFile(const char *path, Uint32 generation,
+                          const Uint8 *data, size_t size,
+                          std::vector<Uint8> &scratch) {
+  RleEncode(data, size, scratch);
+
+  std::string tmpPath = std::string(path) + ".tmp";
+
+  SDL_RWops *file = SDL_RWFromFile(tmpPath.c_str(), "w+b");
+  if (file == NULL) {
+    printf("Unable to save file: %s\n", SDL_GetError());
+    return false;
+  }
+
+  bool ok = SDL_WriteLE32(file, SAVE_MAGIC) == 1 &&
+            SDL_WriteLE32(file, generation) == 1 &&
+            SDL_WriteLE32(file, (Uint32)size) == 1 &&
+            SDL_WriteLE32(file, (Uint32)scratch.size()) == 1;
+
+  if (ok && !scratch.empty()) {
+    ok = SDL_RWwrite(file, scratch.data(), scratch.size(), 1) == 1;
+  }
+
+  if (SDL_RWclose(file) != 0) {
+    ok = false;
+  }
+
+  if (!ok) {
+    printf("Unable to write save: %s\n", SDL_GetError());
+    remove(tmpPath.c_str());
+    return false;
+  }
+
+  if (rename(tmpPath.c_str(), path) != 0) {
+    printf("Unable to replace save %s\n", path);
+    remove(tmpPath.c_str());
+    return false;
+  }
+
+  return true;
+}
+
+// reads the whole decoded save into raw
+// returns false if the file can't be opened or is corrupt
+inline bool ReadSaveFile(const char *path, std::vector<Uint8> &raw,
+                         Uint32 *generation) {
+  SDL_RWops *file = SDL_RWFromFile(path, "rb");
+  if (file == NULL) {
+    return false;
+  }
+
+  Sint64 fileSize = SDL_RWsize(file);
+  Uint32 magic = SDL_ReadLE32(file);
+
+  bool ok = true;
+  *generation = 0;
+
+  if (magic == SAVE_MAGIC || magic == SAVE_MAGIC_V1) {
+    if (magic == SAVE_MAGIC) {
+      *generation = SDL_ReadLE32(file);
+    }
+
+    Uint32 rawSize = SDL_ReadLE32(file);
+    Uint32 encodedSize = SDL_ReadLE32(file);
+
+    // don't trust sizes from a corrupt header
+    if (fileSize < 0 || encodedSize > (Uint64)fileSize ||
+        rawSize > (Uint64)encodedSize * 130) {
+      ok = false;
+    }
+
+    std::vector<Uint8> encoded;
+
+    if (ok) {
+      encoded.resize(encodedSize);
+      raw.resize(rawSize);
+
+      if (encodedSize > 0 &&
+          SDL_RWread(file, encoded.data(), encodedSize, 1) != 1) {
+        ok = false;
+      }
+    }
+
+    if (ok && !RleDecode(encoded.data(), encodedSize, raw.data(), rawSize)) {
+      ok = false;
+    }
+  }
+
+  // legacy save: raw data from the start of the file
+  else {
+    SDL_RWseek(file, 0, RW_SEEK_SET);
+
+    raw.resize(fileSize > 0 ? fileSize : 0);
+    if (!raw.empty() && SDL_RWread(file, raw.data(), raw.size(), 1) != 1) {
+      ok = false;
+    }
+  }
+
+  SDL_RWclose(file);
+
+  if (!ok) {
+    printf("Savefile %s is corrupt\n", path);
+  }
+
+  return ok;
+}
@@ -0,0 +1,607 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// software sprite renderer, for machines where SDL falls back to its own
+// software renderer anyway
+// images are kept as argb pixels and drawn straight into a locked streaming
+// texture, which is copied to the window once per frame
+// every blit is split into an expand step (one source row scaled out to the
+// visible width, done once per source row, not per destination row) and a
+// composite step that writes that row into each destination row
+// both are templates on the scale factor and blend mode, so integer scales
+// (1, 2, 4, 8) and each blend get their own loop with no per-pixel
+// branching; any other stretch goes through a generic nearest neighbour loop
+//
+// usage:
+//   int image = blitter.AddImage(surface);
+//   blitter.Begin(0, 0, 0);
+//   blitter.Blit(image, &clip, &dest);
+//   blitter.End(renderer);
+
+typedef enum LSoftBlend {
+  SOFT_BLEND_OPAQUE,   // every pixel is drawn as is
+  SOFT_BLEND_COLORKEY, // alpha is only ever 0 or 255
+  SOFT_BLEND_ALPHA,    // src over dst
+  SOFT_BLEND_COUNT
+} LSoftBlend;
+
+class LSoftBlitter {
+public:
+  LSoftBlitter() {
+    target = NULL;
+    width = 0;
+    height = 0;
+
+    pixels = NULL;
+    pitch = 0;
+    drawing = false;
+
+    blits = 0;
+    scaledBlits = 0;
+  }
+
+  ~LSoftBlitter() { Free(); }
+
+  bool Init(SDL_Renderer *renderer, int width, int height) {
+    target = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888,
+                               SDL_TEXTUREACCESS_STREAMING, width, height);
+    if (target == NULL) {
+      printf("Unable to create software blit target: %s\n", SDL_GetError());
+      return false;
+    }
+
+    // the frame is complete; nothing under it to blend with
+    SDL_SetTextureBlendMode(target, SDL_BLENDMODE_NONE);
+
+    this->width = width;
+    this->height = height;
+
+    // a blit never writes wider than the target
+    row.resize(width);
+
+    return true;
+  }
+
+  bool IsEnabled() { return target != NULL; }
+
+  // true between Begin and End; draws outside that go to SDL as usual
+  bool IsDrawing() { return drawing; }
+
+  void Free() {
+    if (drawing) {
+      SDL_UnlockTexture(target);
+      drawing = false;
+    }
+
+    if (target != NULL) {
+      SDL_DestroyTexture(target);
+      target = NULL;
+    }
+
+    images.clear();
+    freeImages.clear();
+  }
+
+  // copies the surface's pixels; returns a handle, or -1
+  int AddImage(SDL_Surface *surface) {
+    SDL_Surface *argb =
+        SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_ARGB8888, 0);
+    if (argb == NULL) {
+      printf("Unable to convert image for software blits: %s\n",
+             SDL_GetError());
+      return -1;
+    }
+
+    int handle;
+    if (!freeImages.empty()) {
+      handle = freeImages.back();
+      freeImages.pop_back();
+    }
+
+    else {
+      handle = images.size();
+      images.push_back(Image());
+    }
+
+    Image &img = images[handle];
+    img.w = argb->w;
+    img.h = argb->h;
+    img.pixels.resize((size_t)img.w * img.h);
+
+    SDL_LockSurface(argb);
+    for (int y = 0; y < img.h; ++y) {
+      memcpy(img.pixels.data() + (size_t)y * img.w,
+             (Uint8 *)argb->pixels + y * argb->pitch, img.w * 4);
+    }
+    SDL_UnlockSurface(argb);
+
+    SDL_FreeSurface(argb);
+
+    img.blend = Classify(img.pixels);
+    img.blendNone = false;
+    img.used = true;
+
+    for (int i = 0; i < 4; ++i) {
+      img.mod[i] = 255;
+    }
+
+    return handle;
+  }
+
+  void RemoveImage(int image) {
+    if (!Valid(image)) {
+      return;
+    }
+
+    images[image].used = false;
+    images[image].pixels.clear();
+    images[image].pixels.shrink_to_fit();
+    freeImages.push_back(image);
+  }
+
+  void SetColorMod(int image, Uint8 r, Uint8 g, Uint8 b) {
+    if (Valid(image)) {
+      images[image].mod[0] = r;
+      images[image].mod[1] = g;
+      images[image].mod[2] = b;
+    }
+  }
+
+  void SetAlphaMod(int image, Uint8 a) {
+    if (Valid(image)) {
+      images[image].mod[3] = a;
+    }
+  }
+
+  // only none vs anything else; add and mod draw as blend
+  void SetBlendMode(int image, SDL_BlendMode mode) {
+    if (Valid(image)) {
+      images[image].blendNone = mode == SDL_BLENDMODE_NONE;
+    }
+  }
+
+  // locks the target and clears it; the locked pixels are only ever read
+  // after they've been written this frame
+  bool Begin(Uint8 r, Uint8 g, Uint8 b) {
+    if (target == NULL || drawing) {
+      return false;
+    }
+
+    void *p;
+    int pitchBytes;
+    if (SDL_LockTexture(target, NULL, &p, &pitchBytes) != 0) {
+      printf("Unable to lock software blit target: %s\n", SDL_GetError());
+      return false;
+    }
+
+    pixels = (Uint32 *)p;
+    pitch = pitchBytes / 4;
+
+    Uint32 clear = 0xFF000000 | ((Uint32)r << 16) | ((Uint32)g << 8) | b;
+    for (int y = 0; y < height; ++y) {
+      std::fill(pixels + (size_t)y * pitch, pixels + (size_t)y * pitch + width,
+                clear);
+    }
+
+    drawing = true;
+    return true;
+  }
+
+  // like SDL_RenderCopy(Ex) without rotation
+  void Blit(int image, const SDL_Rect *src, const SDL_Rect *dst,
+            SDL_RendererFlip flip = SDL_FLIP_NONE) {
+    if (!drawing || !Valid(image)) {
+      return;
+    }
+
+    Image &img = images[image];
+
+    SDL_Rect bounds = {0, 0, img.w, img.h};
+    SDL_Rect s = bounds;
+    if (src != NULL && !SDL_IntersectRect(src, &bounds, &s)) {
+      return;
+    }
+
+    SDL_Rect d = dst != NULL ? *dst : SDL_Rect{0, 0, width, height};
+    SDL_Rect screen = {0, 0, width, height};
+    SDL_Rect visible;
+    if (!SDL_IntersectRect(&d, &screen, &visible)) {
+      return;
+    }
+
+    Span span;
+    span.src = img.pixels.data() + (size_t)s.y * img.w + s.x;
+    span.srcPitch = img.w;
+    span.sw = s.w;
+    span.sh = s.h;
+    span.dw = d.w;
+    span.dh = d.h;
+    span.x0 = visible.x - d.x;
+    span.x1 = span.x0 + visible.w;
+    span.y0 = visible.y - d.y;
+    span.y1 = span.y0 + visible.h;
+    span.dst = pixels + (size_t)visible.y * pitch + visible.x;
+    span.dstPitch = pitch;
+    span.flipX = (flip & SDL_FLIP_HORIZONTAL) != 0;
+    span.flipY = (flip & SDL_FLIP_VERTICAL) != 0;
+    span.mod = img.mod;
+    span.modded = img.mod[0] != 255 || img.mod[1] != 255 ||
+                  img.mod[2] != 255 || img.mod[3] != 255;
+
+    int blend = img.blendNone ? SOFT_BLEND_OPAQUE : img.blend;
+    if (!img.blendNone && img.mod[3] != 255) {
+      blend = SOFT_BLEND_ALPHA;
+    }
+
+    // same whole factor both ways
+    int scale = 0;
+    if (d.w % s.w == 0 && d.h % s.h == 0 && d.w / s.w == d.h / s.h) {
+      scale = d.w / s.w;
+    }
+
+    int k = scale == 1   ? 1
+            : scale == 2 ? 2
+            : scale == 4 ? 3
+            : scale == 8 ? 4
+                         : 0;
+
+    static const BlitFn KERNELS[5][SOFT_BLEND_COUNT] = {
+        {BlitSpan<0, SOFT_BLEND_OPAQUE>, BlitSpan<0, SOFT_BLEND_COLORKEY>,
+         BlitSpan<0, SOFT_BLEND_ALPHA>},
+        {BlitSpan<1, SOFT_BLEND_OPAQUE>, BlitSpan<1, SOFT_BLEND_COLORKEY>,
+         BlitSpan<1, SOFT_BLEND_ALPHA>},
+        {BlitSpan<2, SOFT_BLEND_OPAQUE>, BlitSpan<2, SOFT_BLEND_COLORKEY>,
+         BlitSpan<2, SOFT_BLEND_ALPHA>},
+        {BlitSpan<4, SOFT_BLEND_OPAQUE>, BlitSpan<4, SOFT_BLEND_COLORKEY>,
+         BlitSpan<4, SOFT_BLEND_ALPHA>},
+        {BlitSpan<8, SOFT_BLEND_OPAQUE>, BlitSpan<8, SOFT_BLEND_COLORKEY>,
+         BlitSpan<8, SOFT_BLEND_ALPHA>}};
+
+    KERNELS[k][blend](span, row.data());
+
+    blits++;
+    if (k != 0) {
+      scaledBlits++;
+    }
+  }
+
+  // hands the frame to the renderer, stretched over the current target
+  void End(SDL_Renderer *renderer) {
+    if (!drawing) {
+      return;
+    }
+
+    SDL_UnlockTexture(target);
+    pixels = NULL;
+    drawing = false;
+
+    SDL_RenderCopy(renderer, target, NULL, NULL);
+  }
+
+  LSoftBlend GetImageBlend(int image) {
+    return Valid(image) ? images[image].blend : SOFT_BLEND_OPAQUE;
+  }
+
+  // blits so far, and how many of them took an integer scale kernel
+  int GetBlits() { return blits; }
+
+  int GetScaledBlits() { return scaledBlits; }
+
+  // image pixels and the row scratch; the target lives with the renderer but
+  // is counted too
+  size_t GetMemoryUsage() {
+    size_t bytes = row.capacity() * 4 + (size_t)width * height * 4;
+    for (size_t i = 0; i < images.size(); ++i) {
+      bytes += images[i].pixels.capacity() * 4;
+    }
+
+    return bytes;
+  }
+
+private:
+  struct Image {
+    std::vector<Uint32> pixels;
+    int w, h;
+    LSoftBlend blend;
+    bool blendNone;
+    bool used;
+    Uint8 mod[4];
+  };
+
+  // one blit, already clipped; x0..x1 and y0..y1 are the visible part of the
+  // destination, relative to its unclipped top left
+  struct Span {
+    const Uint32 *src;
+    int srcPitch;
+    int sw, sh;
+    int dw, dh;
+    int x0, x1, y0, y1;
+    Uint32 *dst;
+    int dstPitch;
+    bool flipX, flipY;
+    bool modded;
+    const Uint8 *mod;
+  };
+
+  typedef void (*BlitFn)(const Span &s, Uint32 *row);
+
+  bool Valid(int image) {
+    return image >= 0 && image < (int)images.size() && images[image].used;
+  }
+
+  // cheapest blend that draws these pixels the same
+  static LSoftBlend Classify(const std::vector<Uint32> &p) {
+    bool opaque = true;
+    for (size_t i = 0; i < p.size(); ++i) {
+      Uint32 a = p[i] >> 24;
+      if (a != 0 && a != 255) {
+        return SOFT_BLEND_ALPHA;
+      }
+
+      opaque = opaque && a == 255;
+    }
+
+    return opaque ? SOFT_BLEND_OPAQUE : SOFT_BLEND_COLORKEY;
+  }
+
+  template <int SCALE, int BLEND>
+  static void BlitSpan(const Span &s, Uint32 *row) {
+    int n = s.x1 - s.x0;
+    Uint32 *out = s.dst;
+    int lastRow = -1;
+
+    for (int y = s.y0; y < s.y1; ++y, out += s.dstPitch) {
+      int sr = SCALE > 0 ? y / SCALE : (int)((Sint64)y * s.sh / s.dh);
+      if (s.flipY) {
+        sr = s.sh - 1 - sr;
+      }
+
+      // with SCALE 8, one expand feeds 8 rows
+      if (sr != lastRow) {
+        Expand<SCALE>(s, s.src + (size_t)sr * s.srcPitch, row);
+        if (s.modded) {
+          ApplyMods(row, n, s.mod);
+        }
+
+        lastRow = sr;
+      }
+
+      Composite<BLEND>(out, row, n);
+    }
+  }
+
+  // source row -> visible destination columns
+  template <int SCALE>
+  static void Expand(const Span &s, const Uint32 *src, Uint32 *row) {
+    if (SCALE == 0) {
+      // 16.16 fixed point step through the source
+      Sint64 step = ((Sint64)s.sw << 16) / s.dw;
+      Sint64 pos = ((Sint64)s.x0 * s.sw << 16) / s.dw;
+
+      for (int x = s.x0; x < s.x1; ++x, pos += step) {
+        int c = (int)(pos >> 16);
+        *row++ = src[s.flipX ? s.sw - 1 - c : c];
+      }
+
+      return;
+    }
+
+    if (SCALE == 1 && !s.flipX) {
+      memcpy(row, src + s.x0, (s.x1 - s.x0) * 4);
+      return;
+    }
+
+    int x = s.x0;
+
+    // clipped part of the first source pixel
+    while (x < s.x1 && x % SCALE != 0) {
+      *row++ = Source(s, src, x / SCALE);
+      ++x;
+    }
+
+    for (; x + SCALE <= s.x1; x += SCALE) {
+      Fill<SCALE>(row, Source(s, src, x / SCALE));
+      row += SCALE;
+    }
+
+    while (x < s.x1) {
+      *row++ = Source(s, src, x / SCALE);
+      ++x;
+    }
+  }
+
+  static Uint32 Source(const Span &s, const Uint32 *src, int c) {
+    return src[s.flipX ? s.sw - 1 - c : c];
+  }
+
+  // SCALE copies of p
+  template <int SCALE> static void Fill(Uint32 *row, Uint32 p) {
+#if defined(__AVX2__)
+    if (SCALE == 8) {
+      _mm256_storeu_si256((__m256i *)row, _mm256_set1_epi32(p));
+      return;
+    }
+#endif
+
+#if defined(__SSE2__)
+    if (SCALE >= 4) {
+      __m128i v = _mm_set1_epi32(p);
+      for (int i = 0; i < SCALE; i += 4) {
+        _mm_storeu_si128((__m128i *)(row + i), v);
+      }
+      return;
+    }
+#endif
+
+    for (int i = 0; i < SCALE; ++i) {
+      row[i] = p;
+    }
+  }
+
+  // color and alpha mod, the same rounding as SDL's (c * m / 255)
+  static void ApplyMods(Uint32 *row, int n, const Uint8 *mod) {
+    for (int i = 0; i < n; ++i) {
+      Uint32 p = row[i];
+      Uint32 a = (p >> 24) * mod[3] / 255;
+      Uint32 r = ((p >> 16) & 0xFF) * mod[0] / 255;
+      Uint32 g = ((p >> 8) & 0xFF) * mod[1] / 255;
+      Uint32 b = (p & 0xFF) * mod[2] / 255;
+      row[i] = (a << 24) | (r << 16) | (g << 8) | b;
+    }
+  }
+
+  template <int BLEND>
+  static void Composite(Uint32 *dst, const Uint32 *src, int n) {
+    if (BLEND == SOFT_BLEND_OPAQUE) {
+      memcpy(dst, src, n * 4);
+    }
+
+    else if (BLEND == SOFT_BLEND_COLORKEY) {
+      CompositeKeyed(dst, src, n);
+    }
+
+    else {
+      CompositeAlpha(dst, src, n);
+    }
+  }
+
+  // pixels with alpha 0 keep what's under them
+  static void CompositeKeyed(Uint32 *dst, const Uint32 *src, int n) {
+    int i = 0;
+
+#if defined(__AVX2__)
+    __m256i zero8 = _mm256_setzero_si256();
+    for (; i + 8 <= n; i += 8) {
+      __m256i s = _mm256_loadu_si256((const __m256i *)(src + i));
+      __m256i d = _mm256_loadu_si256((const __m256i *)(dst + i));
+      __m256i keyed = _mm256_cmpeq_epi32(_mm256_srli_epi32(s, 24), zero8);
+      _mm256_storeu_si256((__m256i *)(dst + i),
+                          _mm256_blendv_epi8(s, d, keyed));
+    }
+#endif
+
+#if defined(__SSE2__)
+    __m128i zero4 = _mm_setzero_si128();
+    for (; i + 4 <= n; i += 4) {
+      __m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+      __m128i d = _mm_loadu_si128((const __m128i *)(dst + i));
+      __m128i keyed = _mm_cmpeq_epi32(_mm_srli_epi32(s, 24), zero4);
+      _mm_storeu_si128(
+          (__m128i *)(dst + i),
+          _mm_or_si128(_mm_and_si128(keyed, d), _mm_andnot_si128(keyed, s)));
+    }
+#endif
+
+    for (; i < n; ++i) {
+      if (src[i] >> 24) {
+        dst[i] = src[i];
+      }
+    }
+  }
+
+  // dst = src * a + dst * (255 - a), per channel, divided by 255 with
+  // rounding; the target's own alpha isn't used, so it's blended the same
+  static void CompositeAlpha(Uint32 *dst, const Uint32 *src, int n) {
+    int i = 0;
+
+#if defined(__AVX2__)
+    __m256i zero8 = _mm256_setzero_si256();
+    __m256i full8 = _mm256_set1_epi16(255);
+    __m256i half8 = _mm256_set1_epi16(128);
+    for (; i + 8 <= n; i += 8) {
+      __m256i s = _mm256_loadu_si256((const __m256i *)(src + i));
+      __m256i d = _mm256_loadu_si256((const __m256i *)(dst + i));
+
+      __m256i lo = Blend16(_mm256_unpacklo_epi8(s, zero8),
+                           _mm256_unpacklo_epi8(d, zero8), full8, half8);
+      __m256i hi = Blend16(_mm256_unpackhi_epi8(s, zero8),
+                           _mm256_unpackhi_epi8(d, zero8), full8, half8);
+
+      _mm256_storeu_si256((__m256i *)(dst + i), _mm256_packus_epi16(lo, hi));
+    }
+#endif
+
+#if defined(__SSE2__)
+    __m128i zero4 = _mm_setzero_si128();
+    __m128i full4 = _mm_set1_epi16(255);
+    __m128i half4 = _mm_set1_epi16(128);
+    for (; i + 4 <= n; i += 4) {
+      __m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+      __m128i d = _mm_loadu_si128((const __m128i *)(dst + i));
+
+      __m128i lo = Blend16(_mm_unpacklo_epi8(s, zero4),
+                           _mm_unpacklo_epi8(d, zero4), full4, half4);
+      __m128i hi = Blend16(_mm_unpackhi_epi8(s, zero4),
+                           _mm_unpackhi_epi8(d, zero4), full4, half4);
+
+      _mm_storeu_si128((__m128i *)(dst + i), _mm_packus_epi16(lo, hi));
+    }
+#endif
+
+    for (; i < n; ++i) {
+      Uint32 s = src[i], d = dst[i];
+      Uint32 a = s >> 24;
+      Uint32 out = 0;
+
+      for (int shift = 0; shift < 32; shift += 8) {
+        Uint32 t = ((s >> shift) & 0xFF) * a +
+                   ((d >> shift) & 0xFF) * (255 - a) + 128;
+        out |= ((t + (t >> 8)) >> 8) << shift;
+      }
+
+      dst[i] = out;
+    }
+  }
+
+#if defined(__SSE2__)
+  // two pixels as 16 bit bgra lanes
+  static __m128i Blend16(__m128i s, __m128i d, __m128i full, __m128i half) {
+    __m128i a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s, 0xFF), 0xFF);
+    __m128i t = _mm_add_epi16(
+        _mm_add_epi16(_mm_mullo_epi16(s, a),
+                      _mm_mullo_epi16(d, _mm_sub_epi16(full, a))),
+        half);
+    return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+  }
+#endif
+
+#if defined(__AVX2__)
+  static __m256i Blend16(__m256i s, __m256i d, __m256i full, __m256i half) {
+    __m256i a = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(s, 0xFF), 0xFF);
+    __m256i t = _mm256_add_epi16(
+        _mm256_add_epi16(_mm256_mullo_epi16(s, a),
+                         _mm256_mullo_epi16(d, _mm256_sub_epi16(full, a))),
+        half);
+    return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+  }
+#endif
+
+  SDL_Texture *target;
+  int width;
+  int height;
+
+  // locked target while drawing; pitch in pixels
+  Uint32 *pixels;
+  int pitch;
+  bool drawing;
+
+  std::vector<Image> images;
+  std::vector<int> freeImages;
+  std::vector<Uint32> row;
+
+  int blits;
+  int scaledBlits;
+};
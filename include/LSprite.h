@@ -0,0 +1,77 @@
+#pragma once
+
+#include "LEngine.h"
+#include "LStateArena.h"
+#include "LTexture.h"
+
+#include <SDL2/SDL.h>
+
+class LSprite {
+public:
+  LSprite(LTexture *spriteSheet, SDL_Rect *spriteClips, int nFrames) {
+    this->spriteSheet = spriteSheet;
+
+    anim = animations.Create(animations.AddClip(spriteClips, nFrames), 4);
+  }
+
+  ~LSprite() { animations.Destroy(anim); }
+
+  // owns a slot in the system; copies would free it twice
+  LSprite(const LSprite &) = delete;
+  LSprite &operator=(const LSprite &) = delete;
+
+  // seconds into the current frame
+  float GetFrameTimer() {
+    float fps = animations.GetFPS(anim);
+    return fps > 0 ? animations.GetPhase(anim) / fps : 0;
+  }
+
+  // whether the last update stepped to a new frame
+  bool GetMovedFrame() { return animations.GetStepped(anim); }
+
+  int GetFPS() { return (int)animations.GetFPS(anim); }
+
+  int GetWidth() { return spriteSheet->GetWidth(); }
+
+  int GetHeight() { return spriteSheet->GetHeight(); }
+
+  void SetFPS(int fps) { animations.SetFPS(anim, fps); }
+
+  void SetFrame(int f) { animations.SetFrame(anim, f); }
+
+  // only draws; the frame was picked by animations.Update()
+  bool Render(int x, int y) {
+    spriteSheet->Render(x, y, animations.GetFrameRect(anim));
+
+    return GetMovedFrame();
+  }
+
+  // animation state only; sheet and clips are shared resources
+  void Snapshot(LStateArena &a) {
+    Sint32 frame, stepped;
+    float phase, fps;
+    animations.GetState(anim, &frame, &phase, &fps, &stepped);
+
+    a.Write(frame);
+    a.Write(phase);
+    a.Write(fps);
+    a.Write(stepped);
+  }
+
+  void Restore(LStateArena &a) {
+    Sint32 frame, stepped;
+    float phase, fps;
+
+    a.Read(frame);
+    a.Read(phase);
+    a.Read(fps);
+    a.Read(stepped);
+
+    animations.SetState(anim, frame, phase, fps, stepped);
+  }
+
+private:
+  LTexture *spriteSheet;
+
+  int anim;
+};
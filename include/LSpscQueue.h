@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+
+// single producer, single consumer ring buffer; no locks, so the audio
+// callback can pop from it without ever waiting on the game thread
+// N must be a power of two; one thread pushes, one thread pops
+template <typename T, int N> class LSpscQueue {
+  static_assert((N & (N - 1)) == 0, "LSpscQueue size must be a power of two");
+
+public:
+  LSpscQueue() : head(0), tail(0) {}
+
+  // false if full; the item is dropped
+  bool Push(const T &item) {
+    size_t t = tail.load(std::memory_order_relaxed);
+    size_t h = head.load(std::memory_order_acquire);
+
+    if (t - h == N) {
+      return false;
+    }
+
+    items[t & (N - 1)] = item;
+    tail.store(t + 1, std::memory_order_release);
+
+    return true;
+  }
+
+  // false if empty
+  bool Pop(T &item) {
+    size_t h = head.load(std::memory_order_relaxed);
+    size_t t = tail.load(std::memory_order_acquire);
+
+    if (h == t) {
+      return false;
+    }
+
+    item = items[h & (N - 1)];
+    head.store(h + 1, std::memory_order_release);
+
+    return true;
+  }
+
+  // approximate from either side; exact only when the other side is idle
+  size_t Size() {
+    return tail.load(std::memory_order_acquire) -
+           head.load(std::memory_order_acquire);
+  }
+
+private:
+  T items[N];
+
+  // kept on separate cache lines so producer and consumer don't fight
+  alignas(64) std::atomic<size_t> head;
+  alignas(64) std::atomic<size_t> tail;
+};
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+// flat byte buffer game state gets copied in and out of
+// capacity is reserved up front; writes past it are dropped and flagged
+// instead of growing, so snapshotting never allocates mid-frame
+// used keeps counting on overflow, so a dry run tells you the size to reserve
+class LStateArena {
+public:
+  LStateArena(size_t capacity = 0) {
+    buffer.resize(capacity);
+
+    used = 0;
+    readPos = 0;
+    overflowed = false;
+  }
+
+  void Reserve(size_t capacity) {
+    if (capacity > buffer.size()) {
+      buffer.resize(capacity);
+    }
+  }
+
+  // start a new snapshot
+  void Clear() {
+    used = 0;
+    readPos = 0;
+    overflowed = false;
+  }
+
+  // start reading from the top
+  void Rewind() { readPos = 0; }
+
+  void WriteBytes(const void *src, size_t size) {
+    if (used + size > buffer.size()) {
+      overflowed = true;
+    }
+
+    else {
+      memcpy(buffer.data() + used, src, size);
+    }
+
+    used += size;
+  }
+
+  void ReadBytes(void *dst, size_t size) {
+    if (readPos + size > used || readPos + size > buffer.size()) {
+      // reading past the snapshot is a mismatched Snapshot/Restore pair
+      printf("State arena read out of bounds!\n");
+      return;
+    }
+
+    memcpy(dst, buffer.data() + readPos, size);
+    readPos += size;
+  }
+
+  // only for plain data; pointers would restore as dangling addresses
+  template <typename T> void Write(const T &v) { WriteBytes(&v, sizeof(T)); }
+
+  template <typename T> void Read(T &v) { ReadBytes(&v, sizeof(T)); }
+
+  size_t GetUsed() { return used; }
+
+  size_t GetCapacity() { return buffer.size(); }
+
+  bool Overflowed() { return overflowed; }
+
+private:
+  std::vector<Uint8> buffer;
+
+  size_t used;
+  size_t readPos;
+  bool overflowed;
+};
+
+// last N frames of snapshots; Push() hands out the oldest arena to overwrite
+// and Pop() walks back from the newest, which is all rewind needs
+class LSnapshotRing {
+public:
+  LSnapshotRing(int nFrames, size_t frameCapacity = 0) {
+    arenas.resize(nFrames);
+    ticks.resize(nFrames);
+
+    for (int i = 0; i < nFrames; ++i) {
+      arenas[i].Reserve(frameCapacity);
+    }
+
+    head = 0;
+    count = 0;
+  }
+
+  void Reserve(size_t frameCapacity) {
+    for (int i = 0; i < (int)arenas.size(); ++i) {
+      arenas[i].Reserve(frameCapacity);
+    }
+  }
+
+  // cleared arena to snapshot the given tick into
+  LStateArena *Push(Uint32 tick) {
+    LStateArena *arena = &arenas[head];
+    arena->Clear();
+    ticks[head] = tick;
+
+    head = (head + 1) % arenas.size();
+    if (count < (int)arenas.size()) {
+      count++;
+    }
+
+    return arena;
+  }
+
+  // newest snapshot, removed from the ring; NULL when empty
+  LStateArena *Pop(Uint32 *tick = NULL) {
+    if (count == 0) {
+      return NULL;
+    }
+
+    head = (head + arenas.size() - 1) % arenas.size();
+    count--;
+
+    if (tick != NULL) {
+      *tick = ticks[head];
+    }
+
+    arenas[head].Rewind();
+    return &arenas[head];
+  }
+
+  // snapshot from `age` frames ago (0 = newest) without removing it
+  LStateArena *Peek(int age) {
+    if (age < 0 || age >= count) {
+      return NULL;
+    }
+
+    int i = (head + arenas.size() - 1 - age) % arenas.size();
+
+    arenas[i].Rewind();
+    return &arenas[i];
+  }
+
+  int GetCount() { return count; }
+
+  int GetCapacity() { return arenas.size(); }
+
+  size_t GetMemoryUsage() {
+    size_t bytes = ticks.capacity() * sizeof(Uint32);
+    for (size_t i = 0; i < arenas.size(); ++i) {
+      bytes += sizeof(LStateArena) + arenas[i].GetCapacity();
+    }
+
+    return bytes;
+  }
+
+private:
+  std::vector<LStateArena> arenas;
+  std::vector<Uint32> ticks;
+
+  int head;
+  int count;
+};
@@ -0,0 +1,657 @@
+#pragma once
+
+#include "LGapBuffer.h"
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+// editable, word-wrapped text
+// text lives in a gap buffer; lines are just (start, length) into it, so an
+// edit only re-wraps from the line before it until the new breaks line up
+// with the old ones again, and every line after that just shifts
+// each line gets a serial when it's (re)wrapped; the few visible rows keep
+// a texture for the serial they last drew, so only new or changed lines are
+// ever re-rasterized, however long the text is
+// widths come from per-glyph advances (no kerning), which is exact for the
+// pixel font this is used with
+class LTextField {
+public:
+  LTextField() {
+    renderer = NULL;
+    font = NULL;
+    color = {0, 0, 0, 0xFF};
+    wrapWidth = 0;
+    maxVisibleLines = 1;
+    lineHeight = 0;
+
+    cursor = 0;
+    anchor = 0;
+    preferredX = -1;
+    scroll = 0;
+    nextSerial = 1;
+
+    rasterized = 0;
+  }
+
+  ~LTextField() { Free(); }
+
+  void Init(SDL_Renderer *renderer, TTF_Font *font, SDL_Color color,
+            int wrapWidth, int maxVisibleLines) {
+    Free();
+
+    this->renderer = renderer;
+    this->font = font;
+    this->color = color;
+    this->wrapWidth = wrapWidth;
+    this->maxVisibleLines = SDL_min(maxVisibleLines, MAX_ROWS);
+
+    lineHeight = TTF_FontHeight(font);
+
+    for (int c = 0; c < 128; ++c) {
+      asciiAdvance[c] = GlyphAdvance(c < ' ' ? ' ' : c);
+    }
+
+    rows.resize(this->maxVisibleLines);
+    for (int i = 0; i < this->maxVisibleLines; ++i) {
+      rows[i].serial = 0;
+      rows[i].texture = NULL;
+      rows[i].w = 0;
+    }
+
+    SetText("");
+  }
+
+  void Free() {
+    for (size_t i = 0; i < rows.size(); ++i) {
+      if (rows[i].texture != NULL) {
+        SDL_DestroyTexture(rows[i].texture);
+        rows[i].texture = NULL;
+      }
+
+      rows[i].serial = 0;
+    }
+  }
+
+  void SetText(const char *text) {
+    buffer.Clear();
+    lines.clear();
+    cursor = 0;
+    anchor = 0;
+    scroll = 0;
+
+    Reflow(0, 0, 0);
+    Insert(text);
+    anchor = cursor = 0;
+  }
+
+  // at the cursor, replacing the selection
+  void Insert(const char *text) { Insert(text, strlen(text)); }
+
+  void Insert(const char *text, size_t n) {
+    DeleteSelection();
+
+    // pasted windows line endings; \r has no glyph, so it's dropped into
+    // scratch first and the rest goes in with one insert and one reflow
+    if (memchr(text, '\r', n) != NULL) {
+      scratch.resize(n);
+
+      size_t kept = 0;
+      for (size_t i = 0; i < n; ++i) {
+        if (text[i] != '\r') {
+          scratch[kept++] = text[i];
+        }
+      }
+
+      text = scratch.data();
+      n = kept;
+    }
+
+    if (n > 0) {
+      buffer.Insert(cursor, text, n);
+      Reflow(cursor, 0, n);
+      cursor += n;
+    }
+
+    anchor = cursor;
+    preferredX = -1;
+  }
+
+  void Backspace() {
+    if (DeleteSelection() || cursor == 0) {
+      return;
+    }
+
+    size_t prev = PrevChar(cursor);
+    Remove(prev, cursor - prev);
+  }
+
+  void Delete() {
+    if (DeleteSelection() || cursor == buffer.Length()) {
+      return;
+    }
+
+    Remove(cursor, NextChar(cursor) - cursor);
+  }
+
+  // select = extend the selection instead of dropping it
+  void MoveLeft(bool select) {
+    if (!select && HasSelection()) {
+      SetCursor(SelectionStart(), false);
+      return;
+    }
+
+    SetCursor(cursor > 0 ? PrevChar(cursor) : 0, select);
+  }
+
+  void MoveRight(bool select) {
+    if (!select && HasSelection()) {
+      SetCursor(SelectionEnd(), false);
+      return;
+    }
+
+    SetCursor(cursor < buffer.Length() ? NextChar(cursor) : cursor, select);
+  }
+
+  void MoveUp(bool select) { MoveLines(-1, select); }
+
+  void MoveDown(bool select) { MoveLines(1, select); }
+
+  void Home(bool select) { SetCursor(lines[FindLine(cursor)].start, select); }
+
+  void End(bool select) {
+    int l = FindLine(cursor);
+    SetCursor(lines[l].start + VisibleLength(l), select);
+  }
+
+  void SelectAll() {
+    anchor = 0;
+    cursor = buffer.Length();
+  }
+
+  bool HasSelection() { return anchor != cursor; }
+
+  // allocates; for the clipboard, not per frame
+  std::string GetSelectedText() {
+    return GetRange(SelectionStart(), SelectionEnd() - SelectionStart());
+  }
+
+  std::string GetText() { return GetRange(0, buffer.Length()); }
+
+  size_t GetLength() { return buffer.Length(); }
+
+  int GetLineCount() { return lines.size(); }
+
+  int GetLineHeight() { return lineHeight; }
+
+  // visible rows; grows with the text up to maxVisibleLines
+  int GetHeight() {
+    return SDL_min((int)lines.size(), maxVisibleLines) * lineHeight;
+  }
+
+  // lines turned into textures since startup
+  long GetRasterized() { return rasterized; }
+
+  size_t GetMemoryUsage() {
+    size_t bytes = buffer.GetCapacity() + lines.capacity() * sizeof(Line) +
+                   scratch.capacity();
+
+    for (size_t i = 0; i < rows.size(); ++i) {
+      if (rows[i].texture != NULL) {
+        Uint32 format;
+        int w, h;
+        SDL_QueryTexture(rows[i].texture, &format, NULL, &w, &h);
+        bytes += (size_t)SDL_BYTESPERPIXEL(format) * w * h;
+      }
+    }
+
+    return bytes;
+  }
+
+  void Render(int x, int y) {
+    int cursorLine = FindLine(cursor);
+
+    // keep the cursor in view
+    int visible = SDL_min((int)lines.size(), maxVisibleLines);
+    if (cursorLine < scroll) {
+      scroll = cursorLine;
+    }
+
+    if (cursorLine >= scroll + visible) {
+      scroll = cursorLine - visible + 1;
+    }
+
+    scroll = SDL_max(0, SDL_min(scroll, (int)lines.size() - visible));
+
+    AssignRows(visible);
+
+    Uint8 r, g, b, a;
+    SDL_GetRenderDrawColor(renderer, &r, &g, &b, &a);
+
+    size_t selStart = SelectionStart();
+    size_t selEnd = SelectionEnd();
+
+    for (int i = 0; i < visible; ++i) {
+      int l = scroll + i;
+      int rowY = y + i * lineHeight;
+
+      // selection behind the text
+      size_t lineStart = lines[l].start;
+      size_t lineEnd = lineStart + lines[l].length;
+
+      if (selStart < lineEnd && selEnd > lineStart) {
+        int x0 = XAt(l, SDL_max(selStart, lineStart));
+        int x1 = XAt(l, SDL_min(selEnd, lineEnd));
+
+        SDL_Rect sel = {x + x0, rowY, SDL_max(x1 - x0, 4), lineHeight};
+        SDL_SetRenderDrawColor(renderer, 0x40, 0x60, 0xA0, 0xFF);
+        SDL_RenderFillRect(renderer, &sel);
+      }
+
+      Row &row = rows[rowOf[i]];
+      if (row.texture != NULL) {
+        SDL_Rect dest = {x, rowY, row.w, lineHeight};
+        SDL_RenderCopy(renderer, row.texture, NULL, &dest);
+      }
+    }
+
+    // cursor
+    if (cursorLine >= scroll && cursorLine < scroll + visible) {
+      SDL_Rect caret = {x + XAt(cursorLine, cursor),
+                        y + (cursorLine - scroll) * lineHeight, 2,
+                        lineHeight};
+      SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, 0xFF);
+      SDL_RenderFillRect(renderer, &caret);
+    }
+
+    SDL_SetRenderDrawColor(renderer, r, g, b, a);
+  }
+
+private:
+  struct Line {
+    size_t start;
+    // including a trailing newline, if any
+    size_t length;
+    Uint32 serial;
+  };
+
+  struct Row {
+    Uint32 serial;
+    SDL_Texture *texture;
+    int w;
+  };
+
+  int GlyphAdvance(Uint16 c) {
+    int minX, maxX, minY, maxY, advance;
+    if (TTF_GlyphMetrics(font, c, &minX, &maxX, &minY, &maxY, &advance) != 0) {
+      return 0;
+    }
+
+    return advance;
+  }
+
+  // width of the character at pos; *next is where the one after starts
+  int Advance(size_t pos, size_t *next) {
+    unsigned char c = buffer.At(pos);
+
+    if (c < 0x80) {
+      *next = pos + 1;
+      return asciiAdvance[c];
+    }
+
+    *next = NextChar(pos);
+
+    // decode; only the bmp has glyph metrics
+    // a malformed run can have any number of continuation bytes; past 5 the
+    // lead byte's mask would shift out of range
+    int extra = SDL_min((int)(*next - pos - 1), 5);
+    Uint32 code = c & (0x3F >> extra);
+    for (size_t i = pos + 1; i < *next; ++i) {
+      code = (code << 6) | (buffer.At(i) & 0x3F);
+    }
+
+    return GlyphAdvance(code <= 0xFFFF ? (Uint16)code : '?');
+  }
+
+  size_t NextChar(size_t pos) {
+    size_t len = buffer.Length();
+    do {
+      pos++;
+    } while (pos < len && ((unsigned char)buffer.At(pos) & 0xC0) == 0x80);
+
+    return pos;
+  }
+
+  size_t PrevChar(size_t pos) {
+    do {
+      pos--;
+    } while (pos > 0 && ((unsigned char)buffer.At(pos) & 0xC0) == 0x80);
+
+    return pos;
+  }
+
+  // one wrapped line starting at start: up to a newline, the last space
+  // that fits, or (for one long word) the last character that fits
+  size_t WrapLine(size_t start) {
+    size_t len = buffer.Length();
+    size_t pos = start;
+    size_t lastBreak = 0;
+    int width = 0;
+
+    while (pos < len) {
+      char c = buffer.At(pos);
+      if (c == '\n') {
+        return pos + 1 - start;
+      }
+
+      size_t next;
+      width += Advance(pos, &next);
+
+      if (width > wrapWidth && pos > start) {
+        return lastBreak > 0 ? lastBreak : pos - start;
+      }
+
+      if (c == ' ') {
+        lastBreak = next - start;
+      }
+
+      pos = next;
+    }
+
+    return pos - start;
+  }
+
+  // re-wrap after replacing oldLen bytes at pos with newLen bytes
+  void Reflow(size_t pos, size_t oldLen, size_t newLen) {
+    long delta = (long)newLen - (long)oldLen;
+    size_t oldEditEnd = pos + oldLen;
+    size_t len = buffer.Length();
+
+    // the line before can change too: its last word may now fit, or not
+    int first = 0;
+    if (!lines.empty()) {
+      first = SDL_max(FindLine(pos) - 1, 0);
+    }
+
+    newLines.clear();
+
+    // old lines from here on are candidates to line up with
+    int old = first + 1;
+    size_t start = first < (int)lines.size() ? lines[first].start : 0;
+    int converged = -1;
+
+    while (true) {
+      // an old line that starts at the same place (shifted) after the edit
+      // wraps the same from there on
+      while (old < (int)lines.size() && lines[old].start < oldEditEnd) {
+        old++;
+      }
+
+      while (old < (int)lines.size() &&
+             (long)lines[old].start + delta < (long)start) {
+        old++;
+      }
+
+      if (!newLines.empty() && old < (int)lines.size() &&
+          (long)lines[old].start + delta == (long)start) {
+        converged = old;
+        break;
+      }
+
+      size_t length = WrapLine(start);
+
+      Line line;
+      line.start = start;
+      line.length = length;
+      line.serial = 0;
+
+      // untouched lines before the edit keep their texture
+      int same = first + newLines.size();
+      if (same < (int)lines.size() && lines[same].start == start &&
+          lines[same].length == length && start + length <= pos) {
+        line.serial = lines[same].serial;
+      }
+
+      if (line.serial == 0) {
+        line.serial = nextSerial++;
+      }
+
+      newLines.push_back(line);
+      start += length;
+
+      // text that ends in a newline still has an empty last line
+      if (start >= len && (length == 0 || buffer.At(start - 1) != '\n')) {
+        break;
+      }
+    }
+
+    int end = converged >= 0 ? converged : lines.size();
+
+    // shifting later lines is one pass over an array of ints, which stays
+    // far below a frame even for hundreds of KB of text
+    if (converged >= 0) {
+      for (size_t i = converged; i < lines.size(); ++i) {
+        lines[i].start += delta;
+      }
+    }
+
+    lines.erase(lines.begin() + first, lines.begin() + end);
+    lines.insert(lines.begin() + first, newLines.begin(), newLines.end());
+  }
+
+  void Remove(size_t pos, size_t n) {
+    buffer.Erase(pos, n);
+    Reflow(pos, n, 0);
+
+    cursor = anchor = pos;
+    preferredX = -1;
+  }
+
+  bool DeleteSelection() {
+    if (!HasSelection()) {
+      return false;
+    }
+
+    size_t start = SelectionStart();
+    Remove(start, SelectionEnd() - start);
+
+    return true;
+  }
+
+  size_t SelectionStart() { return SDL_min(anchor, cursor); }
+
+  size_t SelectionEnd() { return SDL_max(anchor, cursor); }
+
+  void SetCursor(size_t pos, bool select) {
+    cursor = pos;
+    if (!select) {
+      anchor = cursor;
+    }
+
+    preferredX = -1;
+  }
+
+  // line containing pos; the end of the text is on the last line
+  int FindLine(size_t pos) {
+    int lo = 0;
+    int hi = (int)lines.size() - 1;
+
+    while (lo < hi) {
+      int mid = (lo + hi + 1) / 2;
+      if (lines[mid].start <= pos) {
+        lo = mid;
+      }
+
+      else {
+        hi = mid - 1;
+      }
+    }
+
+    return lo;
+  }
+
+  // line length without its newline
+  size_t VisibleLength(int l) {
+    size_t length = lines[l].length;
+    if (length > 0 && buffer.At(lines[l].start + length - 1) == '\n') {
+      length--;
+    }
+
+    return length;
+  }
+
+  int XAt(int l, size_t pos) {
+    size_t end = SDL_min(pos, lines[l].start + VisibleLength(l));
+    int x = 0;
+
+    for (size_t p = lines[l].start; p < end;) {
+      x += Advance(p, &p);
+    }
+
+    return x;
+  }
+
+  // nearest character boundary to x on line l
+  size_t PosAt(int l, int x) {
+    size_t end = lines[l].start + VisibleLength(l);
+    size_t p = lines[l].start;
+    int w = 0;
+
+    while (p < end) {
+      size_t next;
+      int advance = Advance(p, &next);
+
+      if (w + advance / 2 >= x) {
+        break;
+      }
+
+      w += advance;
+      p = next;
+    }
+
+    return p;
+  }
+
+  void MoveLines(int dir, bool select) {
+    int l = FindLine(cursor);
+    int target = l + dir;
+
+    int x = preferredX >= 0 ? preferredX : XAt(l, cursor);
+
+    if (target < 0) {
+      SetCursor(0, select);
+    }
+
+    else if (target >= (int)lines.size()) {
+      SetCursor(buffer.Length(), select);
+    }
+
+    else {
+      SetCursor(PosAt(target, x), select);
+    }
+
+    // going through a short line shouldn't lose the column
+    preferredX = x;
+  }
+
+  std::string GetRange(size_t pos, size_t n) {
+    std::string s(n, '\0');
+    buffer.Copy(pos, n, &s[0]);
+    return s;
+  }
+
+  // gives each visible line a row texture, reusing ones already drawn
+  void AssignRows(int visible) {
+    for (int i = 0; i < maxVisibleLines; ++i) {
+      rowOf[i] = -1;
+      rowTaken[i] = false;
+    }
+
+    for (int i = 0; i < visible; ++i) {
+      Uint32 serial = lines[scroll + i].serial;
+
+      for (int r = 0; r < maxVisibleLines; ++r) {
+        if (!rowTaken[r] && rows[r].serial == serial) {
+          rowOf[i] = r;
+          rowTaken[r] = true;
+          break;
+        }
+      }
+    }
+
+    for (int i = 0; i < visible; ++i) {
+      if (rowOf[i] >= 0) {
+        continue;
+      }
+
+      for (int r = 0; r < maxVisibleLines; ++r) {
+        if (!rowTaken[r]) {
+          rowOf[i] = r;
+          rowTaken[r] = true;
+          Rasterize(scroll + i, rows[r]);
+          break;
+        }
+      }
+    }
+  }
+
+  void Rasterize(int l, Row &row) {
+    if (row.texture != NULL) {
+      SDL_DestroyTexture(row.texture);
+      row.texture = NULL;
+    }
+
+    row.serial = lines[l].serial;
+    row.w = 0;
+    rasterized++;
+
+    size_t n = VisibleLength(l);
+    if (n == 0) {
+      return;
+    }
+
+    scratch.resize(n + 1);
+    buffer.Copy(lines[l].start, n, scratch.data());
+    scratch[n] = '\0';
+
+    SDL_Surface *surf = TTF_RenderUTF8_Solid(font, scratch.data(), color);
+    if (surf == NULL) {
+      printf("Unable to render text: %s\n", TTF_GetError());
+      return;
+    }
+
+    row.texture = SDL_CreateTextureFromSurface(renderer, surf);
+    row.w = surf->w;
+    SDL_FreeSurface(surf);
+  }
+
+  static const int MAX_ROWS = 16;
+
+  SDL_Renderer *renderer;
+  TTF_Font *font;
+  SDL_Color color;
+  int wrapWidth;
+  int maxVisibleLines;
+  int lineHeight;
+  int asciiAdvance[128];
+
+  LGapBuffer buffer;
+  std::vector<Line> lines;
+  std::vector<Line> newLines;
+  Uint32 nextSerial;
+
+  size_t cursor;
+  size_t anchor;
+  int preferredX;
+  int scroll;
+
+  std::vector<Row> rows;
+  int rowOf[MAX_ROWS];
+  bool rowTaken[MAX_ROWS];
+  std::vector<char> scratch;
+
+  long rasterized;
+};
@@ -0,0 +1,260 @@
+#pragma once
+
+#include "LEngine.h"
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#include <SDL2/SDL_ttf.h>
+#include <stdio.h>
+
+class LTexture {
+public:
+  LTexture() {
+    texture = NULL;
+    id = 0;
+    softImage = -1;
+    width = 0;
+    height = 0;
+    scale = 1;
+    renderDest = {0, 0, 0, 0};
+  }
+
+  ~LTexture() { Free(); }
+
+// anything inside #if will be ignored by compiler if SDL_TTF ... macro is not
+// defined
+#if defined(SDL_TTF_MAJOR_VERSION)
+
+  bool LoadFromRenderedText(const char *text, SDL_Color tColor) {
+    // free old texture
+    Free();
+
+    // render text
+    SDL_Surface *tSurf = TTF_RenderText_Solid(gFont, text, tColor);
+    if (tSurf == NULL) {
+      printf("Unable to render text: %s\n", SDL_GetError());
+      return false;
+    }
+
+    // create texture
+    texture = SDL_CreateTextureFromSurface(renderer, tSurf);
+    if (tSurf == NULL) {
+      printf("Unable to make texture from text: %s\n", SDL_GetError());
+      return false;
+    }
+
+    width = tSurf->w;
+    height = tSurf->h;
+
+    id = renderRecorder.NewTextureId();
+    renderRecorder.DefineTexture(id, tSurf, texture);
+
+    if (softBlitter.IsEnabled()) {
+      softImage = softBlitter.AddImage(tSurf);
+    }
+
+    SDL_FreeSurface(tSurf);
+
+    memoryStats.Set(this, MEM_TEXT, text, LMemoryStats::TextureBytes(texture));
+
+    return true;
+  }
+
+#endif
+
+  bool LoadFromFile(const char *path) {
+    // remove pre-existing texture
+    Free();
+
+    // load new one
+    SDL_Surface *lSurf = IMG_Load(path);
+
+    if (lSurf == NULL) {
+      printf("Unable to load image: %s\n", SDL_GetError());
+      return false;
+    }
+
+    // set color key to black
+    SDL_SetColorKey(lSurf, SDL_TRUE, SDL_MapRGB(lSurf->format, 0, 0, 0));
+
+    // make texture w/color key
+    SDL_Texture *nTexture = SDL_CreateTextureFromSurface(renderer, lSurf);
+
+    if (nTexture == NULL) {
+      printf("Could not create texture: %s\n", SDL_GetError());
+      return false;
+    }
+
+    width = lSurf->w;
+    height = lSurf->h;
+
+    id = renderRecorder.NewTextureId();
+    renderRecorder.DefineTexture(id, lSurf, nTexture);
+
+    // the blitter keeps its own copy, color key applied
+    if (softBlitter.IsEnabled()) {
+      softImage = softBlitter.AddImage(lSurf);
+    }
+
+    // get rid of interim surface
+    SDL_FreeSurface(lSurf);
+
+    // set new texture
+    texture = nTexture;
+
+    memoryStats.Set(this, MEM_TEXTURE, path,
+                    LMemoryStats::TextureBytes(texture));
+
+    return true;
+  }
+
+  void Free() {
+    if (texture != NULL) {
+      SDL_DestroyTexture(texture);
+      texture = NULL;
+      width = 0;
+      height = 0;
+
+      memoryStats.Remove(this);
+      renderRecorder.FreeTexture(id);
+
+      softBlitter.RemoveImage(softImage);
+      softImage = -1;
+    }
+  }
+
+  void SetBlendMode(SDL_BlendMode blendMode) {
+    // set blend mode
+    SDL_SetTextureBlendMode(texture, blendMode);
+    renderRecorder.BlendMode(id, blendMode);
+    softBlitter.SetBlendMode(softImage, blendMode);
+  }
+
+  // modulation ~ multiplication!
+
+  void ModColor(Uint8 r, Uint8 g, Uint8 b) {
+    SDL_SetTextureColorMod(texture, r, g, b);
+    renderRecorder.ColorMod(id, r, g, b);
+    softBlitter.SetColorMod(softImage, r, g, b);
+  }
+
+  void ModAlpha(Uint8 a) {
+    SDL_SetTextureAlphaMod(texture, a);
+    renderRecorder.AlphaMod(id, a);
+    softBlitter.SetAlphaMod(softImage, a);
+  }
+
+  void Render(int x, int y, SDL_Rect *clip = NULL) {
+    // set render space on screen
+    // sprite will be stretched to match
+    renderDest = {x, y, width, height};
+
+    // give dest rect the dimensions of the src rect
+    if (clip != NULL) {
+      renderDest.w = clip->w;
+      renderDest.h = clip->h;
+    }
+
+    renderDest.w *= scale;
+    renderDest.h *= scale;
+
+    // render to screen
+    // pass in clip as src rect
+    Copy(clip);
+    renderRecorder.Copy(renderer, id, clip, &renderDest);
+  }
+
+  void RenderRotated(int x, int y, SDL_Rect *clip, double angle,
+                     SDL_Point *center, SDL_RendererFlip flip) {
+    renderDest = {x, y, width, height};
+
+    // careful! this isn't given a value by default
+    if (clip != NULL) {
+      renderDest.w = clip->w;
+      renderDest.h = clip->h;
+    }
+
+    renderDest.w *= scale;
+    renderDest.h *= scale;
+
+    // pass sprite through rotation; the soft blitter can only flip
+    if (softImage >= 0 && softBlitter.IsDrawing() && angle == 0) {
+      softBlitter.Blit(softImage, clip, &renderDest, flip);
+    }
+
+    else {
+      SDL_RenderCopyEx(renderer, texture, clip, &renderDest, angle, center,
+                       flip);
+    }
+
+    renderRecorder.CopyEx(renderer, id, clip, &renderDest, angle, center,
+                          flip);
+  }
+
+  void RenderFill() {
+    // stretch to fill screen
+    renderDest = {0, 0, SCREEN_WIDTH, SCREEN_HEIGHT};
+
+    Copy(NULL);
+    renderRecorder.Copy(renderer, id, NULL, &renderDest);
+  }
+
+  void RenderIgnoreScale(int x, int y, int w, int h, SDL_Rect *clip = NULL) {
+    // renders ignoring set scale; useful for ui that needs specific dimensions
+    renderDest = {x, y, w, h};
+
+    // not sure what happens if clip wh don't match given wh; does it stretch?
+    // yup, it does stretch!
+    Copy(clip);
+    renderRecorder.Copy(renderer, id, clip, &renderDest);
+  }
+
+  // entire texture w + h are given if render dest dimensions match
+  // but if render dest dimensions are different (we do this when rendering
+  // frames, for ex.) we return the modified w, h instead
+  // also if we haven't rendered this yet (renderDest w/h are 0) just use
+  // regular w/h too
+
+  int GetWidth() {
+    if (renderDest.w == width || renderDest.w == 0) {
+      return width * scale;
+    }
+
+    return renderDest.w;
+  }
+
+  int GetHeight() {
+    if (renderDest.h == height || renderDest.h == 0) {
+      return height * scale;
+    }
+
+    return renderDest.h;
+  }
+
+  void SetScale(int nScale) { scale = nScale; }
+
+private:
+  // to renderDest, through the soft blitter while it's drawing a frame
+  void Copy(SDL_Rect *clip) {
+    if (softImage >= 0 && softBlitter.IsDrawing()) {
+      softBlitter.Blit(softImage, clip, &renderDest);
+    }
+
+    else {
+      SDL_RenderCopy(renderer, texture, clip, &renderDest);
+    }
+  }
+
+  SDL_Texture *texture;
+  SDL_Rect renderDest;
+
+  // new one per load, for render recordings
+  Uint32 id;
+
+  // handle into softBlitter, or -1 when it's off
+  int softImage;
+
+  int width;
+  int height;
+  int scale;
+};
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "LStateArena.h"
+#include "LTexture.h"
+
+#include <SDL2/SDL.h>
+
+inline LTexture tBrick;
+
+class Tile {
+public:
+  static const int TILE_WIDTH = 100;
+  static const int TILE_HEIGHT = 100;
+
+  Tile() {
+    collider.x = 0;
+    collider.y = 0;
+    collider.w = TILE_WIDTH;
+    collider.h = TILE_HEIGHT;
+
+    posX = 0;
+    posY = 0;
+
+    texture = &tBrick;
+  }
+
+  SDL_Rect *GetCollider() { return &collider; }
+
+  int GetPosX() { return posX; }
+
+  int GetPosY() { return posY; }
+
+  void SetPosition(int x, int y, int camX = 0, int camY = 0) {
+    posX = x;
+    posY = y;
+
+    collider.x = x - camX;
+    collider.y = y - camY;
+  }
+
+  void ApplyCameraOffset(int camX, int camY) {
+    // tiles are static by nature (pos stays same), but their colliders should
+    // have the cam. offset applied to them
+    collider.x = posX - camX;
+    collider.y = posY - camY;
+  }
+
+  void Render(int camX, int camY) {
+    texture->RenderIgnoreScale(posX - camX, posY - camY, collider.w,
+                               collider.h);
+  }
+
+  void Snapshot(LStateArena &a) {
+    a.Write(collider);
+    a.Write(posX);
+    a.Write(posY);
+  }
+
+  void Restore(LStateArena &a) {
+    a.Read(collider);
+    a.Read(posX);
+    a.Read(posY);
+  }
+
+private:
+  SDL_Rect collider;
+  LTexture *texture;
+
+  int posX, posY;
+};
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+
+class LTimer {
+public:
+  LTimer() {
+    startTicks = 0;
+    pausedTicks = 0;
+
+    paused = false;
+    started = false;
+  }
+
+  void Start() {
+    // start timer
+    started = true;
+    paused = false;
+
+    startTicks = SDL_GetTicks();
+    pausedTicks = 0;
+  }
+
+  void Stop() {
+    // completely stop timer w/o intent of resuming
+    started = false;
+    paused = false;
+
+    startTicks = 0;
+    pausedTicks = 0;
+  }
+
+  void Pause() {
+    // can only pause if already running and not paused
+    if (started && !paused) {
+      paused = true;
+
+      // get time kept before pause
+      pausedTicks = SDL_GetTicks() - startTicks;
+
+      // reset counted runtime
+      startTicks = 0;
+    }
+  }
+
+  void Unpause() {
+    if (started && paused) {
+      paused = false;
+
+      // get time kept during pause
+      startTicks = SDL_GetTicks() - pausedTicks;
+
+      // reset paused ticks
+      pausedTicks = 0;
+    }
+  }
+
+  // get timer curr. time
+  Uint32 GetTicks() {
+    // actual kept time
+    Uint32 time = 0;
+
+    if (started) {
+      // if paused, return time kept before pause
+      if (paused) {
+        time = pausedTicks;
+      }
+
+      // if not, return time kept since last start/unpause
+      else {
+        time = SDL_GetTicks() - startTicks;
+      }
+    }
+
+    return time;
+  }
+
+  // check status of timer
+  bool IsStarted() { return started; }
+
+  bool IsPaused() {
+    // paused is different from stopped completely
+    return paused && paused;
+  }
+
+private:
+  Uint32 startTicks;  // time when timer started
+  Uint32 pausedTicks; // ticks when timer paused
+
+  bool paused;
+  bool started;
+};
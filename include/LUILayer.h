@@ -0,0 +1,474 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <algorithm>
+#include <stdio.h>
+#include <vector>
+
+// retained ui: a tree of widgets that's hit-tested through a grid and
+// composed into a cached texture
+// nodes are added parents first, and a node's rect is relative to its
+// parent; groups are nodes with no widget, just an offset
+// mouse events only reach the widget under the pointer (and the one it just
+// left), found by looking up the grid cell the event's own x/y fall in
+// widgets that change state mark their rect dirty, and only dirty rects of
+// the cache are cleared and redrawn, so a frame with nothing changing costs
+// one texture copy however many widgets there are
+//
+// Widget needs:
+//   SDL_Rect GetRect();            // relative to the parent node
+//   bool OnPointer(Uint32 type, bool inside);  // true if its look changed
+//   void Render(int x, int y);     // draws at absolute x, y
+template <typename Widget> class LUILayer {
+public:
+  LUILayer() {
+    renderer = NULL;
+    cache = NULL;
+    width = 0;
+    height = 0;
+    gridW = 0;
+    gridH = 0;
+    hovered = -1;
+    pressed = -1;
+    stampCounter = 0;
+    fullRedraw = true;
+
+    redraws = 0;
+  }
+
+  ~LUILayer() { Free(); }
+
+  // w, h is the area the layer covers; without render target support
+  // everything is just drawn every frame
+  bool Init(SDL_Renderer *renderer, int w, int h) {
+    Free();
+
+    this->renderer = renderer;
+    width = w;
+    height = h;
+
+    gridW = (w + CELL_SIZE - 1) / CELL_SIZE;
+    gridH = (h + CELL_SIZE - 1) / CELL_SIZE;
+    cells.assign(gridW * gridH, std::vector<int>());
+
+    dirty.reserve(MAX_DIRTY);
+    found.reserve(64);
+
+    if (SDL_RenderTargetSupported(renderer)) {
+      cache = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888,
+                                SDL_TEXTUREACCESS_TARGET, w, h);
+    }
+
+    if (cache == NULL) {
+      printf("UI cache unavailable, drawing directly: %s\n", SDL_GetError());
+      return false;
+    }
+
+    SDL_SetTextureBlendMode(cache, SDL_BLENDMODE_BLEND);
+    fullRedraw = true;
+
+    return true;
+  }
+
+  void Free() {
+    if (cache != NULL) {
+      SDL_DestroyTexture(cache);
+      cache = NULL;
+    }
+  }
+
+  void Reserve(int nNodes) {
+    nodes.reserve(nNodes);
+    stamps.reserve(nNodes);
+  }
+
+  // widget == NULL makes a group at x, y in its parent
+  int Add(Widget *widget, int parent = -1, int x = 0, int y = 0) {
+    Node n;
+    n.widget = widget;
+    n.parent = parent;
+    n.groupX = x;
+    n.groupY = y;
+    n.visible = true;
+    n.rect = {0, 0, 0, 0};
+
+    nodes.push_back(n);
+    stamps.push_back(0);
+
+    int id = nodes.size() - 1;
+    Place(id);
+    Insert(id);
+    MarkDirty(nodes[id].rect);
+
+    return id;
+  }
+
+  // call after moving a widget (or to move a group); children follow
+  void Relayout(int id, int groupX = 0, int groupY = 0) {
+    if (nodes[id].widget == NULL) {
+      nodes[id].groupX = groupX;
+      nodes[id].groupY = groupY;
+    }
+
+    // children always come after their parents, so one forward pass finds
+    // every descendant
+    for (int i = id; i < (int)nodes.size(); ++i) {
+      if (i != id && !IsDescendant(i, id)) {
+        continue;
+      }
+
+      MarkDirty(nodes[i].rect);
+      Remove(i);
+      Place(i);
+      Insert(i);
+      MarkDirty(nodes[i].rect);
+    }
+  }
+
+  void SetVisible(int id, bool visible) {
+    if (nodes[id].visible == visible) {
+      return;
+    }
+
+    nodes[id].visible = visible;
+
+    for (int i = id; i < (int)nodes.size(); ++i) {
+      if (i == id || IsDescendant(i, id)) {
+        MarkDirty(nodes[i].rect);
+      }
+    }
+  }
+
+  bool IsVisible(int id) {
+    // hidden if any ancestor is
+    for (int i = id; i >= 0; i = nodes[i].parent) {
+      if (!nodes[i].visible) {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  // returns true if a widget took the event
+  bool HandleEvent(SDL_Event *e) {
+    int x, y;
+    if (e->type == SDL_MOUSEMOTION) {
+      x = e->motion.x;
+      y = e->motion.y;
+    }
+
+    else if (e->type == SDL_MOUSEBUTTONDOWN || e->type == SDL_MOUSEBUTTONUP) {
+      x = e->button.x;
+      y = e->button.y;
+    }
+
+    else {
+      return false;
+    }
+
+    int hit = HitTest(x, y);
+
+    // the widget we left sees the pointer go outside
+    if (hovered >= 0 && hovered != hit) {
+      Notify(hovered, e->type, false);
+    }
+
+    // so does a pressed widget when the button comes up somewhere else
+    if (pressed >= 0 && pressed != hit && pressed != hovered &&
+        e->type == SDL_MOUSEBUTTONUP) {
+      Notify(pressed, e->type, false);
+    }
+
+    if (hit >= 0) {
+      Notify(hit, e->type, true);
+    }
+
+    hovered = hit;
+
+    if (e->type == SDL_MOUSEBUTTONDOWN) {
+      pressed = hit;
+    }
+
+    else if (e->type == SDL_MOUSEBUTTONUP) {
+      pressed = -1;
+    }
+
+    return hit >= 0;
+  }
+
+  // topmost visible widget at x, y; -1 if none
+  int HitTest(int x, int y) {
+    if (x < 0 || y < 0 || x >= width || y >= height) {
+      return -1;
+    }
+
+    std::vector<int> &cell = cells[(y / CELL_SIZE) * gridW + x / CELL_SIZE];
+
+    int best = -1;
+    SDL_Point p = {x, y};
+
+    for (size_t i = 0; i < cell.size(); ++i) {
+      int id = cell[i];
+      if (id > best && SDL_PointInRect(&p, &nodes[id].rect) &&
+          IsVisible(id)) {
+        best = id;
+      }
+    }
+
+    return best;
+  }
+
+  // brings the cache up to date and draws it
+  void Render() {
+    if (cache == NULL) {
+      for (int i = 0; i < (int)nodes.size(); ++i) {
+        Draw(i);
+      }
+
+      return;
+    }
+
+    if (fullRedraw || !dirty.empty()) {
+      SDL_Texture *prevTarget = SDL_GetRenderTarget(renderer);
+      SDL_SetRenderTarget(renderer, cache);
+
+      Uint8 r, g, b, a;
+      SDL_BlendMode blend;
+      SDL_GetRenderDrawColor(renderer, &r, &g, &b, &a);
+      SDL_GetRenderDrawBlendMode(renderer, &blend);
+
+      // clearing has to overwrite alpha, not blend with it
+      SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+      SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+
+      if (fullRedraw) {
+        SDL_RenderClear(renderer);
+        SDL_RenderSetClipRect(renderer, NULL);
+
+        for (int i = 0; i < (int)nodes.size(); ++i) {
+          Draw(i);
+        }
+
+        redraws += nodes.size();
+      }
+
+      else {
+        for (size_t d = 0; d < dirty.size(); ++d) {
+          SDL_RenderSetClipRect(renderer, &dirty[d]);
+          SDL_RenderFillRect(renderer, &dirty[d]);
+
+          // everything overlapping the rect, back to front
+          Query(dirty[d]);
+          for (size_t i = 0; i < found.size(); ++i) {
+            Draw(found[i]);
+          }
+
+          redraws += found.size();
+        }
+
+        SDL_RenderSetClipRect(renderer, NULL);
+      }
+
+      SDL_SetRenderDrawColor(renderer, r, g, b, a);
+      SDL_SetRenderDrawBlendMode(renderer, blend);
+      SDL_SetRenderTarget(renderer, prevTarget);
+
+      dirty.clear();
+      fullRedraw = false;
+    }
+
+    SDL_Rect dest = {0, 0, width, height};
+    SDL_RenderCopy(renderer, cache, NULL, &dest);
+  }
+
+  // render targets can be lost (device reset); redraw it all next time
+  void Invalidate() {
+    fullRedraw = true;
+    dirty.clear();
+  }
+
+  SDL_Texture *GetCache() { return cache; }
+
+  int GetCount() { return nodes.size(); }
+
+  // widget draws since startup; stays flat while nothing changes
+  long GetRedraws() { return redraws; }
+
+private:
+  static const int CELL_SIZE = 64;
+  static const size_t MAX_DIRTY = 32;
+
+  struct Node {
+    Widget *widget;
+    int parent;
+    int groupX, groupY;
+    bool visible;
+
+    // absolute
+    SDL_Rect rect;
+  };
+
+  bool IsDescendant(int id, int ancestor) {
+    for (int p = nodes[id].parent; p >= 0; p = nodes[p].parent) {
+      if (p == ancestor) {
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  void Place(int id) {
+    Node &n = nodes[id];
+
+    int originX = 0, originY = 0;
+    if (n.parent >= 0) {
+      originX = nodes[n.parent].rect.x;
+      originY = nodes[n.parent].rect.y;
+    }
+
+    if (n.widget == NULL) {
+      n.rect = {originX + n.groupX, originY + n.groupY, 0, 0};
+      return;
+    }
+
+    n.rect = n.widget->GetRect();
+    n.rect.x += originX;
+    n.rect.y += originY;
+  }
+
+  void Notify(int id, Uint32 type, bool inside) {
+    if (nodes[id].widget->OnPointer(type, inside)) {
+      MarkDirty(nodes[id].rect);
+    }
+  }
+
+  void MarkDirty(const SDL_Rect &rect) {
+    if (rect.w <= 0 || rect.h <= 0 || fullRedraw) {
+      return;
+    }
+
+    // past this many it's cheaper to just redraw everything
+    if (dirty.size() == MAX_DIRTY) {
+      fullRedraw = true;
+      dirty.clear();
+      return;
+    }
+
+    dirty.push_back(rect);
+  }
+
+  void Draw(int id) {
+    if (nodes[id].widget != NULL && IsVisible(id)) {
+      nodes[id].widget->Render(nodes[id].rect.x, nodes[id].rect.y);
+    }
+  }
+
+  // cell range a rect covers, clamped to the grid; false if it's off grid
+  bool CellRange(const SDL_Rect &r, int *x0, int *y0, int *x1, int *y1) {
+    if (r.w <= 0 || r.h <= 0) {
+      return false;
+    }
+
+    *x0 = SDL_max(r.x / CELL_SIZE, 0);
+    *y0 = SDL_max(r.y / CELL_SIZE, 0);
+    *x1 = SDL_min((r.x + r.w - 1) / CELL_SIZE, gridW - 1);
+    *y1 = SDL_min((r.y + r.h - 1) / CELL_SIZE, gridH - 1);
+
+    return *x0 <= *x1 && *y0 <= *y1;
+  }
+
+  void Insert(int id) {
+    if (nodes[id].widget == NULL) {
+      return;
+    }
+
+    int x0, y0, x1, y1;
+    if (!CellRange(nodes[id].rect, &x0, &y0, &x1, &y1)) {
+      return;
+    }
+
+    for (int y = y0; y <= y1; ++y) {
+      for (int x = x0; x <= x1; ++x) {
+        cells[y * gridW + x].push_back(id);
+      }
+    }
+  }
+
+  void Remove(int id) {
+    int x0, y0, x1, y1;
+    if (!CellRange(nodes[id].rect, &x0, &y0, &x1, &y1)) {
+      return;
+    }
+
+    for (int y = y0; y <= y1; ++y) {
+      for (int x = x0; x <= x1; ++x) {
+        std::vector<int> &cell = cells[y * gridW + x];
+
+        for (size_t i = 0; i < cell.size(); ++i) {
+          if (cell[i] == id) {
+            cell[i] = cell.back();
+            cell.pop_back();
+            break;
+          }
+        }
+      }
+    }
+  }
+
+  // widgets overlapping r into found, in draw order
+  void Query(const SDL_Rect &r) {
+    found.clear();
+
+    int x0, y0, x1, y1;
+    if (!CellRange(r, &x0, &y0, &x1, &y1)) {
+      return;
+    }
+
+    // a widget spanning several cells is only collected once
+    stampCounter++;
+
+    for (int y = y0; y <= y1; ++y) {
+      for (int x = x0; x <= x1; ++x) {
+        std::vector<int> &cell = cells[y * gridW + x];
+
+        for (size_t i = 0; i < cell.size(); ++i) {
+          int id = cell[i];
+          if (stamps[id] != stampCounter &&
+              SDL_HasIntersection(&r, &nodes[id].rect)) {
+            stamps[id] = stampCounter;
+            found.push_back(id);
+          }
+        }
+      }
+    }
+
+    // cells are unordered after removals; ids are draw order
+    std::sort(found.begin(), found.end());
+  }
+
+  SDL_Renderer *renderer;
+  SDL_Texture *cache;
+  int width;
+  int height;
+
+  std::vector<Node> nodes;
+
+  // each cell lists the widgets overlapping it
+  std::vector<std::vector<int>> cells;
+  int gridW;
+  int gridH;
+
+  std::vector<int> stamps;
+  int stampCounter;
+  std::vector<int> found;
+
+  std::vector<SDL_Rect> dirty;
+  bool fullRedraw;
+
+  int hovered;
+  int pressed;
+
+  long redraws;
+};
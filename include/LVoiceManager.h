@@ -0,0 +1,341 @@
+#pragma once
+
+#include "LAudioMixer.h"
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_mixer.h>
+#include <stdio.h>
+#include <vector>
+
+typedef enum SoundPriority {
+  SOUND_PRIORITY_LOW,
+  SOUND_PRIORITY_NORMAL,
+  SOUND_PRIORITY_HIGH
+} SoundPriority;
+
+// sits between the game and Mix_PlayChannel with a fixed channel budget
+// every request goes through, in order:
+//   distance cull:  too far from the listener to hear
+//   rate limit:     same sound started too recently, or too many copies of it
+//                   already playing; high priority sounds skip the interval,
+//                   and at the copy limit take over the oldest copy instead
+//   voice stealing: no free channel; take the least important one if it
+//                   matters less than the new sound, otherwise drop the new one
+// channel state is tracked here (start/end times from the chunk length), so
+// none of this has to ask the mixer what's playing
+// accepted sounds go to SDL_mixer channels, or to an LAudioMixer's voices if
+// one is set
+class LVoiceManager {
+public:
+  LVoiceManager() {
+    mixer = NULL;
+    bytesPerMs = 0;
+    maxDistance = 1200;
+    listenerX = 0;
+    listenerY = 0;
+
+    ResetStats();
+  }
+
+  // allocates the channels; call after Mix_OpenAudio
+  bool Init(int nVoices) {
+    int freq, channels;
+    Uint16 format;
+
+    if (Mix_QuerySpec(&freq, &format, &channels) == 0) {
+      printf("Could not query mixer: %s\n", Mix_GetError());
+      return false;
+    }
+
+    bytesPerMs = freq * channels * (SDL_AUDIO_BITSIZE(format) / 8) / 1000.0f;
+
+    Mix_AllocateChannels(nVoices);
+    voices.assign(nVoices, Voice());
+
+    return true;
+  }
+
+  // minIntervalMs: shortest gap between two starts of this sound
+  // maxInstances: copies of it allowed to play at once
+  void SetRateLimit(Mix_Chunk *chunk, Uint32 minIntervalMs, int maxInstances) {
+    SoundRule *rule = FindRule(chunk);
+    if (rule == NULL) {
+      rules.push_back(SoundRule());
+      rule = &rules.back();
+      rule->chunk = chunk;
+      rule->lastStart = 0;
+      rule->started = false;
+    }
+
+    rule->minIntervalMs = minIntervalMs;
+    rule->maxInstances = maxInstances;
+  }
+
+  // mixer must have been Init()ed with the same voice count
+  void SetMixer(LAudioMixer *mixer) { this->mixer = mixer; }
+
+  void SetListener(int x, int y) {
+    listenerX = x;
+    listenerY = y;
+  }
+
+  void SetMaxDistance(float d) { maxDistance = d; }
+
+  float GetMaxDistance() { return maxDistance; }
+
+  // returns the channel it plays on, or -1 if it was culled/limited/rejected
+  int Play(Mix_Chunk *chunk, SoundPriority priority, int x, int y,
+           Uint32 now) {
+    requested++;
+
+    if (chunk == NULL || voices.empty()) {
+      rejected++;
+      return -1;
+    }
+
+    // distance cull + attenuation
+    float dx = (float)(x - listenerX);
+    float dy = (float)(y - listenerY);
+    float d2 = dx * dx + dy * dy;
+
+    if (d2 >= maxDistance * maxDistance) {
+      culled++;
+      return -1;
+    }
+
+    float gain = 1.0f - SDL_sqrtf(d2) / maxDistance;
+
+    // rate limit identical sounds; a crowd's copies can't shut out the one
+    // that matters, so high priority gets through
+    int ch = -1;
+    bool steal = false;
+
+    SoundRule *rule = FindRule(chunk);
+    if (rule != NULL) {
+      bool tooSoon =
+          rule->started && now - rule->lastStart < rule->minIntervalMs;
+      bool tooMany = CountPlaying(chunk, now) >= rule->maxInstances;
+
+      if ((tooSoon || tooMany) && priority < SOUND_PRIORITY_HIGH) {
+        rateLimited++;
+        return -1;
+      }
+
+      // over the copy limit; restart the oldest copy
+      if (tooMany) {
+        ch = FindOldest(chunk, now);
+        steal = ch >= 0;
+      }
+    }
+
+    // free voice, else steal
+    if (ch < 0) {
+      ch = FindFree(now);
+    }
+
+    if (ch < 0) {
+      ch = FindVictim(priority, gain);
+
+      if (ch < 0) {
+        rejected++;
+        return -1;
+      }
+
+      steal = true;
+    }
+
+    if (steal) {
+      // custom mixer restarts the voice on play, no halt needed
+      if (mixer == NULL) {
+        Mix_HaltChannel(ch);
+      }
+
+      stolen++;
+    }
+
+    int volume = (int)(gain * MIX_MAX_VOLUME);
+
+    if (mixer != NULL) {
+      if (!mixer->Play(ch, chunk, volume)) {
+        rejected++;
+        return -1;
+      }
+    }
+
+    else {
+      Mix_Volume(ch, volume);
+      if (Mix_PlayChannel(ch, chunk, 0) < 0) {
+        rejected++;
+        return -1;
+      }
+    }
+
+    Voice &v = voices[ch];
+    v.chunk = chunk;
+    v.priority = priority;
+    v.gain = gain;
+    v.start = now;
+    v.end = now + (Uint32)(chunk->alen / bytesPerMs) + 1;
+
+    if (rule != NULL) {
+      rule->lastStart = now;
+      rule->started = true;
+    }
+
+    played++;
+    return ch;
+  }
+
+  int CountActive(Uint32 now) {
+    int n = 0;
+    for (int i = 0; i < (int)voices.size(); ++i) {
+      if (voices[i].chunk != NULL && now < voices[i].end) {
+        n++;
+      }
+    }
+
+    return n;
+  }
+
+  void ResetStats() {
+    requested = 0;
+    played = 0;
+    culled = 0;
+    rateLimited = 0;
+    stolen = 0;
+    rejected = 0;
+  }
+
+  void PrintStats() {
+    printf("voices: %d requested, %d played, %d culled, %d rate limited, "
+           "%d stolen, %d rejected\n",
+           requested, played, culled, rateLimited, stolen, rejected);
+  }
+
+private:
+  struct Voice {
+    Voice() {
+      chunk = NULL;
+      priority = SOUND_PRIORITY_LOW;
+      gain = 0;
+      start = 0;
+      end = 0;
+    }
+
+    Mix_Chunk *chunk;
+    SoundPriority priority;
+    float gain;
+    Uint32 start;
+    Uint32 end;
+  };
+
+  struct SoundRule {
+    Mix_Chunk *chunk;
+    Uint32 minIntervalMs;
+    int maxInstances;
+    Uint32 lastStart;
+    bool started;
+  };
+
+  // only a handful of distinct sounds, linear is fine
+  SoundRule *FindRule(Mix_Chunk *chunk) {
+    for (int i = 0; i < (int)rules.size(); ++i) {
+      if (rules[i].chunk == chunk) {
+        return &rules[i];
+      }
+    }
+
+    return NULL;
+  }
+
+  int CountPlaying(Mix_Chunk *chunk, Uint32 now) {
+    int n = 0;
+    for (int i = 0; i < (int)voices.size(); ++i) {
+      if (voices[i].chunk == chunk && now < voices[i].end) {
+        n++;
+      }
+    }
+
+    return n;
+  }
+
+  int FindOldest(Mix_Chunk *chunk, Uint32 now) {
+    int oldest = -1;
+    for (int i = 0; i < (int)voices.size(); ++i) {
+      if (voices[i].chunk != chunk || now >= voices[i].end) {
+        continue;
+      }
+
+      if (oldest < 0 || voices[i].start < voices[oldest].start) {
+        oldest = i;
+      }
+    }
+
+    return oldest;
+  }
+
+  int FindFree(Uint32 now) {
+    for (int i = 0; i < (int)voices.size(); ++i) {
+      if (voices[i].chunk == NULL || now >= voices[i].end) {
+        return i;
+      }
+    }
+
+    return -1;
+  }
+
+  // least important voice: lowest priority, then quietest, then oldest
+  // only returned if the new sound outranks it
+  int FindVictim(SoundPriority priority, float gain) {
+    int victim = -1;
+
+    for (int i = 0; i < (int)voices.size(); ++i) {
+      Voice &v = voices[i];
+
+      if (victim < 0) {
+        victim = i;
+        continue;
+      }
+
+      Voice &w = voices[victim];
+      if (v.priority != w.priority) {
+        if (v.priority < w.priority) {
+          victim = i;
+        }
+      }
+
+      else if (v.gain != w.gain) {
+        if (v.gain < w.gain) {
+          victim = i;
+        }
+      }
+
+      else if (v.start < w.start) {
+        victim = i;
+      }
+    }
+
+    Voice &w = voices[victim];
+    if (priority > w.priority || (priority == w.priority && gain > w.gain)) {
+      return victim;
+    }
+
+    return -1;
+  }
+
+  std::vector<Voice> voices;
+  std::vector<SoundRule> rules;
+
+  LAudioMixer *mixer;
+  float bytesPerMs;
+  float maxDistance;
+  int listenerX;
+  int listenerY;
+
+  int requested;
+  int played;
+  int culled;
+  int rateLimited;
+  int stolen;
+  int rejected;
+};
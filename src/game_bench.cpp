@@ -0,0 +1,574 @@
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#include <algorithm>
+#include <chrono>
+#include <math.h>
+#include <memory>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+#include "LEngine.h"
+#include "LJournaledSave.h"
+#include "LLightMap.h"
+#include "LParticles.h"
+#include "LPlayer.h"
+#include "LSoftBlitter.h"
+#include "LSprite.h"
+#include "LTexture.h"
+#include "LTile.h"
+#include "LTimer.h"
+
+// microbenchmarks for the engine pieces on their own, no game loop around
+// them; every bench runs at sizes 10 to 1M and prints one json object per
+// line to stdout, so runs can be diffed or plotted
+//
+//   ./game_bench [--filter name] [--max-size N] [--min-ms N]
+//
+// runs headless on SDL's dummy video driver (software renderer) unless
+// SDL_VIDEODRIVER says otherwise; build with -DCMAKE_BUILD_TYPE=Release
+
+const int SIZES[] = {10, 100, 1000, 10000, 100000, 1000000};
+
+const char *filter = NULL;
+int maxSize = 1000000;
+float minMs = 200;
+
+// at least this many timed runs per size, however slow
+const int MIN_REPS = 3;
+const int MAX_REPS = 100000;
+
+// results that are only written, so the work isn't optimized out
+volatile int sink = 0;
+
+bool Selected(const char *name) {
+  return filter == NULL || strstr(name, filter) != NULL;
+}
+
+// times body() until minMs has passed (and at least MIN_REPS times), after
+// one untimed warmup; size is how many items one call of body() handles
+template <typename F> void Measure(const char *name, int size, F body) {
+  body();
+
+  std::vector<float> times;
+  float total = 0;
+
+  while ((int)times.size() < MIN_REPS ||
+         (total < minMs && (int)times.size() < MAX_REPS)) {
+    auto start = std::chrono::high_resolution_clock::now();
+    body();
+    float ms = std::chrono::duration<float, std::chrono::milliseconds::period>(
+                   std::chrono::high_resolution_clock::now() - start)
+                   .count();
+
+    times.push_back(ms);
+    total += ms;
+  }
+
+  std::sort(times.begin(), times.end());
+  float median = times[times.size() / 2];
+
+  printf("{\"bench\":\"%s\",\"size\":%d,\"reps\":%d,\"median_ms\":%.6f,"
+         "\"min_ms\":%.6f,\"ns_per_item\":%.6g}\n",
+         name, size, (int)times.size(), median, times[0],
+         median * 1e6f / size);
+  fflush(stdout);
+}
+
+// a grid of tiles, spaced so none touch each other or the strip along y = 0
+// where the player walks
+void MakeTiles(std::vector<Tile> &tiles, int n) {
+  tiles.resize(n);
+
+  int perRow = (int)sqrt((double)n) + 1;
+  for (int i = 0; i < n; ++i) {
+    tiles[i].SetPosition((i % perRow) * Tile::TILE_WIDTH * 2,
+                         (i / perRow + 1) * Tile::TILE_HEIGHT * 2);
+  }
+}
+
+void BenchCollision(int size) {
+  std::vector<SDL_Rect> a(size), b(size);
+  for (int i = 0; i < size; ++i) {
+    a[i] = {rand() % 1000, rand() % 1000, 1 + rand() % 100, 1 + rand() % 100};
+    b[i] = {rand() % 1000, rand() % 1000, 1 + rand() % 100, 1 + rand() % 100};
+  }
+
+  Measure("collision", size, [&] {
+    int hits = 0;
+    for (int i = 0; i < size; ++i) {
+      hits += CheckCollision(a[i], b[i]);
+    }
+
+    sink = hits;
+  });
+}
+
+// every candidate is checked and none hit, the worst case for the scan
+void BenchTileCollisions(int size) {
+  std::vector<Tile> tiles;
+  MakeTiles(tiles, size);
+
+  std::vector<Tile *> candidates(size);
+  for (int i = 0; i < size; ++i) {
+    candidates[i] = &tiles[i];
+  }
+
+  Player p;
+  std::vector<Tile> none;
+  p.SetPosition(0, 0);
+  p.Move(none, 0, 0);
+
+  Measure("tile_collisions", size, [&] {
+    sink = p.CheckTileCollisions(candidates.data(), size);
+  });
+}
+
+// one move through a level of size tiles; gathering candidates walks all
+// of them, the axis checks only the few nearby
+void BenchPlayerMove(int size) {
+  std::vector<Tile> tiles;
+  MakeTiles(tiles, size);
+
+  frameArena.Reserve(size * sizeof(Tile *) + 64);
+
+  int perRow = (int)sqrt((double)size) + 1;
+  levelBounds = {0, 0, perRow * Tile::TILE_WIDTH * 2,
+                 (size / perRow + 2) * Tile::TILE_HEIGHT * 2};
+
+  KEYS[RIGHT] = true;
+
+  Player p;
+  p.ResyncVelocity();
+
+  Measure("player_move", size, [&] {
+    frameArena.Reset();
+
+    // back to the start so it never runs into the edge
+    p.SetPosition(0, 0);
+    p.Move(tiles, 0, 0);
+  });
+
+  KEYS[RIGHT] = false;
+}
+
+void BenchSpriteUpdate(int size) {
+  std::vector<std::unique_ptr<LSprite>> sprites(size);
+  for (int i = 0; i < size; ++i) {
+    sprites[i].reset(new LSprite(&tSpriteSheet, charSpriteClips, 2));
+    sprites[i]->SetFPS(1 + i % 8);
+  }
+
+  Measure("sprite_update", size, [&] { animations.Update(1 / 120.0f); });
+}
+
+void BenchTimer(int size) {
+  LTimer timer;
+  timer.Start();
+
+  Measure("timer_ticks", size, [&] {
+    Uint32 t = 0;
+    for (int i = 0; i < size; ++i) {
+      t += timer.GetTicks();
+    }
+
+    sink = t;
+  });
+}
+
+// size is the number of Sint32 records in the save
+void BenchSave(int size) {
+  const char *path = "game_bench_save.bin";
+
+  std::vector<Sint32> data(size, 0);
+  for (int i = 0; i < size; ++i) {
+    data[i] = rand() % 4 == 0 ? rand() : 0;
+  }
+
+  // a new save has nothing on disk, so this writes the whole base
+  Measure("save_write_full", size, [&] {
+    LJournaledSave save;
+    save.SetPath(path);
+    save.Save((Uint8 *)data.data(), size * sizeof(Sint32));
+  });
+
+  // one record changed since the last save, so only it hits the journal
+  LJournaledSave save;
+  save.SetPath(path);
+  save.Save((Uint8 *)data.data(), size * sizeof(Sint32));
+
+  int r = 0;
+  Measure("save_write_delta", size, [&] {
+    data[r]++;
+    r = (r + 1) % size;
+    save.Save((Uint8 *)data.data(), size * sizeof(Sint32));
+  });
+
+  Measure("save_read", size, [&] {
+    LJournaledSave load;
+    sink = load.Load(path, (Uint8 *)data.data(), size * sizeof(Sint32));
+  });
+
+  remove(path);
+
+  char journal[64];
+  snprintf(journal, sizeof(journal), "%s.journal", path);
+  remove(journal);
+}
+
+// an image in the sprites' style: mostly black (color keyed out) with some
+// opaque pixels
+SDL_Surface *MakeBenchSurface(int w, int h) {
+  SDL_Surface *surf =
+      SDL_CreateRGBSurfaceWithFormat(0, w, h, 32, SDL_PIXELFORMAT_RGBA32);
+  if (surf == NULL) {
+    printf("Unable to make bench image: %s\n", SDL_GetError());
+    return NULL;
+  }
+
+  Uint32 *pixels = (Uint32 *)surf->pixels;
+  for (int y = 0; y < h; ++y) {
+    for (int x = 0; x < w; ++x) {
+      pixels[y * surf->pitch / 4 + x] =
+          (x + y) % 3 == 0 ? 0 : SDL_MapRGB(surf->format, x * 8, y * 8, 200);
+    }
+  }
+
+  return surf;
+}
+
+bool WriteBenchPng(const char *path, int w, int h) {
+  SDL_Surface *surf = MakeBenchSurface(w, h);
+  if (surf == NULL) {
+    return false;
+  }
+
+  bool ok = IMG_SavePNG(surf, path) == 0;
+  if (!ok) {
+    printf("Unable to save bench image: %s\n", SDL_GetError());
+  }
+
+  SDL_FreeSurface(surf);
+  return ok;
+}
+
+// size is the image's pixel count, as a square
+void BenchTextureLoad(int size) {
+  const char *path = "game_bench_load.png";
+  int side = (int)sqrt((double)size);
+
+  if (!WriteBenchPng(path, side, side)) {
+    return;
+  }
+
+  LTexture t;
+  Measure("texture_load", size, [&] { sink = t.LoadFromFile(path); });
+
+  remove(path);
+}
+
+// size sprite draws from a 16x32 two frame sheet, flushed so the software
+// renderer actually does them inside the timed part
+void BenchTextureRender(int size) {
+  SDL_Rect *clips = charSpriteClips;
+
+  Measure("texture_render", size, [&] {
+    SDL_RenderClear(renderer);
+
+    for (int i = 0; i < size; ++i) {
+      tSpriteSheet.Render((i * 37) % (SCREEN_WIDTH - 16),
+                          (i * 61) % (SCREEN_HEIGHT - 16), &clips[i & 1]);
+    }
+
+    SDL_RenderFlush(renderer);
+  });
+}
+
+// size draws of one 16x16 image at the given scale, through SDL's renderer
+// and through LSoftBlitter; both end with the frame on the renderer
+void CompareBlits(const char *name, SDL_Surface *surf, int scale,
+                  SDL_BlendMode mode, int size) {
+  SDL_Texture *texture = SDL_CreateTextureFromSurface(renderer, surf);
+  if (texture == NULL) {
+    printf("Could not create texture: %s\n", SDL_GetError());
+    return;
+  }
+
+  SDL_SetTextureBlendMode(texture, mode);
+
+  LSoftBlitter blitter;
+  if (!blitter.Init(renderer, SCREEN_WIDTH, SCREEN_HEIGHT)) {
+    SDL_DestroyTexture(texture);
+    return;
+  }
+
+  int image = blitter.AddImage(surf);
+  blitter.SetBlendMode(image, mode);
+
+  int side = 16 * scale;
+  char full[64];
+
+  snprintf(full, sizeof(full), "%s_sdl", name);
+  Measure(full, size, [&] {
+    SDL_RenderClear(renderer);
+
+    for (int i = 0; i < size; ++i) {
+      SDL_Rect dst = {(i * 37) % (SCREEN_WIDTH - side),
+                      (i * 61) % (SCREEN_HEIGHT - side), side, side};
+      SDL_RenderCopy(renderer, texture, NULL, &dst);
+    }
+
+    SDL_RenderFlush(renderer);
+  });
+
+  snprintf(full, sizeof(full), "%s_soft", name);
+  Measure(full, size, [&] {
+    blitter.Begin(0, 0, 0);
+
+    for (int i = 0; i < size; ++i) {
+      SDL_Rect dst = {(i * 37) % (SCREEN_WIDTH - side),
+                      (i * 61) % (SCREEN_HEIGHT - side), side, side};
+      blitter.Blit(image, NULL, &dst);
+    }
+
+    blitter.End(renderer);
+    SDL_RenderFlush(renderer);
+  });
+
+  blitter.Free();
+  SDL_DestroyTexture(texture);
+}
+
+// player-like sprites (color keyed, x8), a translucent one, and plain
+// unscaled copies
+void BenchBlit(int size) {
+  SDL_Surface *surf = MakeBenchSurface(16, 16);
+  if (surf == NULL) {
+    return;
+  }
+
+  SDL_SetColorKey(surf, SDL_TRUE, SDL_MapRGB(surf->format, 0, 0, 0));
+  CompareBlits("blit_colorkey_x8", surf, GLOB_SCALE, SDL_BLENDMODE_BLEND,
+               size);
+
+  SDL_SetColorKey(surf, SDL_FALSE, 0);
+  CompareBlits("blit_opaque_x1", surf, 1, SDL_BLENDMODE_NONE, size);
+
+  // alpha ramps across the image
+  Uint32 *pixels = (Uint32 *)surf->pixels;
+  for (int y = 0; y < 16; ++y) {
+    for (int x = 0; x < 16; ++x) {
+      pixels[y * surf->pitch / 4 + x] = SDL_MapRGBA(
+          surf->format, x * 16, y * 16, 200, (Uint8)((x + y) * 8 + 10));
+    }
+  }
+
+  CompareBlits("blit_alpha_x8", surf, GLOB_SCALE, SDL_BLENDMODE_BLEND, size);
+
+  SDL_FreeSurface(surf);
+}
+
+// a steady pool of size particles where about 1 in 64 dies each tick and is
+// emitted again, so compaction and emits are part of the cost
+void MeasureParticles(const char *name, int size, int threads) {
+  const float dt = 1 / 120.0f;
+
+  LParticleSystem p;
+  p.Init(size, 0, threads);
+  p.SetGravity(100);
+  p.SetDrag(1);
+
+  SDL_Color c = {255, 128, 0, 255};
+  for (int i = 0; i < size; ++i) {
+    p.Emit(i % SCREEN_WIDTH, i % SCREEN_HEIGHT, 10, -10,
+           dt * (i % 64 + 1.5f), c);
+  }
+
+  int emitted = 0;
+  Measure(name, size, [&] {
+    p.Update(dt);
+
+    while (p.GetCount() < size) {
+      p.Emit(emitted % SCREEN_WIDTH, emitted % SCREEN_HEIGHT, 10, -10,
+             dt * 64, c);
+      emitted++;
+    }
+  });
+}
+
+void BenchParticleUpdate(int size) {
+  MeasureParticles("particle_update", size, 0);
+
+  // every other hardware thread as a worker
+  int threads = (int)std::thread::hardware_concurrency() - 1;
+  if (threads > 0) {
+    MeasureParticles("particle_update_mt", size, threads);
+  }
+}
+
+// size particles spread over the screen, drawn in one geometry call and
+// flushed
+void BenchParticleRender(int size) {
+  LParticleSystem p;
+  p.Init(size, size);
+  p.SetSize(4);
+
+  for (int i = 0; i < size; ++i) {
+    SDL_Color c = {(Uint8)i, 128, 255, 200};
+    p.Emit((i * 37) % SCREEN_WIDTH, (i * 61) % SCREEN_HEIGHT, 0, 0, 1000, c);
+  }
+
+  Measure("particle_render", size, [&] {
+    SDL_RenderClear(renderer);
+    sink = p.Render(renderer, 0, 0, SCREEN_WIDTH, SCREEN_HEIGHT);
+    SDL_RenderFlush(renderer);
+  });
+}
+
+// a square level of size cells, one in eight a wall, with up to 64 torches;
+// lighting_move moves one torch a cell and updates (what a frame usually
+// costs), lighting_full relights everything
+void BenchLighting(int size) {
+  int side = (int)sqrt((double)size);
+
+  LLightMap map;
+  map.Init(side, side);
+  map.SetAmbient(40, 40, 60);
+
+  for (int i = 0; i < size / 8; ++i) {
+    map.SetOpaque(rand() % side, rand() % side, true);
+  }
+
+  int torch = map.AddLight(side / 2, side / 2, 6, 255, 210, 140);
+  for (int i = 1; i < 64 && i < size / 16; ++i) {
+    map.AddLight(rand() % side, rand() % side, 6, 255, 210, 140);
+  }
+
+  map.SetViewer(side / 2, side / 2, 9);
+  map.Update();
+
+  int step = 0;
+  Measure("lighting_move", size, [&] {
+    int x = side / 2 + (step++ & 1);
+    map.MoveLight(torch, x, side / 2);
+    map.SetViewer(x, side / 2, 9);
+    sink = map.Update();
+  });
+
+  Measure("lighting_full", size, [&] {
+    map.MarkAllDirty();
+    sink = map.Update();
+  });
+}
+
+void ParseArgs(int argc, char *argv[]) {
+  for (int i = 1; i < argc; ++i) {
+    bool hasValue = i + 1 < argc;
+
+    if (strcmp(argv[i], "--filter") == 0 && hasValue) {
+      filter = argv[++i];
+    }
+
+    else if (strcmp(argv[i], "--max-size") == 0 && hasValue) {
+      maxSize = atoi(argv[++i]);
+    }
+
+    else if (strcmp(argv[i], "--min-ms") == 0 && hasValue) {
+      minMs = atof(argv[++i]);
+    }
+
+    else {
+      printf("Unknown argument: %s\n", argv[i]);
+    }
+  }
+}
+
+bool Init() {
+  // headless unless asked otherwise
+  SDL_setenv("SDL_VIDEODRIVER", "dummy", 0);
+
+  if (SDL_Init(SDL_INIT_VIDEO) < 0) {
+    printf("SDL init failed: %s\n", SDL_GetError());
+    return false;
+  }
+
+  if (!(IMG_Init(IMG_INIT_PNG) & IMG_INIT_PNG)) {
+    printf("SDL_image init failed: %s\n", SDL_GetError());
+    return false;
+  }
+
+  window = SDL_CreateWindow("Bench", SDL_WINDOWPOS_UNDEFINED,
+                            SDL_WINDOWPOS_UNDEFINED, SCREEN_WIDTH,
+                            SCREEN_HEIGHT, SDL_WINDOW_HIDDEN);
+  if (window == NULL) {
+    printf("Window creation failed: %s\n", SDL_GetError());
+    return false;
+  }
+
+  renderer = SDL_CreateRenderer(window, -1, 0);
+  if (renderer == NULL) {
+    printf("Could not create renderer: %s\n", SDL_GetError());
+    return false;
+  }
+
+  // the sprite benches draw from a generated sheet, so no assets are needed
+  const char *sheetPath = "game_bench_sheet.png";
+  bool ok = WriteBenchPng(sheetPath, 16, 32) &&
+            tSpriteSheet.LoadFromFile(sheetPath);
+  remove(sheetPath);
+
+  return ok;
+}
+
+int main(int argc, char *argv[]) {
+  ParseArgs(argc, argv);
+
+  if (!Init()) {
+    return 1;
+  }
+
+  struct Bench {
+    const char *name;
+    void (*run)(int size);
+
+    // largest size it runs at, whatever --max-size says
+    int maxSize;
+  };
+
+  // names match the first measurement each one prints, for --filter
+  // full-screen x8 blits are 16k pixels each, so those stop at 1000
+  Bench benches[] = {{"collision", BenchCollision, 1000000},
+                     {"tile_collisions", BenchTileCollisions, 1000000},
+                     {"player_move", BenchPlayerMove, 1000000},
+                     {"sprite_update", BenchSpriteUpdate, 1000000},
+                     {"timer_ticks", BenchTimer, 1000000},
+                     {"save", BenchSave, 1000000},
+                     {"texture_load", BenchTextureLoad, 1000000},
+                     {"texture_render", BenchTextureRender, 1000000},
+                     {"blit", BenchBlit, 1000},
+                     {"particle_update", BenchParticleUpdate, 1000000},
+                     {"particle_render", BenchParticleRender, 100000},
+                     {"lighting", BenchLighting, 1000000}};
+
+  for (const Bench &b : benches) {
+    if (!Selected(b.name)) {
+      continue;
+    }
+
+    for (int size : SIZES) {
+      if (size <= maxSize && size <= b.maxSize) {
+        b.run(size);
+      }
+    }
+  }
+
+  tSpriteSheet.Free();
+  SDL_DestroyRenderer(renderer);
+  SDL_DestroyWindow(window);
+  IMG_Quit();
+  SDL_Quit();
+
+  return 0;
+}
@@ -18,732 +18,723 @@
 #include <SDL_scancode.h>
 #include <SDL_stdinc.h>
 #include <chrono>
-#include <sstream>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <vector>
 
-const int SCREEN_WIDTH = 900;
-const int SCREEN_HEIGHT = 900;
+#include "LAutosave.h"
+#include "LHistogram.h"
+#include "LInputRecording.h"
+#include "LLevel.h"
+#include "LLightMap.h"
+#include "LMemoryStats.h"
+#include "LRenderRecording.h"
+#include "LResolutionScaler.h"
+#include "LSprite.h"
+#include "LJournaledSave.h"
+#include "LLatencyTracker.h"
+#include "LMusicStream.h"
+#include "LParticles.h"
+#include "LPerfCounters.h"
+#include "LPlayer.h"
+#define LALLOC_COUNTER_IMPLEMENTATION
+#include "LAllocCounter.h"
+#include "LAnimationSystem.h"
+#include "LAudioMixer.h"
+#include "LCrowd.h"
+#include "LEngine.h"
+#include "LFlowField.h"
+#include "LFrameCapture.h"
+#include "LFrameArena.h"
+#include "LGlyphCache.h"
+#include "LStateArena.h"
+#include "LTextField.h"
+#include "LTexture.h"
+#include "LTile.h"
+#include "LTimer.h"
+#include "LUILayer.h"
+#include "LVoiceManager.h"
 
-const int LEVEL_WIDTH = 3 * SCREEN_WIDTH;
-const int LEVEL_HEIGHT = 3 * SCREEN_HEIGHT;
-
-const int GLOB_SCALE = 8;
-const int GLOB_FONTSIZE = 32;
-
-const int KEY_COUNT = 4;
-
-SDL_Window *window = NULL;
 SDL_Surface *screenSurface = NULL;
-SDL_Renderer *renderer = NULL;
 SDL_Rect screenRect = {0, 0, SCREEN_WIDTH, SCREEN_HEIGHT};
 
-TTF_Font *gFont = NULL;
 SDL_Rect statusBarBG;
 
-typedef enum Inputs { UP, DOWN, LEFT, RIGHT, PAUSE, EXIT, TOTAL_INPUTS } Inputs;
-bool KEYS[TOTAL_INPUTS];
+// the status bar text has keyboard focus; enter or a click on the bar gives
+// it focus, esc or a click elsewhere takes it away
+// it's game state driven by events, not SDL's text input flag, so replays
+// see the same focus changes the recording did
+bool typing = false;
+
+// modifier keys held as of the last key event
+SDL_Keymod modState = KMOD_NONE;
 
 auto lastUpdateTime = std::chrono::high_resolution_clock::now();
 
 float targetFps = 120;
 float dt = 0;
 
+// music isn't touched until the first play; .wav streams from disk in small
+// blocks, anything else falls back to SDL_mixer loading the whole file
+const char *musicPath = "../assets/music.wav";
+LMusicStream musicStream;
 Mix_Music *music = NULL;
-Mix_Chunk *step = NULL;
+bool musicOpened = false;
 
-std::stringstream timeText;
+const int VOICE_BUDGET = 16;
+
+// optional sfx mixer in the audio callback with a small device buffer;
+// without it everything goes through SDL_mixer's channels and a 2048 frame
+// buffer (~46ms)
+bool lowLatencyAudio = false;
+const int LOW_LATENCY_FRAMES = 256;
+LAudioMixer sfxMixer;
+
+// sfxMixer initialized; false if it wasn't asked for or couldn't be
+bool sfxMixerReady = false;
 
 SDL_Rect cam = {0, 0, SCREEN_WIDTH, SCREEN_HEIGHT};
 
 SDL_Color textColor = {255, 255, 255, 255};
-std::string inputText = "Input Text";
+// status bar text; wraps and grows upward to a few lines
+LTextField inputField;
+const int INPUT_MAX_LINES = 4;
 
 // gamesave
 const int TOTAL_DATA = 10;
 Sint32 saveData[TOTAL_DATA];
 
+const char *savePath = "../assets/save.bin";
+
+// base save + journal of changes; only the autosave worker writes it while
+// the game is running
+LJournaledSave saveFile;
+
+// autosave runs on its own thread; main loop only hands it snapshots
+LAutosave autosave;
+Uint32 autosaveIntervalMs = 5000;
+
+// benchmark mode; runs uncapped for a fixed number of frames and prints
+// frame time stats on exit (set SDL_VIDEODRIVER=dummy to run headless)
+bool benchMode = false;
+int benchFrames = 0;
+
+// extra bytes appended to autosave snapshots in bench mode, to check that
+// big saves don't stall the frame
+std::vector<Uint8> saveBallast;
+
+// input capture/playback; events are tagged with the frame they're polled on
+LInputRecorder inputRecorder;
+LInputReplay inputReplay;
+const char *recordPath = NULL;
+const char *replayPath = NULL;
+
+LHistogram frameTimes;
+LHistogram autosaveFrameTimes;
+
+// arrow key -> moved player on screen
+LLatencyTracker inputLatency;
+
+// stats overlay (F1); drawn from pre-rendered glyphs, so it can change
+// every frame without making textures
+bool showStats = false;
+LGlyphCache overlayGlyphs;
+
+// heap allocations made by the main loop; steady state should be zero
+// --check-allocs fails the bench run if any frame after warmup allocates,
+// level streaming included (chunks, tiles and the frame arena are sized for
+// the view when the level loads)
+bool checkAllocs = false;
+const int ALLOC_WARMUP_FRAMES = 120;
+Uint64 lastFrameAllocs = 0;
+Uint64 steadyAllocs = 0;
+int steadyAllocFrames = 0;
+int firstAllocFrame = -1;
+
+// snapshots are microseconds, so finer buckets
+LHistogram snapshotTimes(0.0005f, 2000);
+
+// bench mode: extra sound requests per second from random spots within
+// earshot; loadSound shares step's samples but has no rate limit, so the
+// load reaches the voice budget and has to steal
+int voiceLoad = 0;
+Mix_Chunk *loadSound = NULL;
+float voiceLoadAccum = 0;
+long activeVoiceSum = 0;
+LHistogram voicePlayTimes(0.0005f, 2000);
+
+// dynamic resolution; the world renders to worldTarget at resScaler's scale
+// and is stretched over the window, ui is drawn on top at native res
+bool dynamicRes = false;
+float dynamicResBudgetMs = 0;
+LResolutionScaler resScaler;
+SDL_Texture *worldTarget = NULL;
+
+// screenshots (F12) and y4m recording (F11), encoded on a worker thread;
+// the pool is only allocated on first use
+// bench runs can dump every Nth frame for visual regression checks
+LFrameCapture capture;
+const char *captureDir = ".";
+const char *recordVideoPath = NULL;
+int captureEvery = 0;
+int screenshotCount = 0;
+int recordingCount = 0;
+bool screenshotRequested = false;
+
+// --record-render path; see renderRecorder
+const char *renderRecordPath = NULL;
+
+// --soft-blit; see softBlitter
+bool softBlit = false;
+
+// --perf-counters; cpu counters per frame phase, bench mode only
+bool perfCountersRequested = false;
+LPerfCounters perfCounters;
+
 typedef enum LButtonState {
   BUTTON_STATE_YELLOW,
   BUTTON_STATE_RED,
   BUTTON_STATE_GREEN
 } LButtonState;
 
-class LTexture {
-public:
-  LTexture() {
-    texture = NULL;
-    width = 0;
-    height = 0;
-    scale = 1;
-    renderDest = {0, 0, 0, 0};
-  }
-
-  ~LTexture() { Free(); }
-
-// anything inside #if will be ignored by compiler if SDL_TTF ... macro is not
-// defined
-#if defined(SDL_TTF_MAJOR_VERSION)
-
-  bool LoadFromRenderedText(const char *text, SDL_Color tColor) {
-    // free old texture
-    Free();
-
-    // render text
-    SDL_Surface *tSurf = TTF_RenderText_Solid(gFont, text, tColor);
-    if (tSurf == NULL) {
-      printf("Unable to render text: %s\n", SDL_GetError());
-      return false;
-    }
-
-    // create texture
-    texture = SDL_CreateTextureFromSurface(renderer, tSurf);
-    if (tSurf == NULL) {
-      printf("Unable to make texture from text: %s\n", SDL_GetError());
-      return false;
-    }
-
-    width = tSurf->w;
-    height = tSurf->h;
-
-    SDL_FreeSurface(tSurf);
-
-    return true;
-  }
-
-#endif
-
-  bool LoadFromFile(const char *path) {
-    // remove pre-existing texture
-    Free();
-
-    // load new one
-    SDL_Surface *lSurf = IMG_Load(path);
-
-    if (lSurf == NULL) {
-      printf("Unable to load image: %s\n", SDL_GetError());
-      return false;
-    }
-
-    // set color key to black
-    SDL_SetColorKey(lSurf, SDL_TRUE, SDL_MapRGB(lSurf->format, 0, 0, 0));
-
-    // make texture w/color key
-    SDL_Texture *nTexture = SDL_CreateTextureFromSurface(renderer, lSurf);
-
-    if (nTexture == NULL) {
-      printf("Could not create texture: %s\n", SDL_GetError());
-      return false;
-    }
+LTexture tBackground;
+LTexture tPrompt;
+LTexture tTimer;
+LTexture tButton;
+LTexture tLavaThingSpriteSheet;
 
-    width = lSurf->w;
-    height = lSurf->h;
+LSprite charSprite(&tSpriteSheet, charSpriteClips, 2);
 
-    // get rid of interim surface
-    SDL_FreeSurface(lSurf);
+SDL_Rect lavaThingSpriteClips[] = {{0, 0, 8, 8}, {0, 8, 8, 8}};
 
-    // set new texture
-    texture = nTexture;
+SDL_Rect buttonSpriteClips[] = {{0, 0, 8, 8}, {0, 8, 8, 8}, {0, 16, 8, 8}};
 
-    return true;
-  }
+class LButton {
+public:
+  static const int BUTTON_WIDTH = 89;
+  static const int BUTTON_HEIGHT = 89;
 
-  void Free() {
-    if (texture != NULL) {
-      SDL_DestroyTexture(texture);
-      texture = NULL;
-      width = 0;
-      height = 0;
-    }
+  LButton() {
+    mPosition.x = 0;
+    mPosition.y = 0;
+    mState = BUTTON_STATE_RED;
   }
 
-  void SetBlendMode(SDL_BlendMode blendMode) {
-    // set blend mode
-    SDL_SetTextureBlendMode(texture, blendMode);
+  void SetPosition(int x, int y) {
+    mPosition.x = x;
+    mPosition.y = y;
   }
 
-  // modulation ~ multiplication!
-
-  void ModColor(Uint8 r, Uint8 g, Uint8 b) {
-    SDL_SetTextureColorMod(texture, r, g, b);
+  SDL_Rect GetRect() {
+    SDL_Rect r = {mPosition.x, mPosition.y, BUTTON_WIDTH, BUTTON_HEIGHT};
+    return r;
   }
 
-  void ModAlpha(Uint8 a) { SDL_SetTextureAlphaMod(texture, a); }
+  LButtonState GetState() { return mState; }
 
-  void Render(int x, int y, SDL_Rect *clip = NULL) {
-    // set render space on screen
-    // sprite will be stretched to match
-    renderDest = {x, y, width, height};
+  // standalone use; LUILayer does the hit test itself and calls OnPointer
+  void HandleEvent(SDL_Event *e) {
+    // the event's own position; SDL_GetMouseState is wherever the mouse is
+    // by now, which may be several events later
+    SDL_Point p;
 
-    // give dest rect the dimensions of the src rect
-    if (clip != NULL) {
-      renderDest.w = clip->w;
-      renderDest.h = clip->h;
+    if (e->type == SDL_MOUSEMOTION) {
+      p = {e->motion.x, e->motion.y};
     }
 
-    renderDest.w *= scale;
-    renderDest.h *= scale;
-
-    // render to screen
-    // pass in clip as src rect
-    SDL_RenderCopy(renderer, texture, clip, &renderDest);
-  }
-
-  void RenderRotated(int x, int y, SDL_Rect *clip, double angle,
-                     SDL_Point *center, SDL_RendererFlip flip) {
-    renderDest = {x, y, width, height};
-
-    // careful! this isn't given a value by default
-    if (clip != NULL) {
-      renderDest.w = clip->w;
-      renderDest.h = clip->h;
+    else if (e->type == SDL_MOUSEBUTTONDOWN || e->type == SDL_MOUSEBUTTONUP) {
+      p = {e->button.x, e->button.y};
     }
 
-    renderDest.w *= scale;
-    renderDest.h *= scale;
-
-    // pass sprite through rotation
-    SDL_RenderCopyEx(renderer, texture, clip, &renderDest, angle, center, flip);
-  }
-
-  void RenderFill() {
-    // stretch to fill screen
-    renderDest = {0, 0, SCREEN_WIDTH, SCREEN_HEIGHT};
+    else {
+      return;
+    }
 
-    SDL_RenderCopy(renderer, texture, NULL, &renderDest);
+    SDL_Rect r = GetRect();
+    OnPointer(e->type, SDL_PointInRect(&p, &r));
   }
 
-  void RenderIgnoreScale(int x, int y, int w, int h, SDL_Rect *clip = NULL) {
-    // renders ignoring set scale; useful for ui that needs specific dimensions
-    renderDest = {x, y, w, h};
-
-    // not sure what happens if clip wh don't match given wh; does it stretch?
-    // yup, it does stretch!
-    SDL_RenderCopy(renderer, texture, clip, &renderDest);
-  }
+  // change button state depending on mouse event; returns true if the state
+  // (and so the look) changed
+  bool OnPointer(Uint32 type, bool inside) {
+    LButtonState prev = mState;
 
-  // entire texture w + h are given if render dest dimensions match
-  // but if render dest dimensions are different (we do this when rendering
-  // frames, for ex.) we return the modified w, h instead
-  // also if we haven't rendered this yet (renderDest w/h are 0) just use
-  // regular w/h too
+    if (!inside) {
+      mState = BUTTON_STATE_RED;
+    }
 
-  int GetWidth() {
-    if (renderDest.w == width || renderDest.w == 0) {
-      return width * scale;
+    else {
+      switch (type) {
+      // case SDL_MOUSEMOTION:
+      //   mState = BUTTON_STATE_YELLOW;
+      // break;
+      case SDL_MOUSEBUTTONDOWN:
+        mState = BUTTON_STATE_GREEN;
+        break;
+      case SDL_MOUSEBUTTONUP:
+        mState = BUTTON_STATE_RED;
+        break;
+      }
     }
 
-    return renderDest.w;
+    return mState != prev;
   }
 
-  int GetHeight() {
-    if (renderDest.h == height || renderDest.h == 0) {
-      return height * scale;
-    }
+  void Render() { Render(mPosition.x, mPosition.y); }
 
-    return renderDest.h;
+  void Render(int x, int y) {
+    // render button texture
+    // don't use sprite class because state is managed by instance
+    tButton.RenderIgnoreScale(x, y, BUTTON_WIDTH, BUTTON_HEIGHT,
+                              &buttonSpriteClips[mState]);
   }
 
-  void SetScale(int nScale) { scale = nScale; }
-
 private:
-  SDL_Texture *texture;
-  SDL_Rect renderDest;
-
-  int width;
-  int height;
-  int scale;
+  SDL_Point mPosition;
+  LButtonState mState;
 };
 
-LTexture tBackground;
-LTexture tPrompt;
-LTexture tTimer;
-LTexture tInput;
-LTexture tSpriteSheet;
-LTexture tButton;
-LTexture tLavaThingSpriteSheet;
-LTexture tBrick;
-
-class LSprite {
-public:
-  LSprite(LTexture *spriteSheet, SDL_Rect *spriteClips, int nFrames) {
-    this->spriteSheet = spriteSheet;
-    this->spriteClips = spriteClips;
-    this->nFrames = nFrames;
-
-    currentFrame = 0;
-    fTimer = 0;
-    fps = 4;
-  }
+LButton sampleButton;
 
-  float GetFrameTimer() { return this->fTimer; }
+// retained hud; F3 shows it (just the sample button for now)
+LUILayer<LButton> hud;
+int hudRoot = -1;
+bool showHud = false;
 
-  bool GetMovedFrame() { return movedFrame; }
+LTimer fpsTimer;
 
-  int GetFPS() { return this->fps; }
+int countedFrames = 0;
 
-  int GetWidth() { return spriteSheet->GetWidth(); }
+// tiles of the chunks currently streamed in; rebuilt when that set changes
+std::vector<Tile> tiles;
 
-  int GetHeight() { return spriteSheet->GetHeight(); }
+const char *levelPath = "../assets/level.lvl";
+LLevelStreamer level;
 
-  void SetFPS(int fps) {
-    if (fps < 0) {
-      printf("Could not set FPS! Out of bounds.\n");
-      return;
-    }
+Player player;
 
-    this->fps = fps;
-  }
+// lava things chase the player; one flow field over a coarse grid of the
+// level steers all of them
+const int NAV_CELL = 50;
 
-  void SetFrame(int f) {
-    if (f < 0 || f >= nFrames) {
-      printf("Could not set frame! Out of bounds.\n");
-      return;
-    }
+// bfs cells expanded per frame while the field is rebuilding
+const int NAV_BUDGET = 32768;
 
-    this->currentFrame = f;
-  }
+LFlowField navField;
+LCrowd enemies;
+int enemyCount = 8;
+const float ENEMY_SPEED = 120;
 
-  bool Render(int x, int y) {
-    movedFrame = false;
+// all enemies draw the same animation
+LSprite lavaSprite(&tLavaThingSpriteSheet, lavaThingSpriteClips, 2);
 
-    if (fps > 0) {
-      fTimer += dt;
+// torch on the player, a glow on every lava thing, and what the player can
+// see from where they stand; all in tile cells, see LLightMap
+// F4 or --no-lighting turns it off
+LLightMap lightMap;
+bool lighting = true;
+int playerLight = -1;
+std::vector<int> enemyLights;
 
-      if (fTimer > (1.0 / fps)) {
-        movedFrame = true;
+const int TORCH_RADIUS = 6;
+const int LAVA_LIGHT_RADIUS = 2;
+const int VIEW_RADIUS = 9;
 
-        if (currentFrame + 1 == nFrames) {
-          currentFrame = 0;
-        } else {
-          currentFrame++;
-        }
+// light map update + overlay, per frame
+LHistogram lightTimes(0.0005f, 2000);
 
-        fTimer = 0;
-      }
-    }
+// lights follow whatever they're attached to; only a change of cell marks
+// anything dirty
+void SyncLights() {
+  int size = level.GetTileSize();
 
-    // draw
-    spriteSheet->Render(x, y, &spriteClips[currentFrame]);
+  int px = (player.GetPosX() + player.sprite.GetWidth() / 2) / size;
+  int py = (player.GetPosY() + player.sprite.GetHeight() / 2) / size;
 
-    return movedFrame;
+  if (playerLight < 0) {
+    playerLight = lightMap.AddLight(px, py, TORCH_RADIUS, 255, 210, 140);
   }
 
-private:
-  LTexture *spriteSheet;
-  SDL_Rect *spriteClips;
-
-  int currentFrame;
-  int nFrames;
-  int fps;
-  bool movedFrame;
-  float fTimer;
-};
-
-SDL_Rect charSpriteClips[] = {{0, 0, 16, 16}, {0, 16, 16, 16}};
-
-LSprite charSprite(&tSpriteSheet, charSpriteClips, 2);
-
-SDL_Rect lavaThingSpriteClips[] = {{0, 0, 8, 8}, {0, 8, 8, 8}};
-
-SDL_Rect buttonSpriteClips[] = {{0, 0, 8, 8}, {0, 8, 8, 8}, {0, 16, 8, 8}};
+  lightMap.MoveLight(playerLight, px, py);
+  lightMap.SetViewer(px, py, VIEW_RADIUS);
 
-class LButton {
-public:
-  static const int BUTTON_WIDTH = 89;
-  static const int BUTTON_HEIGHT = 89;
+  while ((int)enemyLights.size() < enemies.GetCount()) {
+    enemyLights.push_back(
+        lightMap.AddLight(0, 0, LAVA_LIGHT_RADIUS, 255, 90, 20));
+  }
 
-  LButton() {
-    mPosition.x = 0;
-    mPosition.y = 0;
-    mState = BUTTON_STATE_RED;
+  while ((int)enemyLights.size() > enemies.GetCount()) {
+    lightMap.RemoveLight(enemyLights.back());
+    enemyLights.pop_back();
   }
 
-  void SetPosition(int x, int y) {
-    mPosition.x = x;
-    mPosition.y = y;
+  for (int i = 0; i < enemies.GetCount(); ++i) {
+    lightMap.MoveLight(enemyLights[i], (int)enemies.GetX(i) / size,
+                       (int)enemies.GetY(i) / size);
   }
+}
 
-  void HandleEvent(SDL_Event *e) {
-    // enter this if any mouse events happen
-    if (e->type == SDL_MOUSEMOTION || e->type == SDL_MOUSEBUTTONDOWN ||
-        e->type == SDL_MOUSEBUTTONUP) {
-      // get mouse pos
-      int x, y;
-      SDL_GetMouseState(&x, &y);
-
-      // check if mouse within button
-      bool inside = true;
-
-      if (x < mPosition.x) {
-        inside = false;
-      }
+void RenderLighting(int camX, int camY) {
+  auto start = std::chrono::high_resolution_clock::now();
 
-      else if (x > mPosition.x + BUTTON_WIDTH) {
-        inside = false;
-      }
+  SyncLights();
+  lightMap.Update();
+  lightMap.RenderOverlay(renderer, camX, camY, level.GetTileSize());
 
-      else if (y < mPosition.y) {
-        inside = false;
-      }
+  lightTimes.Add(
+      std::chrono::duration<float, std::chrono::milliseconds::period>(
+          std::chrono::high_resolution_clock::now() - start)
+          .count());
+}
 
-      else if (y > mPosition.y + BUTTON_HEIGHT) {
-        inside = false;
-      }
+// embers rising off the lava things and dust kicked up by the player's
+// steps; cosmetic, so they aren't part of the rewind history
+const int EMBER_MAX = 4096;
+const float EMBER_RATE = 12; // per enemy per second
+const int DUST_MAX = 1024;
+const int DUST_PER_STEP = 6;
 
-      // change button state depending on mouse event
-      if (!inside) {
-        mState = BUTTON_STATE_RED;
-      }
+LParticleSystem embers;
+LParticleSystem dust;
+float emberAccum = 0;
 
-      else {
-        switch (e->type) {
-        // case SDL_MOUSEMOTION:
-        //   mState = BUTTON_STATE_YELLOW;
-        // break;
-        case SDL_MOUSEBUTTONDOWN:
-          mState = BUTTON_STATE_GREEN;
-          break;
-        case SDL_MOUSEBUTTONUP:
-          mState = BUTTON_STATE_RED;
-          break;
-        }
-      }
-    }
-  }
+// update + draw for both systems, per frame
+LHistogram particleTimes(0.0005f, 2000);
 
-  void Render() {
-    // render button texture
-    // don't use sprite class because state is managed by instance
-    tButton.RenderIgnoreScale(mPosition.x, mPosition.y, BUTTON_WIDTH,
-                              BUTTON_HEIGHT, &buttonSpriteClips[mState]);
-  }
+// particles have their own generator so they don't shift rand()'s sequence
+// (enemy spawns, bench sound load)
+Uint32 particleRng = 0x9E3779B9;
 
-private:
-  SDL_Point mPosition;
-  LButtonState mState;
-};
+float ParticleRandom(float lo, float hi) {
+  particleRng ^= particleRng << 13;
+  particleRng ^= particleRng >> 17;
+  particleRng ^= particleRng << 5;
 
-LButton sampleButton;
+  return lo + (hi - lo) * (particleRng >> 8) * (1.0f / (1 << 24));
+}
 
-class LTimer {
-public:
-  LTimer() {
-    startTicks = 0;
-    pausedTicks = 0;
+void InitParticles() {
+  embers.Init(EMBER_MAX, EMBER_MAX);
+  embers.SetGravity(-90);
+  embers.SetDrag(1.5f);
+  embers.SetSize(GLOB_SCALE / 2);
 
-    paused = false;
-    started = false;
-  }
+  dust.Init(DUST_MAX, DUST_MAX);
+  dust.SetGravity(240);
+  dust.SetDrag(5);
+  dust.SetSize(GLOB_SCALE / 2);
+}
 
-  void Start() {
-    // start timer
-    started = true;
-    paused = false;
+void EmitParticles() {
+  emberAccum += EMBER_RATE * enemies.GetCount() * dt;
 
-    startTicks = SDL_GetTicks();
-    pausedTicks = 0;
-  }
+  while (emberAccum >= 1 && enemies.GetCount() > 0) {
+    int i = (int)ParticleRandom(0, enemies.GetCount() - 0.001f);
+    SDL_Color c = {255, (Uint8)ParticleRandom(60, 200), 0, 255};
 
-  void Stop() {
-    // completely stop timer w/o intent of resuming
-    started = false;
-    paused = false;
+    embers.Emit(enemies.GetX(i) + ParticleRandom(-20, 20),
+                enemies.GetY(i) + ParticleRandom(-20, 20),
+                ParticleRandom(-30, 30), ParticleRandom(-60, -20),
+                ParticleRandom(0.4f, 1.2f), c);
 
-    startTicks = 0;
-    pausedTicks = 0;
+    emberAccum -= 1;
   }
 
-  void Pause() {
-    // can only pause if already running and not paused
-    if (started && !paused) {
-      paused = true;
+  // from the player's feet, on the frames the step sound plays
+  if (player.sprite.GetMovedFrame()) {
+    float x = player.GetPosX() + player.sprite.GetWidth() / 2.0f;
+    float y = player.GetPosY() + player.sprite.GetHeight();
 
-      // get time kept before pause
-      pausedTicks = SDL_GetTicks() - startTicks;
+    for (int i = 0; i < DUST_PER_STEP; ++i) {
+      Uint8 grey = (Uint8)ParticleRandom(120, 180);
+      SDL_Color c = {grey, grey, grey, 200};
 
-      // reset counted runtime
-      startTicks = 0;
+      dust.Emit(x + ParticleRandom(-24, 24), y - ParticleRandom(0, 8),
+                ParticleRandom(-80, 80), ParticleRandom(-120, -40),
+                ParticleRandom(0.25f, 0.5f), c);
     }
   }
+}
 
-  void Unpause() {
-    if (started && paused) {
-      paused = false;
+void UpdateParticles(int camX, int camY) {
+  auto start = std::chrono::high_resolution_clock::now();
 
-      // get time kept during pause
-      startTicks = SDL_GetTicks() - pausedTicks;
+  embers.Update(dt);
+  dust.Update(dt);
 
-      // reset paused ticks
-      pausedTicks = 0;
-    }
-  }
+  embers.Render(renderer, camX, camY, SCREEN_WIDTH, SCREEN_HEIGHT);
+  dust.Render(renderer, camX, camY, SCREEN_WIDTH, SCREEN_HEIGHT);
 
-  // get timer curr. time
-  Uint32 GetTicks() {
-    // actual kept time
-    Uint32 time = 0;
+  particleTimes.Add(
+      std::chrono::duration<float, std::chrono::milliseconds::period>(
+          std::chrono::high_resolution_clock::now() - start)
+          .count());
+}
 
-    if (started) {
-      // if paused, return time kept before pause
-      if (paused) {
-        time = pausedTicks;
-      }
+// whole level, like the light map; a chunk counts as a wall until it's been
+// streamed in, and evicted chunks keep their walls, so the grid never resets
+// under enemies that are off in chunks the player has left
+void InitNavGrid() {
+  int w = level.GetWidth() / NAV_CELL;
+  int h = level.GetHeight() / NAV_CELL;
+  navField.Init(w, h);
+
+  for (int y = 0; y < h; ++y) {
+    for (int x = 0; x < w; ++x) {
+      navField.SetBlocked(x, y, true);
+    }
+  }
+}
 
-      // if not, return time kept since last start/unpause
-      else {
-        time = SDL_GetTicks() - startTicks;
+// reopens the streamed-in chunks and marks every nav cell a tile overlaps as
+// blocked; the field rebuilds in the background and enemies keep following
+// the old one until it's done
+void BuildNavGrid() {
+  int chunkPx = level.GetChunkTiles() * level.GetTileSize();
+
+  for (int i = 0; i < level.GetResidentCount(); ++i) {
+    LevelChunk *c = level.GetResident(i);
+    int x0 = c->cx * chunkPx / NAV_CELL;
+    int y0 = c->cy * chunkPx / NAV_CELL;
+    int x1 = ((c->cx + 1) * chunkPx - 1) / NAV_CELL;
+    int y1 = ((c->cy + 1) * chunkPx - 1) / NAV_CELL;
+
+    for (int y = y0; y <= y1; ++y) {
+      for (int x = x0; x <= x1; ++x) {
+        navField.SetBlocked(x, y, false);
       }
     }
-
-    return time;
   }
 
-  // check status of timer
-  bool IsStarted() { return started; }
+  for (int i = 0; i < tiles.size(); ++i) {
+    int x0 = tiles[i].GetPosX() / NAV_CELL;
+    int y0 = tiles[i].GetPosY() / NAV_CELL;
+    int x1 = (tiles[i].GetPosX() + Tile::TILE_WIDTH - 1) / NAV_CELL;
+    int y1 = (tiles[i].GetPosY() + Tile::TILE_HEIGHT - 1) / NAV_CELL;
 
-  bool IsPaused() {
-    // paused is different from stopped completely
-    return paused && paused;
+    for (int y = y0; y <= y1; ++y) {
+      for (int x = x0; x <= x1; ++x) {
+        navField.SetBlocked(x, y, true);
+      }
+    }
   }
 
-private:
-  Uint32 startTicks;  // time when timer started
-  Uint32 pausedTicks; // ticks when timer paused
+  navField.Invalidate();
+}
 
-  bool paused;
-  bool started;
-};
+// random open cells around the start; rand() is unseeded, so spawns match
+// across replays
+void SpawnEnemies(int n) {
+  enemies.Clear();
+  enemies.Reserve(n);
 
-LTimer fpsTimer;
+  SDL_Rect r = level.GetResidentBounds();
+  int x0 = r.x / NAV_CELL;
+  int y0 = r.y / NAV_CELL;
+  int w = r.w / NAV_CELL;
+  int h = r.h / NAV_CELL;
 
-int countedFrames = 0;
+  while (enemies.GetCount() < n) {
+    int x = x0 + rand() % w;
+    int y = y0 + rand() % h;
 
-bool CheckCollision(SDL_Rect a, SDL_Rect b) {
-  // sides of both rects
-  int leftA, leftB;
-  int rightA, rightB;
-  int topA, topB;
-  int bottomA, bottomB;
-
-  // calculate sides of a
-  leftA = a.x;
-  rightA = a.x + a.w;
-  topA = a.y;
-  bottomA = a.y + a.h;
-
-  // calculate sides of b
-  leftB = b.x;
-  rightB = b.x + b.w;
-  topB = b.y;
-  bottomB = b.y + b.h;
-
-  // if any sides from a are outside b
-  if (bottomA <= topB) {
-    return false;
-  }
+    if (navField.IsBlocked(x, y)) {
+      continue;
+    }
 
-  if (topA >= bottomB) {
-    return false;
+    float speed = ENEMY_SPEED * (0.8f + 0.4f * (rand() % 100) / 100.0f);
+    enemies.Add((x + 0.5f) * NAV_CELL, (y + 0.5f) * NAV_CELL, speed);
   }
+}
 
-  if (rightA <= leftB) {
-    return false;
-  }
+void MoveEnemies() {
+  int x = player.GetPosX() + player.sprite.GetWidth() / 2;
+  int y = player.GetPosY() + player.sprite.GetHeight() / 2;
 
-  if (leftA >= rightB) {
-    return false;
-  }
+  // rebuilds only start when the player crosses into another cell
+  navField.SetGoal(x / NAV_CELL, y / NAV_CELL);
+  navField.Step(NAV_BUDGET);
 
-  // if no sides of a are outside b
-  return true;
+  enemies.Update(navField, NAV_CELL, dt);
 }
 
-class Tile {
-public:
-  static const int TILE_WIDTH = 100;
-  static const int TILE_HEIGHT = 100;
+void RenderEnemies(int camX, int camY) {
+  int size = lavaSprite.GetWidth();
 
-  Tile() {
-    collider.x = 0;
-    collider.y = 0;
-    collider.w = TILE_WIDTH;
-    collider.h = TILE_HEIGHT;
+  for (int i = 0; i < enemies.GetCount(); ++i) {
+    int x = (int)enemies.GetX(i) - size / 2 - camX;
+    int y = (int)enemies.GetY(i) - size / 2 - camY;
 
-    posX = 0;
-    posY = 0;
+    // off screen
+    if (x + size < 0 || y + size < 0 || x > SCREEN_WIDTH || y > SCREEN_HEIGHT) {
+      continue;
+    }
 
-    texture = &tBrick;
+    lavaSprite.Render(x, y);
   }
+}
 
-  SDL_Rect *GetCollider() { return &collider; }
+// last 10s of simulation state at target fps, for instant replay/rollback
+const int SNAPSHOT_FRAMES = 10 * 120;
+LSnapshotRing stateHistory(SNAPSHOT_FRAMES);
 
-  void SetPosition(int x, int y, int camX = 0, int camY = 0) {
-    posX = x;
-    posY = y;
+// the level used to be five bricks placed by hand in Init(); this keeps them
+// and scatters walls over a map big enough to need streaming
+bool WriteDefaultLevel(const char *path) {
+  const int W = 96;
+  const int H = 96;
+  const int CHUNK_TILES = 16;
 
-    collider.x = x - camX;
-    collider.y = y - camY;
-  }
+  std::vector<Uint8> t(W * H, LEVEL_TILE_EMPTY);
 
-  void ApplyCameraOffset(int camX, int camY) {
-    // tiles are static by nature (pos stays same), but their colliders should
-    // have the cam. offset applied to them
-    collider.x = posX - camX;
-    collider.y = posY - camY;
+  for (int x = 0; x < 5; ++x) {
+    t[x] = LEVEL_TILE_BRICK;
   }
 
-  void Render(int camX, int camY) {
-    texture->RenderIgnoreScale(posX - camX, posY - camY, collider.w,
-                               collider.h);
+  // fixed seed, so every generated file is the same
+  Uint32 seed = 12345;
+  for (int i = 0; i < 300; ++i) {
+    seed = seed * 1664525 + 1013904223;
+    int x = (seed >> 8) % W;
+    int y = (seed >> 16) % H;
+    int len = 2 + (seed >> 24) % 5;
+    bool vertical = (seed >> 4) & 1;
+
+    for (int j = 0; j < len; ++j) {
+      int tx = vertical ? x : x + j;
+      int ty = vertical ? y + j : y;
+
+      if (tx < W && ty < H) {
+        t[ty * W + tx] = LEVEL_TILE_BRICK;
+      }
+    }
   }
 
-private:
-  SDL_Rect collider;
-  LTexture *texture;
-
-  int posX, posY;
-};
-
-const int TILE_COUNT = 5;
-std::vector<Tile> tiles;
+  // keep the player's spawn open
+  int spawnX = SCREEN_WIDTH / 2 / Tile::TILE_WIDTH;
+  int spawnY = SCREEN_HEIGHT / 2 / Tile::TILE_HEIGHT;
+  for (int y = spawnY - 1; y <= spawnY + 3; ++y) {
+    for (int x = spawnX - 1; x <= spawnX + 2; ++x) {
+      t[y * W + x] = LEVEL_TILE_EMPTY;
+    }
+  }
 
-class Player {
-public:
-  static const int PLAYER_VEL = 5;
+  return WriteLevelFile(path, Tile::TILE_WIDTH, CHUNK_TILES, W, H, t.data());
+}
 
-  LSprite sprite;
+// one Tile per brick in the streamed-in chunks
+void RebuildLevelTiles() {
+  tiles.clear();
 
-  // sprite doesn't have a default constructor; must explicitly initialize it
-  // using this syntax
-  Player() : sprite(&tSpriteSheet, charSpriteClips, 2) {
-    posX = 0;
-    posY = 0;
+  int n = level.GetChunkTiles();
+  int size = level.GetTileSize();
 
-    velX = 0;
-    velY = 0;
+  for (int i = 0; i < level.GetResidentCount(); ++i) {
+    LevelChunk *c = level.GetResident(i);
 
-    // will take the dimensions of curr. frame, for better or worse
-    collider.w = 0;
-    collider.h = 0;
-  }
+    for (int y = 0; y < n; ++y) {
+      for (int x = 0; x < n; ++x) {
+        bool brick = c->tiles[y * n + x] == LEVEL_TILE_BRICK;
 
-  SDL_Rect *GetCollider() { return &this->collider; }
+        // only walls that changed relight anything
+        lightMap.SetOpaque(c->cx * n + x, c->cy * n + y, brick);
 
-  void HandleEvent(SDL_Event &e) {
-    // when key is pressed, update velocity to match direction
-    if (e.type == SDL_KEYDOWN && e.key.repeat == 0) {
-      switch (e.key.keysym.sym) {
-      case SDLK_UP:
-        velY -= PLAYER_VEL;
-        break;
-      case SDLK_DOWN:
-        velY += PLAYER_VEL;
-        break;
-      case SDLK_LEFT:
-        velX -= PLAYER_VEL;
-        break;
-      case SDLK_RIGHT:
-        velX += PLAYER_VEL;
-        break;
-      }
-    }
+        if (!brick) {
+          continue;
+        }
 
-    // when key released, undo vel change not by setting to 0, but by
-    // subtracting what the downpress did very logical, it doesn't mess with
-    // any other vel changes we made!
-    else if (e.type == SDL_KEYUP && e.key.repeat == 0) {
-      switch (e.key.keysym.sym) {
-      case SDLK_UP:
-        velY += PLAYER_VEL;
-        break;
-      case SDLK_DOWN:
-        velY -= PLAYER_VEL;
-        break;
-      case SDLK_LEFT:
-        velX += PLAYER_VEL;
-        break;
-      case SDLK_RIGHT:
-        velX -= PLAYER_VEL;
-        break;
+        tiles.push_back(Tile());
+        tiles.back().SetPosition((c->cx * n + x) * size,
+                                 (c->cy * n + y) * size);
       }
     }
   }
+}
 
-  void SetPosition(int x, int y) {
-    posX = x;
-    posY = y;
+// opens the level (writing the default one if there isn't any) and loads the
+// chunks around the camera before the first frame
+bool LoadLevel() {
+  SDL_RWops *probe = SDL_RWFromFile(levelPath, "rb");
+  if (probe != NULL) {
+    SDL_RWclose(probe);
   }
 
-  bool CheckTileCollisions(std::vector<Tile> &tiles) {
-    // this seems a bit expensive for large sets :/
-    for (int i = 0; i < tiles.size(); ++i) {
-      if (CheckCollision(collider, *tiles[i].GetCollider())) {
-        return true;
-      }
+  else {
+    printf("No level file, writing default to %s\n", levelPath);
+
+    if (!WriteDefaultLevel(levelPath)) {
+      printf("Unable to write level: %s\n", SDL_GetError());
+      return false;
     }
+  }
 
+  if (!level.Open(levelPath)) {
+    printf("Unable to open level: %s\n", SDL_GetError());
     return false;
   }
 
-  int GetPosX() { return posX; }
+  levelBounds.w = level.GetWidth();
+  levelBounds.h = level.GetHeight();
 
-  int GetPosY() { return posY; }
+  // whole level, a cell per tile; evicted chunks keep their walls in it
+  int size = level.GetTileSize();
+  lightMap.Init(level.GetWidth() / size, level.GetHeight() / size);
+  lightMap.SetAmbient(40, 40, 60);
+  lightMap.InitOverlay(renderer, SCREEN_WIDTH, SCREEN_HEIGHT, size);
 
-  void Move(std::vector<Tile> &tiles, int camX, int camY) {
-    // update collider with position
-    // this fixes clipping (how???)
-    posX += velX;
-    collider.x = posX - camX;
-    collider.w = sprite.GetWidth();
+  // chunks are recycled from here on, so streaming doesn't allocate
+  level.Reserve(cam.w, cam.h);
 
-    // reverse vel if hit bounds
-    // account for the fact that pos is in topleft for 2nd part of ||
-    // dont move if colliding
-    if (posX < 0 || posX + sprite.GetWidth() > LEVEL_WIDTH ||
-        CheckTileCollisions(tiles)) {
-      posX -= velX;
-      collider.x = posX;
-    }
+  // and neither do rebuilt tiles or Player::Move's candidate list, sized
+  // for every resident tile being a wall
+  size_t maxTiles = (size_t)level.GetMaxResident() * level.GetChunkTiles() *
+                    level.GetChunkTiles();
+  tiles.reserve(maxTiles);
+  frameArena.Reserve(FRAME_ARENA_BASE + maxTiles * sizeof(Tile *));
 
-    posY += velY;
-    collider.y = posY - camY;
-    collider.h = sprite.GetHeight();
+  InitNavGrid();
 
-    if (posY < 0 || posY + sprite.GetHeight() > LEVEL_HEIGHT ||
-        CheckTileCollisions(tiles)) {
-      posY -= velY;
-      collider.y = posY;
-    }
-  }
+  level.LoadAround(cam);
+  RebuildLevelTiles();
 
-  void Render(int camX, int camY) {
-    // set sprite fps depending on keydown state
-    if (KEYS[UP] || KEYS[DOWN] || KEYS[LEFT] || KEYS[RIGHT]) {
-      sprite.SetFPS(4);
-    }
+  return true;
+}
 
-    else {
-      sprite.SetFPS(0);
-    }
+// everything the simulation needs to resume from a frame; textures, audio,
+// ui and held keys aren't simulation state, and neither are level tiles (they
+// come from the level file)
+void SnapshotGameState(LStateArena &a) {
+  player.Snapshot(a);
+  a.Write(cam);
 
-    sprite.Render(posX - camX, posY - camY);
-  }
+  enemies.Snapshot(a);
 
-  void PlaySound() {
-    if (sprite.GetMovedFrame()) {
-      Mix_PlayChannel(-1, step, 0);
-    }
-  }
+  a.WriteBytes(saveData, sizeof(saveData));
+}
 
-private:
-  int posX, posY;
-  int velX, velY;
-  SDL_Rect collider;
-};
+void RestoreGameState(LStateArena &a) {
+  player.Restore(a);
+  a.Read(cam);
 
-Player player;
+  enemies.Restore(a);
+
+  a.ReadBytes(saveData, sizeof(saveData));
+}
+
+// pushes this frame onto the history ring
+void PushStateSnapshot(Uint32 tick) {
+  LStateArena *a = stateHistory.Push(tick);
+  SnapshotGameState(*a);
+
+  // state grew (e.g. more tiles); reserve for it and redo the snapshot
+  // only allocates the first time it happens
+  if (a->Overflowed()) {
+    stateHistory.Reserve(a->GetUsed() * 2);
+    a->Clear();
+    SnapshotGameState(*a);
+  }
+}
 
 bool Init() {
   // start sdl
@@ -776,6 +767,37 @@ bool Init() {
   // adjust renderer color used
   SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
 
+  // pools are sized once; nothing is allocated in the loop
+  InitParticles();
+
+  // before any texture loads, so each one gets a blitter copy
+  if (softBlit && softBlitter.Init(renderer, SCREEN_WIDTH, SCREEN_HEIGHT)) {
+    memoryStats.Set(&softBlitter, MEM_SUBSYSTEM, "soft blitter",
+                    softBlitter.GetMemoryUsage());
+  }
+
+  // full size target; lower scales just use its top left corner
+  if (dynamicRes) {
+    if (SDL_RenderTargetSupported(renderer)) {
+      worldTarget = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888,
+                                      SDL_TEXTUREACCESS_TARGET, SCREEN_WIDTH,
+                                      SCREEN_HEIGHT);
+    }
+
+    if (worldTarget == NULL) {
+      printf("Dynamic resolution unavailable: %s\n", SDL_GetError());
+    }
+
+    else {
+      float budget =
+          dynamicResBudgetMs > 0 ? dynamicResBudgetMs : 1000 / targetFps;
+      resScaler.Init(budget);
+
+      memoryStats.Set(&worldTarget, MEM_TEXTURE, "world render target",
+                      LMemoryStats::TextureBytes(worldTarget));
+    }
+  }
+
   // start up sdl image loader
   int imageFlags = IMG_INIT_PNG; // this bitmask should result in a 1
   int initResult = IMG_Init(imageFlags) & imageFlags;
@@ -791,11 +813,26 @@ bool Init() {
   }
 
   // start mixer
-  if (Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, 2048) < 0) {
+  int audioFrames = lowLatencyAudio ? LOW_LATENCY_FRAMES : 2048;
+  if (Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, audioFrames) < 0) {
     printf("Could not load mixer: %s\n", SDL_GetError());
     return false;
   }
 
+  // fixed channel budget instead of the mixer's default
+  if (!voices.Init(VOICE_BUDGET)) {
+    return false;
+  }
+
+  // fall back to SDL_mixer channels if the device format doesn't suit it
+  if (lowLatencyAudio) {
+    sfxMixerReady = sfxMixer.Init(VOICE_BUDGET);
+  }
+
+  if (sfxMixerReady) {
+    voices.SetMixer(&sfxMixer);
+  }
+
   // get window surface
   screenSurface = SDL_GetWindowSurface(window);
 
@@ -807,17 +844,22 @@ bool Init() {
   sampleButton.SetPosition((SCREEN_WIDTH / 2) - (LButton::BUTTON_WIDTH / 2),
                            (SCREEN_HEIGHT / 2) - (LButton::BUTTON_HEIGHT / 2));
 
-  // instantiate and position tiles
+  // hud tree; still works uncached if render targets aren't supported
+  hud.Init(renderer, SCREEN_WIDTH, SCREEN_HEIGHT);
+  hudRoot = hud.Add(NULL);
+  hud.Add(&sampleButton, hudRoot);
 
-  for (int i = 0; i < TILE_COUNT; ++i) {
-    tiles.push_back(Tile());
+  memoryStats.Set(&hud, MEM_TEXTURE, "hud cache",
+                  LMemoryStats::TextureBytes(hud.GetCache()));
+
+  // level tiles around the starting view
+  if (!LoadLevel()) {
+    return false;
   }
 
-  tiles[0].SetPosition(0, 0);
-  tiles[1].SetPosition(Tile::TILE_WIDTH, 0);
-  tiles[2].SetPosition(Tile::TILE_WIDTH * 2, 0);
-  tiles[3].SetPosition(Tile::TILE_WIDTH * 3, 0);
-  tiles[4].SetPosition(Tile::TILE_WIDTH * 4, 0);
+  // enemies path around the tiles
+  BuildNavGrid();
+  SpawnEnemies(enemyCount);
 
   // position player
   player.SetPosition(SCREEN_WIDTH / 2, SCREEN_HEIGHT / 2);
@@ -839,10 +881,24 @@ bool LoadMedia() {
   }
 
   // text
-  tInput.LoadFromRenderedText(inputText.c_str(), textColor);
   tPrompt.LoadFromRenderedText("Sample text", textColor);
   tTimer.LoadFromRenderedText("Press ENTER to track time!", textColor);
 
+  // stats overlay text
+  if (gFont != NULL && !overlayGlyphs.Build(renderer, gFont, textColor)) {
+    success = false;
+  }
+
+  // input field wraps a little short of the screen edge
+  if (gFont != NULL) {
+    inputField.Init(renderer, gFont, textColor, SCREEN_WIDTH - 10,
+                    INPUT_MAX_LINES);
+    inputField.SetText("Input Text");
+  }
+
+  memoryStats.Set(&overlayGlyphs, MEM_TEXT, "overlay glyphs",
+                  LMemoryStats::TextureBytes(overlayGlyphs.GetTexture()));
+
   // mk statusbar bg from text surf size
   statusBarBG = {0, SCREEN_HEIGHT - tPrompt.GetHeight() - 10, SCREEN_WIDTH,
                  tPrompt.GetHeight() + 10};
@@ -873,6 +929,8 @@ bool LoadMedia() {
     success = false;
   }
 
+  tLavaThingSpriteSheet.SetScale(GLOB_SCALE / 2);
+
   // button sprite
   if (!tButton.LoadFromFile("../assets/button.png")) {
     printf("Could not load image: %s\n", SDL_GetError());
@@ -886,38 +944,33 @@ bool LoadMedia() {
     success = false;
   }
 
-  // music
-  music = Mix_LoadMUS("../assets/music.mp3");
-  if (music == NULL) {
-    printf("Failed to load music: %s\n", SDL_GetError());
-    success = false;
+  else {
+    memoryStats.Set(step, MEM_AUDIO, "step.wav", step->alen);
   }
 
-  // savefile, open in binary read mode
-  SDL_RWops *file = SDL_RWFromFile("../assets/save.bin", "r+b");
+  // footsteps from a crowd shouldn't take every channel
+  voices.SetRateLimit(step, 60, 4);
 
-  // handle nonexistent file
-  if (file == NULL) {
-    printf("Unable to open savefile: %s\n", SDL_GetError());
-
-    // make new file by opening in binary write mode
-    file = SDL_RWFromFile("../assets/save.bin", "w+b");
+  if (voiceLoad > 0 && step != NULL) {
+    loadSound = Mix_QuickLoad_RAW(step->abuf, step->alen);
+  }
 
-    if (file != NULL) {
-      printf("New save created!\n");
+  // custom mixer only knows sounds registered before it starts
+  if (sfxMixerReady) {
+    sfxMixer.AddSound(step);
+    sfxMixer.AddSound(loadSound);
+    sfxMixer.Start();
+  }
 
-      // init data
-      for (int i = 0; i < TOTAL_DATA; ++i) {
-        saveData[i] = 0;
+  // savefile; base file then journal replayed on top, zeroed if missing
+  printf("Reading savefile...\n");
 
-        // write to file
-        // args: file obj, address of src. obj, size of src. obj, amt. of
-        // objects we're writing why don't we just write TOTAL_DATA objs?
-        SDL_RWwrite(file, &saveData[i], sizeof(Sint32), 1);
-      }
+  if (!saveFile.Load(savePath, (Uint8 *)saveData, sizeof(saveData))) {
+    printf("Unable to open savefile: %s\n", SDL_GetError());
 
-      // close file
-      SDL_RWclose(file);
+    // make new file with zeroed data
+    if (saveFile.Save((Uint8 *)saveData, sizeof(saveData))) {
+      printf("New save created!\n");
     }
 
     else {
@@ -926,37 +979,23 @@ bool LoadMedia() {
     }
   }
 
-  // if file did exist, read its data instead
-  else {
-    printf("Reading savefile...\n");
-
-    for (int i = 0; i < TOTAL_DATA; ++i) {
-      SDL_RWread(file, &saveData[i], sizeof(Sint32), 1);
-    }
-
-    SDL_RWclose(file);
-  }
-
   return success;
 }
 
 void Close() {
-  // update savefile
-  SDL_RWops *file = SDL_RWFromFile("../assets/save.bin", "w+b");
+  // let the autosave worker finish so it can't overwrite the final save
+  autosave.Stop();
 
-  if (file != NULL){
-    printf("Saving data...\n");
+  // writes out whatever screenshots and recording frames are still queued
+  capture.Stop();
 
-    for (int i = 0; i < TOTAL_DATA; ++i){
-      SDL_RWwrite(file, &saveData[i], sizeof(Sint32), 1);
-    }
-    
-    SDL_RWclose(file);
-  }
+  // update savefile; only what changed since the last autosave is written
+  printf("Saving data...\n");
 
-  else{
-    printf("Unable to save file: %s\n", SDL_GetError());
-  }
+  saveFile.Save((Uint8 *)saveData, sizeof(saveData));
+
+  // stop the chunk streamer
+  level.Close();
 
   // free loaded images
   tSpriteSheet.Free();
@@ -964,11 +1003,39 @@ void Close() {
   tSpriteSheet.Free();
   tButton.Free();
 
-  // free sfx
+  // free sfx; mixer callback reads chunk memory, so unhook it first
+  sfxMixer.Stop();
+  Mix_FreeChunk(loadSound);
   Mix_FreeChunk(step);
+  memoryStats.Remove(step);
 
-  // free music
+  // free music; stops the stream worker
+  musicStream.Close();
   Mix_FreeMusic(music);
+  memoryStats.Remove(&musicStream);
+  memoryStats.Remove(&music);
+
+  // glyph atlas and input lines belong to the renderer
+  overlayGlyphs.Free();
+  inputField.Free();
+  memoryStats.Remove(&overlayGlyphs);
+
+  hud.Free();
+  memoryStats.Remove(&hud);
+
+  if (worldTarget != NULL) {
+    SDL_DestroyTexture(worldTarget);
+    worldTarget = NULL;
+    memoryStats.Remove(&worldTarget);
+  }
+
+  // overlay texture belongs to the renderer
+  lightMap.Free();
+  memoryStats.Remove(&lightMap);
+
+  // its target belongs to the renderer; image copies go with it
+  softBlitter.Free();
+  memoryStats.Remove(&softBlitter);
 
   // free window, renderer mem
   SDL_DestroyRenderer(renderer);
@@ -982,17 +1049,977 @@ void Close() {
   SDL_Quit();
 }
 
+// world draws into the scaled target when dynamic resolution is on
+void BeginWorldRender() {
+  if (worldTarget != NULL) {
+    SDL_SetRenderTarget(renderer, worldTarget);
+    SDL_RenderSetScale(renderer, resScaler.GetScale(), resScaler.GetScale());
+  }
+
+  SDL_RenderClear(renderer);
+  renderRecorder.Clear(renderer);
+
+  // world sprites go to the blitter's frame until EndWorldRender
+  if (softBlitter.IsEnabled()) {
+    softBlitter.Begin(0, 0, 0);
+  }
+}
+
+// back to the window, with the used part of the target stretched over it
+void EndWorldRender() {
+  softBlitter.End(renderer);
+
+  if (worldTarget == NULL) {
+    return;
+  }
+
+  SDL_SetRenderTarget(renderer, NULL);
+  SDL_RenderSetScale(renderer, 1, 1);
+
+  SDL_Rect src = {0, 0, (int)(SCREEN_WIDTH * resScaler.GetScale() + 0.5f),
+                  (int)(SCREEN_HEIGHT * resScaler.GetScale() + 0.5f)};
+  SDL_RenderCopy(renderer, worldTarget, &src, NULL);
+}
+
+// screenshot if one was asked for (or it's a bench capture frame), and the
+// next recording frame; both just queue a copy for the capture worker
+void CaptureFrame() {
+  char path[256];
+
+  if (screenshotRequested) {
+    screenshotRequested = false;
+
+    snprintf(path, sizeof(path), "%s/screenshot-%03d.png", captureDir,
+             screenshotCount++);
+
+    capture.Start(SCREEN_WIDTH, SCREEN_HEIGHT);
+    if (capture.Screenshot(renderer, path)) {
+      printf("Saving %s\n", path);
+    }
+  }
+
+  if (captureEvery > 0 && countedFrames % captureEvery == 0) {
+    snprintf(path, sizeof(path), "%s/bench-%06d.png", captureDir,
+             countedFrames);
+    capture.Screenshot(renderer, path);
+  }
+
+  if (capture.IsRecording()) {
+    capture.CaptureFrame(renderer);
+  }
+}
+
+// subsystems report their own buffer sizes; cheap enough to run whenever
+// the numbers are wanted
+void UpdateMemoryStats() {
+  memoryStats.Set(&tiles, MEM_GAME_STATE, "tiles",
+                  LMemoryStats::VectorBytes(tiles));
+  memoryStats.Set(&enemies, MEM_GAME_STATE, "enemies",
+                  enemies.GetMemoryUsage());
+  memoryStats.Set(&stateHistory, MEM_GAME_STATE, "rewind history",
+                  stateHistory.GetMemoryUsage());
+  memoryStats.Set(&autosave, MEM_GAME_STATE, "autosave buffers",
+                  autosave.GetMemoryUsage());
+  memoryStats.Set(&saveBallast, MEM_GAME_STATE, "save ballast",
+                  LMemoryStats::VectorBytes(saveBallast));
+
+  memoryStats.Set(&level, MEM_SUBSYSTEM, "level chunks",
+                  level.GetMemoryUsage());
+  memoryStats.Set(&navField, MEM_SUBSYSTEM, "flow field",
+                  navField.GetMemoryUsage());
+  memoryStats.Set(&animations, MEM_SUBSYSTEM, "animations",
+                  animations.GetMemoryUsage());
+  memoryStats.Set(&frameArena, MEM_SUBSYSTEM, "frame arena",
+                  frameArena.GetCapacity());
+  memoryStats.Set(&capture, MEM_SUBSYSTEM, "frame capture",
+                  capture.GetMemoryUsage());
+
+  memoryStats.Set(&lightMap, MEM_SUBSYSTEM, "light map",
+                  lightMap.GetMemoryUsage());
+  memoryStats.Set(&embers, MEM_SUBSYSTEM, "embers", embers.GetMemoryUsage());
+  memoryStats.Set(&dust, MEM_SUBSYSTEM, "dust", dust.GetMemoryUsage());
+
+  if (softBlitter.IsEnabled()) {
+    memoryStats.Set(&softBlitter, MEM_SUBSYSTEM, "soft blitter",
+                    softBlitter.GetMemoryUsage());
+  }
+
+  memoryStats.Set(&inputField, MEM_TEXT, "input field",
+                  inputField.GetMemoryUsage());
+
+  if (musicStream.IsOpen()) {
+    memoryStats.Set(&musicStream, MEM_AUDIO, "music stream",
+                    musicStream.GetMemoryUsage());
+  }
+}
+
+// play/pause; opens the track on first use so startup never waits on it
+void ToggleMusic() {
+  if (!musicOpened) {
+    musicOpened = true;
+
+    if (!musicStream.Open(musicPath)) {
+      music = Mix_LoadMUS(musicPath);
+      if (music == NULL) {
+        printf("Failed to load music: %s\n", Mix_GetError());
+      }
+
+      // SDL_mixer doesn't say what it keeps; assume the whole file
+      else {
+        SDL_RWops *file = SDL_RWFromFile(musicPath, "rb");
+        if (file != NULL) {
+          memoryStats.Set(&music, MEM_AUDIO, musicPath, SDL_RWsize(file));
+          SDL_RWclose(file);
+        }
+      }
+    }
+  }
+
+  if (musicStream.IsOpen()) {
+    if (!musicStream.IsPlaying()) {
+      musicStream.Play();
+    }
+
+    else {
+      musicStream.SetPaused(!musicStream.IsPaused());
+    }
+  }
+
+  else if (music != NULL) {
+    if (Mix_PlayingMusic() == 0) {
+      Mix_PlayMusic(music, -1);
+    }
+
+    else if (Mix_PausedMusic() == 0) {
+      Mix_PauseMusic();
+    }
+
+    else if (Mix_PausedMusic() == 1) {
+      Mix_ResumeMusic();
+    }
+  }
+}
+
+// the status bar and the input text above it, which grows upward as it wraps
+SDL_Rect GetInputRect() {
+  int extra = inputField.GetHeight() - inputField.GetLineHeight();
+  SDL_Rect r = {statusBarBG.x, statusBarBG.y - extra, statusBarBG.w,
+                statusBarBG.h + extra};
+
+  return r;
+}
+
+// arrows go to the text while typing, so the player stops until focus
+// leaves, then picks up whatever's still held
+void SetTyping(bool on) {
+  if (on == typing) {
+    return;
+  }
+
+  typing = on;
+
+  if (typing) {
+    SDL_StartTextInput();
+    player.Stop();
+  }
+
+  else {
+    SDL_StopTextInput();
+    player.ResyncVelocity();
+  }
+}
+
+// next event for this frame; live from SDL, or from the replay file
+bool PollInput(SDL_Event *e) {
+  if (inputReplay.IsLoaded()) {
+    // keep the window responsive but ignore live input, other than closing
+    SDL_Event live;
+    while (SDL_PollEvent(&live) != 0) {
+      if (live.type == SDL_QUIT) {
+        *e = live;
+        return true;
+      }
+    }
+
+    return inputReplay.Poll(countedFrames, e);
+  }
+
+  if (SDL_PollEvent(e) == 0) {
+    return false;
+  }
+
+  inputRecorder.Record(countedFrames, *e);
+
+  return true;
+}
+
+// keys while the status bar text has focus; the field only re-lays-out and
+// re-renders the lines an edit touches
+void HandleTextKey(SDL_Event &e) {
+  // keysym mod is the or'd combo of modifier keys held when this event
+  // happened, kmodctrl denotes ctrl held down
+  bool shift = e.key.keysym.mod & KMOD_SHIFT;
+  bool ctrl = e.key.keysym.mod & KMOD_CTRL;
+
+  // backspace
+  if (e.key.keysym.sym == SDLK_BACKSPACE) {
+    inputField.Backspace();
+  }
+
+  else if (e.key.keysym.sym == SDLK_DELETE) {
+    inputField.Delete();
+  }
+
+  else if (e.key.keysym.sym == SDLK_a && ctrl) {
+    inputField.SelectAll();
+  }
+
+  // copy; the selection, or everything if nothing is selected
+  else if ((e.key.keysym.sym == SDLK_c || e.key.keysym.sym == SDLK_x) &&
+           ctrl) {
+    bool cut = e.key.keysym.sym == SDLK_x;
+
+    // cut removes exactly what it copies, so it takes everything the same
+    // way by selecting it first
+    if (cut && !inputField.HasSelection()) {
+      inputField.SelectAll();
+    }
+
+    std::string copied = inputField.HasSelection()
+                             ? inputField.GetSelectedText()
+                             : inputField.GetText();
+    SDL_SetClipboardText(copied.c_str());
+
+    if (cut) {
+      inputField.Backspace();
+    }
+  }
+
+  // paste at the cursor
+  else if (e.key.keysym.sym == SDLK_v && ctrl) {
+    // replays paste whatever the clipboard held while recording
+    if (inputReplay.IsLoaded()) {
+      inputField.Insert(inputReplay.TakeClipboard());
+    }
+
+    else {
+      // get text from clipboard into buffer, put it into input and then
+      // clear
+      char *tempText = SDL_GetClipboardText();
+      inputField.Insert(tempText);
+      inputRecorder.RecordClipboard(countedFrames, tempText);
+
+      // what is the difference between this and free() ?
+      SDL_free(tempText);
+    }
+  }
+
+  // cursor keys; the player doesn't see them while typing
+  else if (!ctrl) {
+    switch (e.key.keysym.sym) {
+    case SDLK_LEFT:
+      inputField.MoveLeft(shift);
+      break;
+    case SDLK_RIGHT:
+      inputField.MoveRight(shift);
+      break;
+    case SDLK_UP:
+      inputField.MoveUp(shift);
+      break;
+    case SDLK_DOWN:
+      inputField.MoveDown(shift);
+      break;
+    case SDLK_HOME:
+      inputField.Home(shift);
+      break;
+    case SDLK_END:
+      inputField.End(shift);
+      break;
+    case SDLK_RETURN:
+      inputField.Insert("\n");
+      break;
+    default:
+      break;
+    }
+  }
+}
+
+// everything live and replayed events do goes through here; it should only
+// depend on the event and game state, never on SDL's current input state,
+// or replays drift
+void HandleEvent(SDL_Event &e, bool &quit) {
+  // focus as of before this event; esc that ends typing shouldn't also quit
+  bool wasTyping = typing;
+
+  if (e.type == SDL_QUIT) {
+    quit = true;
+  }
+
+  else if (e.type == SDL_KEYDOWN) {
+    // movement input; latency runs until the frame showing the move is
+    // presented
+    // replayed timestamps are from the recorded run, so use poll time there
+    SDL_Keycode key = e.key.keysym.sym;
+    if (e.key.repeat == 0 && !typing &&
+        (key == SDLK_UP || key == SDLK_DOWN || key == SDLK_LEFT ||
+         key == SDLK_RIGHT)) {
+      LLatencyAxis axis = key == SDLK_LEFT || key == SDLK_RIGHT
+                              ? LATENCY_AXIS_X
+                              : LATENCY_AXIS_Y;
+      inputLatency.OnInput(
+          inputReplay.IsLoaded() ? SDL_GetTicks() : e.key.timestamp, axis);
+    }
+
+    // stats overlay
+    if (e.key.keysym.sym == SDLK_F1 && e.key.repeat == 0) {
+      showStats = !showStats;
+    }
+
+    if (e.key.keysym.sym == SDLK_F3 && e.key.repeat == 0) {
+      showHud = !showHud;
+    }
+
+    if (e.key.keysym.sym == SDLK_F4 && e.key.repeat == 0) {
+      lighting = !lighting;
+    }
+
+    if (e.key.keysym.sym == SDLK_F12 && e.key.repeat == 0) {
+      screenshotRequested = true;
+    }
+
+    if (e.key.keysym.sym == SDLK_F11 && e.key.repeat == 0) {
+      if (capture.IsRecording()) {
+        capture.StopRecording();
+      }
+
+      else {
+        char path[256];
+        snprintf(path, sizeof(path), "%s/recording-%03d.y4m", captureDir,
+                 recordingCount++);
+
+        capture.Start(SCREEN_WIDTH, SCREEN_HEIGHT);
+        capture.StartRecording(path, (int)targetFps);
+        printf("Recording to %s\n", path);
+      }
+    }
+
+    if (e.key.keysym.sym == SDLK_F2 && e.key.repeat == 0) {
+      UpdateMemoryStats();
+      memoryStats.Report();
+    }
+
+    // music controls
+    if (e.key.keysym.sym == SDLK_p && e.key.repeat == 0 && !typing) {
+      ToggleMusic();
+    }
+
+    // focus the text; enter inserts newlines once it has focus
+    else if (e.key.keysym.sym == SDLK_RETURN && e.key.repeat == 0 &&
+             !typing) {
+      SetTyping(true);
+    }
+
+    else if (e.key.keysym.sym == SDLK_ESCAPE && typing) {
+      SetTyping(false);
+    }
+
+    // everything else edits the text, only while it has focus
+    else if (typing) {
+      HandleTextKey(e);
+    }
+  }
+
+  else if (e.type == SDL_TEXTINPUT) {
+    // make sure this isn't the letter of a ctrl shortcut (select all, copy,
+    // cut, paste)
+    char c = e.text.text[0];
+    bool shortcut = c == 'a' || c == 'A' || c == 'c' || c == 'C' ||
+                    c == 'x' || c == 'X' || c == 'v' || c == 'V';
+
+    if (typing && !(modState & KMOD_CTRL && shortcut)) {
+      // insert at the cursor
+      inputField.Insert(e.text.text);
+    }
+  }
+
+  // keep input state in sync from key events themselves rather than
+  // SDL_GetKeyboardState, so replayed events drive it the same way
+  if (e.type == SDL_KEYDOWN || e.type == SDL_KEYUP) {
+    bool down = e.type == SDL_KEYDOWN;
+    modState = (SDL_Keymod)e.key.keysym.mod;
+
+    switch (e.key.keysym.scancode) {
+    case SDL_SCANCODE_UP:
+      KEYS[UP] = down;
+      break;
+    case SDL_SCANCODE_DOWN:
+      KEYS[DOWN] = down;
+      break;
+    case SDL_SCANCODE_LEFT:
+      KEYS[LEFT] = down;
+      break;
+    case SDL_SCANCODE_RIGHT:
+      KEYS[RIGHT] = down;
+      break;
+    case SDL_SCANCODE_P:
+      KEYS[PAUSE] = down;
+      break;
+    case SDL_SCANCODE_ESCAPE:
+      if (!wasTyping) {
+        KEYS[EXIT] = down;
+      }
+      break;
+    case SDL_SCANCODE_R:
+      KEYS[REWIND] = down;
+      break;
+    default:
+      break;
+    }
+  }
+
+  // clicking the status bar focuses the text, anywhere else unfocuses it
+  if (e.type == SDL_MOUSEBUTTONDOWN && e.button.button == SDL_BUTTON_LEFT) {
+    SDL_Point p = {e.button.x, e.button.y};
+    SDL_Rect r = GetInputRect();
+    SetTyping(SDL_PointInRect(&p, &r));
+  }
+
+  // hud only sees the mouse while it's up
+  if (showHud) {
+    hud.HandleEvent(&e);
+  }
+
+  // render targets lose their contents on some device resets
+  if (e.type == SDL_RENDER_TARGETS_RESET) {
+    hud.Invalidate();
+  }
+
+  // player event; arrows belong to the text while typing
+  if (!wasTyping) {
+    player.HandleEvent(e);
+  }
+}
+
+void ParseArgs(int argc, char *argv[]) {
+  for (int i = 1; i < argc; ++i) {
+    bool hasValue = i + 1 < argc;
+
+    if (strcmp(argv[i], "--bench") == 0 && hasValue) {
+      benchMode = true;
+      benchFrames = atoi(argv[++i]);
+
+      // don't clobber the real save with benchmark runs
+      savePath = "../assets/bench_save.bin";
+    }
+
+    else if (strcmp(argv[i], "--record") == 0 && hasValue) {
+      recordPath = argv[++i];
+    }
+
+    else if (strcmp(argv[i], "--replay") == 0 && hasValue) {
+      replayPath = argv[++i];
+    }
+
+    else if (strcmp(argv[i], "--music") == 0 && hasValue) {
+      musicPath = argv[++i];
+    }
+
+    else if (strcmp(argv[i], "--low-latency-audio") == 0) {
+      lowLatencyAudio = true;
+    }
+
+    else if (strcmp(argv[i], "--mem-budget-mb") == 0 && hasValue) {
+      memoryStats.SetBudget((size_t)atoi(argv[++i]) * 1024 * 1024);
+    }
+
+    else if (strcmp(argv[i], "--dynamic-res") == 0) {
+      dynamicRes = true;
+    }
+
+    else if (strcmp(argv[i], "--dynamic-res-budget-ms") == 0 && hasValue) {
+      dynamicRes = true;
+      dynamicResBudgetMs = atof(argv[++i]);
+    }
+
+    else if (strcmp(argv[i], "--capture-every") == 0 && hasValue) {
+      captureEvery = atoi(argv[++i]);
+    }
+
+    else if (strcmp(argv[i], "--record-video") == 0 && hasValue) {
+      recordVideoPath = argv[++i];
+    }
+
+    else if (strcmp(argv[i], "--capture-dir") == 0 && hasValue) {
+      captureDir = argv[++i];
+    }
+
+    else if (strcmp(argv[i], "--record-render") == 0 && hasValue) {
+      renderRecordPath = argv[++i];
+    }
+
+    else if (strcmp(argv[i], "--no-lighting") == 0) {
+      lighting = false;
+    }
+
+    else if (strcmp(argv[i], "--soft-blit") == 0) {
+      softBlit = true;
+    }
+
+    else if (strcmp(argv[i], "--perf-counters") == 0) {
+      perfCountersRequested = true;
+    }
+
+    else if (strcmp(argv[i], "--check-allocs") == 0) {
+      checkAllocs = true;
+    }
+
+    else if (strcmp(argv[i], "--level") == 0 && hasValue) {
+      levelPath = argv[++i];
+    }
+
+    else if (strcmp(argv[i], "--enemies") == 0 && hasValue) {
+      enemyCount = atoi(argv[++i]);
+    }
+
+    else if (strcmp(argv[i], "--voice-load") == 0 && hasValue) {
+      voiceLoad = atoi(argv[++i]);
+    }
+
+    else if (strcmp(argv[i], "--autosave-ms") == 0 && hasValue) {
+      autosaveIntervalMs = atoi(argv[++i]);
+    }
+
+    else if (strcmp(argv[i], "--save-ballast-kb") == 0 && hasValue) {
+      // fill with something that doesn't compress to nothing
+      saveBallast.resize(atoi(argv[++i]) * 1024);
+      for (size_t b = 0; b < saveBallast.size(); ++b) {
+        saveBallast[b] = (Uint8)(b * 2654435761u >> 24);
+      }
+    }
+
+    else {
+      printf("Unknown argument: %s\n", argv[i]);
+    }
+  }
+}
+
+// keystrokes into a short text and into one with a few hundred KB pasted
+// in; both should cost about the same
+void BenchTextField() {
+  const int KEYS_TYPED = 500;
+  const int PASTE_BYTES = 300 * 1024;
+
+  std::string paste;
+  paste.reserve(PASTE_BYTES);
+  while ((int)paste.size() < PASTE_BYTES) {
+    paste += rand() % 12 == 0 ? "\n" : "lorem ipsum dolor ";
+  }
+
+  LTextField field;
+  field.Init(renderer, gFont, textColor, SCREEN_WIDTH - 10, INPUT_MAX_LINES);
+  field.SetText("Input Text");
+
+  LHistogram shortTimes(0.005f);
+  LHistogram longTimes(0.005f);
+
+  for (int pass = 0; pass < 2; ++pass) {
+    LHistogram &times = pass == 0 ? shortTimes : longTimes;
+
+    if (pass == 1) {
+      auto start = std::chrono::high_resolution_clock::now();
+      field.Insert(paste.c_str());
+      field.Render(0, 0);
+      printf("text field paste %d KB: %.2fms, %d lines\n", PASTE_BYTES / 1024,
+             std::chrono::duration<float, std::chrono::milliseconds::period>(
+                 std::chrono::high_resolution_clock::now() - start)
+                 .count(),
+             field.GetLineCount());
+
+      // type in the middle, so there's text on both sides of the gap
+      for (int i = 0; i < field.GetLineCount() / 2; ++i) {
+        field.MoveUp(false);
+      }
+    }
+
+    for (int i = 0; i < KEYS_TYPED; ++i) {
+      auto start = std::chrono::high_resolution_clock::now();
+
+      if (i % 10 == 9) {
+        field.Backspace();
+      }
+
+      else {
+        field.Insert(i % 5 == 0 ? " " : "k");
+      }
+
+      field.Render(0, 0);
+
+      times.Add(
+          std::chrono::duration<float, std::chrono::milliseconds::period>(
+              std::chrono::high_resolution_clock::now() - start)
+              .count());
+    }
+  }
+
+  shortTimes.Print("keystroke short text");
+  longTimes.Print("keystroke 300KB text");
+}
+
+// the same mouse input against a screen of buttons, handled and drawn the
+// old way (every button, every frame) and through a retained layer
+void BenchUI() {
+  const int WIDGETS = 1000;
+  const int FRAMES = 300;
+  const int PITCH = 28;
+
+  std::vector<LButton> buttons(WIDGETS);
+  LUILayer<LButton> layer;
+  layer.Init(renderer, SCREEN_WIDTH, SCREEN_HEIGHT);
+  layer.Reserve(WIDGETS + 1);
+
+  // panels of 100 buttons each, so the tree has some depth
+  int panel = -1;
+  for (int i = 0; i < WIDGETS; ++i) {
+    if (i % 100 == 0) {
+      panel = layer.Add(NULL, -1, (i / 100) % 2 * (SCREEN_WIDTH / 2),
+                        (i / 200) * PITCH * 3);
+    }
+
+    int n = i % 100;
+    buttons[i].SetPosition(n % 16 * PITCH, n / 16 * PITCH);
+    layer.Add(&buttons[i], panel);
+  }
+
+  // a pointer sweeping the screen, clicking every so often
+  std::vector<SDL_Event> events(FRAMES);
+  for (int i = 0; i < FRAMES; ++i) {
+    SDL_Event &e = events[i];
+    int x = (i * 37) % SCREEN_WIDTH;
+    int y = (i * 23) % SCREEN_HEIGHT;
+
+    if (i % 10 == 3) {
+      e.type = SDL_MOUSEBUTTONDOWN;
+      e.button.x = x;
+      e.button.y = y;
+    }
+
+    else if (i % 10 == 5) {
+      e.type = SDL_MOUSEBUTTONUP;
+      e.button.x = x;
+      e.button.y = y;
+    }
+
+    else {
+      e.type = SDL_MOUSEMOTION;
+      e.motion.x = x;
+      e.motion.y = y;
+    }
+  }
+
+  LHistogram naiveTimes(0.01f);
+  LHistogram retainedTimes(0.01f);
+
+  for (int i = 0; i < FRAMES; ++i) {
+    auto start = std::chrono::high_resolution_clock::now();
+
+    for (int b = 0; b < WIDGETS; ++b) {
+      buttons[b].HandleEvent(&events[i]);
+    }
+
+    for (int b = 0; b < WIDGETS; ++b) {
+      buttons[b].Render();
+    }
+
+    naiveTimes.Add(
+        std::chrono::duration<float, std::chrono::milliseconds::period>(
+            std::chrono::high_resolution_clock::now() - start)
+            .count());
+  }
+
+  for (int i = 0; i < FRAMES; ++i) {
+    auto start = std::chrono::high_resolution_clock::now();
+
+    layer.HandleEvent(&events[i]);
+    layer.Render();
+
+    retainedTimes.Add(
+        std::chrono::duration<float, std::chrono::milliseconds::period>(
+            std::chrono::high_resolution_clock::now() - start)
+            .count());
+  }
+
+  naiveTimes.Print("ui immediate 1k");
+  retainedTimes.Print("ui retained 1k");
+  printf("ui retained widget draws: %ld over %d frames\n",
+         layer.GetRedraws(), FRAMES);
+}
+
+// a crowd on a big map, with the goal walking like a player would: field
+// rebuilds are time-sliced over frames, agents update every frame
+void BenchFlowField() {
+  const int FIELD_SIZE = 500;
+  const int AGENTS = 10000;
+  const int FRAMES = 1200;
+  const float CELL = 16;
+
+  LFlowField field;
+  field.Init(FIELD_SIZE, FIELD_SIZE);
+
+  // scattered walls, and a clear row for the goal to walk along
+  for (int y = 0; y < FIELD_SIZE; ++y) {
+    for (int x = 0; x < FIELD_SIZE; ++x) {
+      field.SetBlocked(x, y, y != FIELD_SIZE / 2 && rand() % 5 == 0);
+    }
+  }
+
+  LCrowd crowd;
+  crowd.Reserve(AGENTS);
+
+  while (crowd.GetCount() < AGENTS) {
+    int x = rand() % FIELD_SIZE;
+    int y = rand() % FIELD_SIZE;
+
+    if (!field.IsBlocked(x, y)) {
+      crowd.Add((x + 0.5f) * CELL, (y + 0.5f) * CELL, ENEMY_SPEED);
+    }
+  }
+
+  LHistogram flowTimes(0.01f);
+  int goalX = FIELD_SIZE / 4;
+
+  for (int i = 0; i < FRAMES; ++i) {
+    auto start = std::chrono::high_resolution_clock::now();
+
+    // a new cell every 8 frames, faster than one rebuild takes
+    field.SetGoal(goalX + i / 8, FIELD_SIZE / 2);
+    field.Step(NAV_BUDGET);
+    crowd.Update(field, CELL, 1.0f / 120);
+
+    flowTimes.Add(
+        std::chrono::duration<float, std::chrono::milliseconds::period>(
+            std::chrono::high_resolution_clock::now() - start)
+            .count());
+  }
+
+  // how many agents are at most a few cells from the goal now
+  int close = 0;
+  for (int i = 0; i < crowd.GetCount(); ++i) {
+    int d = field.GetDistance((int)(crowd.GetX(i) / CELL),
+                              (int)(crowd.GetY(i) / CELL));
+    if (d <= 8) {
+      close++;
+    }
+  }
+
+  flowTimes.Print("flow 10k/500^2");
+  printf("flow field rebuilds: %d, agents near goal: %d of %d\n",
+         field.GetRebuilds(), close, AGENTS);
+}
+
+void PrintBenchResults() {
+  printf("--- bench: %d frames ---\n", countedFrames);
+  frameTimes.Print("frame");
+  autosaveFrameTimes.Print("autosave frame");
+  printf("autosaves written: %d, snapshots skipped: %d\n",
+         autosave.GetSavesWritten(), autosave.GetSnapshotsSkipped());
+  printf("save bytes written: %zu (%d journal commits, %d compactions)\n",
+         saveFile.GetBytesWritten(), saveFile.GetCommits(),
+         saveFile.GetCompactions());
+
+  voices.PrintStats();
+  printf("avg active voices: %.2f of %d\n",
+         countedFrames > 0 ? (float)activeVoiceSum / countedFrames : 0.0f,
+         VOICE_BUDGET);
+  voicePlayTimes.Print("voice play");
+
+  if (sfxMixer.IsStarted()) {
+    sfxMixer.PrintStats();
+  }
+
+  // animation system at crowd scale
+  const int ANIM_INSTANCES = 100000;
+  const int ANIM_TICKS = 1000;
+
+  LAnimationSystem crowd;
+  crowd.Reserve(ANIM_INSTANCES);
+
+  int crowdClip = crowd.AddClip(lavaThingSpriteClips, 2);
+  for (int i = 0; i < ANIM_INSTANCES; ++i) {
+    crowd.Create(crowdClip, 2 + i % 7);
+  }
+
+  LHistogram animTimes(0.005f);
+  for (int i = 0; i < ANIM_TICKS; ++i) {
+    auto start = std::chrono::high_resolution_clock::now();
+    crowd.Update(1.0f / 120);
+    animTimes.Add(
+        std::chrono::duration<float, std::chrono::milliseconds::period>(
+            std::chrono::high_resolution_clock::now() - start)
+            .count());
+  }
+
+  animTimes.Print("anim update 100k");
+
+  if (lightMap.GetUpdates() > 0) {
+    lightTimes.Print("lighting");
+    printf("light map: %dx%d cells, %d lights, %d updates, %lld cells relit, "
+           "%d light casts, %d view casts\n",
+           lightMap.GetWidth(), lightMap.GetHeight(), lightMap.GetLightCount(),
+           lightMap.GetUpdates(), lightMap.GetCellsRelit(),
+           lightMap.GetLightCasts(), lightMap.GetViewCasts());
+  }
+
+  particleTimes.Print("particles");
+  printf("particles: %d embers, %d dust, %d dropped\n", embers.GetCount(),
+         dust.GetCount(), embers.GetDropped() + dust.GetDropped());
+
+  level.PrintStats();
+
+  printf("steady state heap allocations: %llu in %d frames (first at frame "
+         "%d), frame arena peak %zu of %zu bytes, %d overflows\n",
+         (unsigned long long)steadyAllocs, steadyAllocFrames, firstAllocFrame,
+         frameArena.GetPeak(), frameArena.GetCapacity(),
+         frameArena.GetOverflows());
+
+  if (checkAllocs) {
+    printf("alloc check: %s\n", steadyAllocFrames == 0 ? "PASS" : "FAIL");
+  }
+
+  if (worldTarget != NULL) {
+    resScaler.PrintStats();
+  }
+
+  if (capture.GetCaptured() > 0 || capture.GetDropped() > 0) {
+    capture.PrintStats();
+  }
+
+  if (perfCounters.IsOpen()) {
+    printf("--- perf counters ---\n");
+    perfCounters.Print();
+  }
+
+  if (softBlitter.IsEnabled()) {
+    printf("soft blits: %d (%d at integer scale)\n", softBlitter.GetBlits(),
+           softBlitter.GetScaledBlits());
+  }
+
+  BenchFlowField();
+  BenchUI();
+  BenchTextField();
+
+  if (musicStream.IsPlaying()) {
+    printf("music stream underruns: %d\n", musicStream.GetUnderruns());
+  }
+
+  inputLatency.GetEventToPresent().Print("event->present");
+  inputLatency.GetPollToPresent().Print("poll->present");
+  printf("inputs without visible effect: %d\n", inputLatency.GetDropped());
+
+  LStateArena *newest = stateHistory.Peek(0);
+  if (newest != NULL) {
+    printf("state snapshot: %zu bytes, %d frames kept\n", newest->GetUsed(),
+           stateHistory.GetCount());
+    snapshotTimes.Print("snapshot");
+
+    // restore is the rollback path; time it on the newest snapshot, which
+    // leaves the game state unchanged
+    const int RESTORES = 10000;
+    auto start = std::chrono::high_resolution_clock::now();
+
+    for (int i = 0; i < RESTORES; ++i) {
+      newest->Rewind();
+      RestoreGameState(*newest);
+    }
+
+    float totalMs =
+        std::chrono::duration<float, std::chrono::milliseconds::period>(
+            std::chrono::high_resolution_clock::now() - start)
+            .count();
+
+    printf("restore          mean=%7.4f (ms, %d runs)\n", totalMs / RESTORES,
+           RESTORES);
+  }
+}
+
 int main(int argc, char *argv[]) {
+  // before anything touches SDL
+  InstallAllocCounter();
+
+  ParseArgs(argc, argv);
+
+  // the stream has no render targets, so draws have to land on the window
+  if (renderRecordPath != NULL && dynamicRes) {
+    printf("--record-render ignores --dynamic-res\n");
+    dynamicRes = false;
+  }
+
+  // the blitter's frame is window sized; it has no scaled target to draw to
+  if (softBlit && dynamicRes) {
+    printf("--soft-blit ignores --dynamic-res\n");
+    dynamicRes = false;
+  }
+
+  if (replayPath != NULL) {
+    if (!inputReplay.Load(replayPath))
+      return 1;
+
+    // simulate at the rate it was recorded at
+    targetFps = inputReplay.GetFPS();
+  }
+
+  else if (recordPath != NULL) {
+    if (!inputRecorder.Open(recordPath, targetFps))
+      return 1;
+  }
+
   if (!Init())
     return 1;
 
+  // before any texture loads, so each one's pixels make it into the file
+  if (renderRecordPath != NULL) {
+    if (!renderRecorder.Open(renderRecordPath, SCREEN_WIDTH, SCREEN_HEIGHT))
+      return 1;
+  }
+
   if (!LoadMedia())
     return 1;
 
-  // start text input, seems to be on by default?
-  // SDL_StartTextInput();
+  // bench captures; start up front so the pool isn't allocated mid-run
+  if (captureEvery > 0 || recordVideoPath != NULL) {
+    capture.Start(SCREEN_WIDTH, SCREEN_HEIGHT);
+  }
+
+  if (recordVideoPath != NULL) {
+    capture.StartRecording(recordVideoPath, (int)targetFps);
+  }
+
+  autosave.Reserve(sizeof(saveData) + saveBallast.size());
+  autosave.Start(&saveFile, autosaveIntervalMs);
+
+  // opened last, on this thread, so only the main loop is counted
+  if (perfCountersRequested) {
+    if (benchMode) {
+      perfCounters.Open();
+    }
+
+    else {
+      printf("--perf-counters needs --bench\n");
+    }
+  }
+
+  // size the history ring off a dry run so snapshots don't allocate
+  LStateArena probe;
+  SnapshotGameState(probe);
+  stateHistory.Reserve(probe.GetUsed());
 
-  // need to call this when we want game to stop taking text input
+  Uint32 simTick = 0;
+  bool wasRewinding = false;
+
+  // see level.LoadAround in the loop
+  bool deterministicStreaming = inputReplay.IsLoaded() || recordPath != NULL;
+
+  // text input is on by default; it only runs while the status bar has
+  // focus (see SetTyping)
   SDL_StopTextInput();
 
   // window loop
@@ -1007,133 +2034,145 @@ int main(int argc, char *argv[]) {
              currentTime - lastUpdateTime)
              .count();
 
-    // update input text when it changes only
-    bool renderInputText = false;
-
     // if dt does not exceed frame duration, move on
-    if (dt < 1 / targetFps)
+    // bench mode runs uncapped
+    if (!benchMode && dt < 1 / targetFps)
       continue;
 
-    // poll returns 0 when no events, only run loop if events in it
-    while (SDL_PollEvent(&e) != 0) {
-      if (e.type == SDL_QUIT) {
-        quit = true;
-      }
+    // sim runs on a fixed step when recording or replaying, so the same
+    // events on the same frames give the same result
+    if (inputRecorder.IsOpen() || inputReplay.IsLoaded()) {
+      dt = 1 / targetFps;
+    }
 
-      else if (e.type == SDL_KEYDOWN) {
-        // music controls
-        if (e.key.keysym.sym == SDLK_p && e.key.repeat == 0 &&
-            !SDL_IsTextInputActive()) {
-          if (Mix_PlayingMusic() == 0) {
-            Mix_PlayMusic(music, -1);
-          }
-
-          else if (Mix_PausedMusic() == 0) {
-            Mix_PauseMusic();
-          }
-
-          else if (Mix_PausedMusic() == 1) {
-            Mix_ResumeMusic();
-          }
-        }
+    // everything from here to the end of the frame is counted
+    Uint64 allocsAtStart = GetThreadAllocations();
+    frameArena.Reset();
 
-        // input special key handling
+    // poll returns 0 when no events, only run loop if events in it
+    perfCounters.Begin(PERF_PHASE_POLL);
+    while (PollInput(&e)) {
+      HandleEvent(e, quit);
+    }
+    perfCounters.End(PERF_PHASE_POLL);
 
-        // backspace
-        else if (e.key.keysym.sym == SDLK_BACKSPACE && inputText.length() > 0) {
-          inputText.pop_back();
-          renderInputText = true;
-        }
+    // clear screen
+    BeginWorldRender();
 
-        // copy
-        // getmodstate returns or'd combo of keyboard states, kmodctrl denotes
-        // ctrl held down i think check what that bitwise looks like on paper
-        else if (e.key.keysym.sym == SDLK_c && SDL_GetModState() & KMOD_CTRL) {
-          SDL_SetClipboardText(inputText.c_str());
-        }
+    // esc check
+    if (KEYS[EXIT]) {
+      quit = true;
+    }
 
-        // paste
-        else if (e.key.keysym.sym == SDLK_v && SDL_GetModState() & KMOD_CTRL) {
-          // get text from clipboard into buffer, put it into input and then
-          // clear
-          char *tempText = SDL_GetClipboardText();
-          inputText = tempText;
+    // instant replay; holding r walks back through the state history
+    bool rewinding = KEYS[REWIND] && !typing;
 
-          // what is the difference between this and free() ?
-          SDL_free(tempText);
+    if (rewinding) {
+      Uint32 pastTick;
+      LStateArena *past = stateHistory.Pop(&pastTick);
+      if (past != NULL) {
+        RestoreGameState(*past);
 
-          renderInputText = true;
-        }
+        // simulation picks up right after the restored frame
+        simTick = pastTick + 1;
       }
 
-      else if (e.type == SDL_TEXTINPUT) {
-        // make sure we aren't copying or pasting
-        bool pressingC = e.text.text[0] == 'c' || e.text.text[0] == 'C';
-        bool pressingV = e.text.text[0] == 'v' || e.text.text[0] == 'V';
+      // don't animate forward while scrubbing back
+      dt = 0;
+    }
 
-        if (!(SDL_GetModState() & KMOD_CTRL && (pressingC || pressingV))) {
-          // append char to input text
-          inputText += e.text.text;
-          renderInputText = true;
-        }
+    else if (wasRewinding && !typing) {
+      player.ResyncVelocity();
+    }
+
+    wasRewinding = rewinding;
+
+    // advance every sprite's animation in one pass
+    animations.Update(dt);
+
+    // render bg; the texture repeats seamlessly, so wrap it for levels
+    // bigger than it
+    int bgW = tBackground.GetWidth();
+    int bgH = tBackground.GetHeight();
+    for (int y = -(cam.y % bgH); y < cam.h; y += bgH) {
+      for (int x = -(cam.x % bgW); x < cam.w; x += bgW) {
+        tBackground.Render(x, y);
       }
+    }
 
-      // render input text if needed
-      if (renderInputText) {
-        // make sure text isn't empty
-        if (inputText != "") {
-          tInput.LoadFromRenderedText(inputText.c_str(), textColor);
-        }
+    // render tiles
+    perfCounters.Begin(PERF_PHASE_TILES);
+    for (int i = 0; i < tiles.size(); ++i) {
+      tiles[i].ApplyCameraOffset(cam.x, cam.y);
 
-        // if so, just render whitespace
-        else {
-          tInput.LoadFromRenderedText(" ", textColor);
-        }
+      SDL_Rect *c = tiles[i].GetCollider();
+      if (c->x + c->w < 0 || c->y + c->h < 0 || c->x > cam.w || c->y > cam.h) {
+        continue;
       }
 
-      // pointer to array containing kb state
-      // upd'd everytime PollEvent called, so we should put this in ev. loop
-      const Uint8 *currentKeyStates = SDL_GetKeyboardState(NULL);
+      tiles[i].Render(cam.x, cam.y);
+    }
+    perfCounters.End(PERF_PHASE_TILES);
+
+    // update player
+    if (!rewinding) {
+      int oldX = player.GetPosX();
+      int oldY = player.GetPosY();
 
-      // update input state using latter
-      KEYS[UP] = currentKeyStates[SDL_SCANCODE_UP];
-      KEYS[DOWN] = currentKeyStates[SDL_SCANCODE_DOWN];
-      KEYS[LEFT] = currentKeyStates[SDL_SCANCODE_LEFT];
-      KEYS[RIGHT] = currentKeyStates[SDL_SCANCODE_RIGHT];
-      KEYS[PAUSE] = currentKeyStates[SDL_SCANCODE_P];
-      KEYS[EXIT] = currentKeyStates[SDL_SCANCODE_ESCAPE];
+      perfCounters.Begin(PERF_PHASE_MOVE);
+      player.Move(tiles, cam.x, cam.y);
+      perfCounters.End(PERF_PHASE_MOVE);
 
-      // button event
-      // sampleButton.HandleEvent(&e);
+      // inputs whose axis started, stopped or turned show this frame
+      inputLatency.OnMove(player.GetPosX() - oldX, player.GetPosY() - oldY);
 
-      // player event
-      player.HandleEvent(e);
+      MoveEnemies();
     }
+    RenderEnemies(cam.x, cam.y);
+    player.Render(cam.x, cam.y);
+    player.PlaySound();
 
-    // clear screen
-    SDL_RenderClear(renderer);
+    EmitParticles();
 
-    // esc check
-    if (KEYS[EXIT]) {
-      quit = true;
+    // these draw straight to the renderer, so the soft blitter's frame has
+    // to be down first
+    softBlitter.End(renderer);
+
+    if (lighting) {
+      RenderLighting(cam.x, cam.y);
     }
 
-    // render bg
-    tBackground.Render(0, 0, &cam);
+    // embers glow, so they go over the light
+    UpdateParticles(cam.x, cam.y);
 
-    // render tiles
-    for (int i = 0; i < 5; ++i) {
-      tiles[i].ApplyCameraOffset(cam.x, cam.y);
-      tiles[i].Render(cam.x, cam.y);
-    }
+    // synthetic sound load for benchmarking the voice manager
+    if (voiceLoad > 0 && loadSound != NULL) {
+      voiceLoadAccum += voiceLoad * dt;
 
-    // button
-    // sampleButton.Render();
+      // inside the square inscribed in the hearing circle, so nothing is
+      // culled for distance
+      int reach = (int)(voices.GetMaxDistance() * 0.7f);
 
-    // update player
-    player.Move(tiles, cam.x, cam.y);
-    player.Render(cam.x, cam.y);
-    player.PlaySound();
+      while (voiceLoadAccum >= 1) {
+        SoundPriority priority =
+            rand() % 2 == 0 ? SOUND_PRIORITY_LOW : SOUND_PRIORITY_NORMAL;
+        int x = cam.x + cam.w / 2 + rand() % (2 * reach + 1) - reach;
+        int y = cam.y + cam.h / 2 + rand() % (2 * reach + 1) - reach;
+
+        auto playStart = std::chrono::high_resolution_clock::now();
+
+        voices.Play(loadSound, priority, x, y, SDL_GetTicks());
+
+        voicePlayTimes.Add(
+            std::chrono::duration<float, std::chrono::milliseconds::period>(
+                std::chrono::high_resolution_clock::now() - playStart)
+                .count());
+
+        voiceLoadAccum -= 1;
+      }
+    }
+
+    activeVoiceSum += voices.CountActive(SDL_GetTicks());
 
     // center camera over player
     cam.x =
@@ -1141,24 +2180,37 @@ int main(int argc, char *argv[]) {
     cam.y =
         (player.GetPosY() + player.sprite.GetHeight() / 2) - SCREEN_HEIGHT / 2;
 
-    // make sure cam doesn't leave bounds, causes weird stretch
-    // we need to ensure level dimensions match level texture's!
-    if (cam.x < 0) {
-      cam.x = 0;
+    // make sure cam doesn't leave the level
+    if (cam.x > levelBounds.x + levelBounds.w - cam.w) {
+      cam.x = levelBounds.x + levelBounds.w - cam.w;
+    }
+
+    if (cam.x < levelBounds.x) {
+      cam.x = levelBounds.x;
     }
 
-    if (cam.x > LEVEL_WIDTH - cam.w) {
-      cam.x = LEVEL_WIDTH - cam.w;
+    if (cam.y > levelBounds.y + levelBounds.h - cam.h) {
+      cam.y = levelBounds.y + levelBounds.h - cam.h;
     }
 
-    if (cam.y < 0) {
-      cam.y = 0;
+    if (cam.y < levelBounds.y) {
+      cam.y = levelBounds.y;
     }
 
-    if (cam.y > LEVEL_HEIGHT - cam.h) {
-      cam.y = LEVEL_HEIGHT - cam.h;
+    // stream chunks around the new view; tiles and the nav grid follow
+    // chunks land whenever the worker finishes them, which would change
+    // when enemies see new walls from run to run; recordings and replays
+    // wait for them instead, so the simulation repeats exactly
+    bool levelChanged = deterministicStreaming ? level.LoadAround(cam)
+                                               : level.Update(cam);
+    if (levelChanged) {
+      RebuildLevelTiles();
+      BuildNavGrid();
     }
 
+    // sounds are heard from the middle of the screen
+    voices.SetListener(cam.x + cam.w / 2, cam.y + cam.h / 2);
+
     // avg. fps = frames / time
     float avgFPS = countedFrames / (fpsTimer.GetTicks() / 1000.0f);
 
@@ -1167,38 +2219,137 @@ int main(int argc, char *argv[]) {
       avgFPS = 0;
     }
 
-    // timer text with background
-    SDL_RenderFillRect(renderer, &statusBarBG);
+    // everything from here on is ui, at native res
+    EndWorldRender();
+
+    if (showHud) {
+      hud.Render();
+    }
+
+    // timer text with background; grows upward while the input wraps
+    SDL_Rect inputBG = GetInputRect();
+    SDL_RenderFillRect(renderer, &inputBG);
+
+    // render stats overlay along the top
+    if (showStats) {
+      LHistogram &latency = inputLatency.GetPollToPresent();
+      UpdateMemoryStats();
 
-    // render info text
-    // timeText.str("");
-    // timeText << "FPS: " << (int)avgFPS << ", Music: "
-    //          << (Mix_PausedMusic() == 1 || Mix_PlayingMusic() == 0 ?
-    //          "Stopped"
-    //                                                                :
-    //                                                                "Playing");
+      char *stats = frameArena.Printf(
+          "FPS: %d  Input p50: %.1fms p99: %.1fms  Allocs: %d  Mem: %.1fMB",
+          (int)avgFPS, latency.Percentile(0.5f), latency.Percentile(0.99f),
+          (int)lastFrameAllocs, memoryStats.GetTotal() / (1024.0 * 1024.0));
 
-    // if (!tTimer.LoadFromRenderedText(timeText.str().c_str(), textColor)) {
-    //   printf("Unable to update text texture: %s\n", SDL_GetError());
-    // }
+      SDL_Rect statsBG = {0, 0, SCREEN_WIDTH, statusBarBG.h};
+      SDL_RenderFillRect(renderer, &statsBG);
 
-    // tTimer.Render(0, statusBarBG.y + (statusBarBG.h - tPrompt.GetHeight()) /
-    // 2);
+      if (stats != NULL) {
+        overlayGlyphs.Render(renderer, stats, 0,
+                             (statsBG.h - overlayGlyphs.GetHeight()) / 2);
+      }
+    }
 
     // render input text
-    tInput.Render(0, statusBarBG.y + (statusBarBG.h - tPrompt.GetHeight()) / 2);
+    inputField.Render(0, inputBG.y + (statusBarBG.h - tPrompt.GetHeight()) / 2);
+
+    // captures read back the finished frame, so before present
+    CaptureFrame();
 
     // update screen
+    perfCounters.Begin(PERF_PHASE_PRESENT);
     SDL_RenderPresent(renderer);
+    perfCounters.End(PERF_PHASE_PRESENT);
+    renderRecorder.Present();
+    inputLatency.OnPresent();
+
+    // frame boundary; hand autosave a copy of the save state if one is due
+    size_t saveSize = sizeof(saveData) + saveBallast.size();
+    Uint8 *snapshot = autosave.BeginSnapshot(saveSize, SDL_GetTicks());
+    if (snapshot != NULL) {
+      memcpy(snapshot, saveData, sizeof(saveData));
+      if (!saveBallast.empty()) {
+        memcpy(snapshot + sizeof(saveData), saveBallast.data(),
+               saveBallast.size());
+      }
+
+      autosave.EndSnapshot();
+    }
+
+    // frame boundary is also where this frame's state goes into history
+    if (!rewinding) {
+      auto snapStart = std::chrono::high_resolution_clock::now();
+
+      PushStateSnapshot(simTick++);
+
+      snapshotTimes.Add(
+          std::chrono::duration<float, std::chrono::milliseconds::period>(
+              std::chrono::high_resolution_clock::now() - snapStart)
+              .count());
+    }
+
+    // time spent on this frame, snapshot included
+    auto frameEnd = std::chrono::high_resolution_clock::now();
+    float frameMs =
+        std::chrono::duration<float, std::chrono::milliseconds::period>(
+            frameEnd - currentTime)
+            .count();
+
+    frameTimes.Add(frameMs);
+    if (snapshot != NULL) {
+      autosaveFrameTimes.Add(frameMs);
+    }
+
+    // next frame's world scale
+    if (worldTarget != NULL) {
+      resScaler.AddFrame(frameMs);
+    }
+
+    lastFrameAllocs = GetThreadAllocations() - allocsAtStart;
+
+    if (countedFrames >= ALLOC_WARMUP_FRAMES && lastFrameAllocs > 0) {
+      steadyAllocs += lastFrameAllocs;
+      steadyAllocFrames++;
+
+      if (firstAllocFrame < 0) {
+        firstAllocFrame = countedFrames;
+      }
+    }
 
     // update last time
     lastUpdateTime = currentTime;
 
     // increment counted frames
     countedFrames++;
+
+    if (benchMode && countedFrames >= benchFrames) {
+      quit = true;
+    }
+
+    // replay ends on the frame the recording did
+    if (inputReplay.IsLoaded() && inputReplay.IsFinished(countedFrames)) {
+      quit = true;
+    }
   }
 
+  inputRecorder.Close(countedFrames);
+  renderRecorder.Close();
+
+  if (benchMode) {
+    // worker owns the save stats until it's joined
+    autosave.Stop();
+    capture.Stop();
+    PrintBenchResults();
+    perfCounters.Close();
+  }
+
+  UpdateMemoryStats();
+  memoryStats.Report();
+
   Close();
 
-  return 1;
+  if (checkAllocs && steadyAllocFrames > 0) {
+    return 1;
+  }
+
+  return 0;
 }
@@ -0,0 +1,179 @@
+#include <SDL2/SDL.h>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "LHistogram.h"
+#include "LRenderRecording.h"
+
+// plays a --record-render stream back as fast as the renderer takes it, with
+// no input, simulation or frame cap in the way
+//
+//   ./render_replay run.rrc [--driver name] [--loops N] [--vsync]
+//   ./render_replay --list-drivers
+//
+// run with SDL_VIDEODRIVER=dummy and --driver software for a headless
+// baseline; compare against opengl, vulkan, metal... on the same recording
+
+const char *streamPath = NULL;
+const char *driverName = NULL;
+int loops = 5;
+bool vsync = false;
+
+LHistogram frameTimes;
+auto lastPresent = std::chrono::high_resolution_clock::now();
+
+void ListDrivers() {
+  for (int i = 0; i < SDL_GetNumRenderDrivers(); ++i) {
+    SDL_RendererInfo info;
+    if (SDL_GetRenderDriverInfo(i, &info) == 0) {
+      printf("%s\n", info.name);
+    }
+  }
+}
+
+bool ParseArgs(int argc, char *argv[]) {
+  for (int i = 1; i < argc; ++i) {
+    bool hasValue = i + 1 < argc;
+
+    if (strcmp(argv[i], "--driver") == 0 && hasValue) {
+      driverName = argv[++i];
+    }
+
+    else if (strcmp(argv[i], "--loops") == 0 && hasValue) {
+      loops = atoi(argv[++i]);
+    }
+
+    else if (strcmp(argv[i], "--vsync") == 0) {
+      vsync = true;
+    }
+
+    else if (argv[i][0] != '-' && streamPath == NULL) {
+      streamPath = argv[i];
+    }
+
+    else {
+      printf("Unknown argument: %s\n", argv[i]);
+      return false;
+    }
+  }
+
+  return streamPath != NULL && loops > 0;
+}
+
+void OnPresent(void *) {
+  auto now = std::chrono::high_resolution_clock::now();
+  frameTimes.Add(
+      std::chrono::duration<float, std::chrono::milliseconds::period>(
+          now - lastPresent)
+          .count());
+  lastPresent = now;
+}
+
+int main(int argc, char *argv[]) {
+  if (SDL_Init(SDL_INIT_VIDEO) < 0) {
+    printf("SDL init failed: %s\n", SDL_GetError());
+    return 1;
+  }
+
+  if (argc == 2 && strcmp(argv[1], "--list-drivers") == 0) {
+    ListDrivers();
+    SDL_Quit();
+    return 0;
+  }
+
+  if (!ParseArgs(argc, argv)) {
+    printf("usage: render_replay <recording> [--driver name] [--loops N] "
+           "[--vsync]\n"
+           "       render_replay --list-drivers\n");
+    SDL_Quit();
+    return 1;
+  }
+
+  if (driverName != NULL) {
+    SDL_SetHint(SDL_HINT_RENDER_DRIVER, driverName);
+  }
+
+  // the window is resized to the recording once it's read
+  SDL_Window *window =
+      SDL_CreateWindow("Render Replay", SDL_WINDOWPOS_UNDEFINED,
+                       SDL_WINDOWPOS_UNDEFINED, 640, 480, SDL_WINDOW_HIDDEN);
+  if (window == NULL) {
+    printf("Window creation failed: %s\n", SDL_GetError());
+    SDL_Quit();
+    return 1;
+  }
+
+  SDL_Renderer *renderer =
+      SDL_CreateRenderer(window, -1, vsync ? SDL_RENDERER_PRESENTVSYNC : 0);
+  if (renderer == NULL) {
+    printf("Could not create renderer: %s\n", SDL_GetError());
+    SDL_DestroyWindow(window);
+    SDL_Quit();
+    return 1;
+  }
+
+  SDL_RendererInfo info;
+  SDL_GetRendererInfo(renderer, &info);
+
+  LRenderReplay replay;
+
+  auto loadStart = std::chrono::high_resolution_clock::now();
+  bool loaded = replay.Load(streamPath, renderer);
+  float loadMs =
+      std::chrono::duration<float, std::chrono::milliseconds::period>(
+          std::chrono::high_resolution_clock::now() - loadStart)
+          .count();
+
+  if (!loaded) {
+    SDL_DestroyRenderer(renderer);
+    SDL_DestroyWindow(window);
+    SDL_Quit();
+    return 1;
+  }
+
+  SDL_SetWindowSize(window, replay.GetWidth(), replay.GetHeight());
+  SDL_ShowWindow(window);
+
+  printf("renderer: %s%s\n", info.name,
+         (info.flags & SDL_RENDERER_SOFTWARE) ? " (software)" : "");
+  printf("recording: %d frames, %d commands, %d textures (%.1f MB), "
+         "loaded in %.1fms\n",
+         replay.GetFrames(), replay.GetCommandCount(),
+         replay.GetTextureCount(),
+         replay.GetTextureBytes() / (1024.0 * 1024.0), loadMs);
+
+  // one untimed pass, so first-use costs in the driver don't count
+  replay.Play(renderer);
+
+  lastPresent = std::chrono::high_resolution_clock::now();
+  auto start = lastPresent;
+
+  for (int i = 0; i < loops; ++i) {
+    // window events are drained so the compositor doesn't think we hung
+    SDL_PumpEvents();
+    replay.Play(renderer, OnPresent);
+  }
+
+  float totalMs =
+      std::chrono::duration<float, std::chrono::milliseconds::period>(
+          std::chrono::high_resolution_clock::now() - start)
+          .count();
+
+  int frames = replay.GetFrames() * loops;
+  printf("--- replay: %d frames in %.1fms ---\n", frames, totalMs);
+  if (totalMs > 0) {
+    printf("%.1f frames/s, %.0f commands/s\n", frames * 1000.0f / totalMs,
+           (float)replay.GetCommandCount() * loops * 1000.0f / totalMs);
+  }
+
+  frameTimes.Print("replay frame");
+
+  replay.Free();
+  SDL_DestroyRenderer(renderer);
+  SDL_DestroyWindow(window);
+  SDL_Quit();
+
+  return 0;
+}